@@ -10,6 +10,7 @@ void help() {
     cerr << "    I  -> Integer" << endl;
     cerr << "    C  -> Ciphertext" << endl;
     cerr << "    P  -> PackedCiphertext" << endl;
+    cerr << "    PL -> PackLayout" << endl;
     cerr << "    Vf -> Vec<float>" << endl;
     cerr << "    VI -> Vec<Integer>" << endl;
     cerr << "    VC -> Vec<Ciphertext>" << endl;
@@ -39,6 +40,9 @@ int main (int argc, char **argv) {
     } else if (type == "P") {
         PackedCiphertext x = deserialize_from_file<PackedCiphertext>(file);
         cout << x.to_string(false) << endl;
+    } else if (type == "PL") {
+        PackLayout x = deserialize_from_file<PackLayout>(file);
+        cout << x.to_string(false) << endl;
     } else if (type == "Vf") {
         Vec<float> x = deserialize_from_file<Vec<float>>(file);
         cout << x << endl;
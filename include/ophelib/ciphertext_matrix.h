@@ -0,0 +1,367 @@
+#pragma once
+
+#include "ophelib/paillier_base.h"
+#include "ophelib/packing.h"
+#include "ophelib/vector.h"
+
+#include <memory>
+
+#include <gmp.h>
+
+namespace ophelib {
+
+    class CiphertextMatrix;
+
+    /**
+     * Flat storage for many ciphertexts under the same key. Base of
+     * CiphertextVector and CiphertextMatrix, not to be used directly.
+     *
+     * A Vec<Ciphertext> stores every element as a separate object,
+     * with its own heap allocated limbs and two shared pointers.
+     * Here, all elements are stored as fixed width limb arrays
+     * (the width of n^2) in a single, cache line aligned allocation,
+     * and a single key handle is kept per container.
+     *
+     * Elements are padded to a multiple of the cache line size, so
+     * rows of a matrix can be processed by different threads without
+     * false sharing.
+     */
+    class CiphertextArray {
+        friend class CiphertextMatrix;
+
+    protected:
+        size_t n_elements;
+
+        /**
+         * Number of limbs every element has
+         */
+        size_t width;
+
+        /**
+         * Number of limbs between the start of two elements
+         */
+        size_t stride;
+
+        /**
+         * Frees the buffer and updates live_bytes()
+         */
+        struct LimbDeleter {
+            size_t bytes;
+            void operator()(mp_limb_t *p) const;
+        };
+        std::unique_ptr<mp_limb_t[], LimbDeleter> limbs;
+
+        CiphertextArray();
+        CiphertextArray(const size_t n_elements, const KeyContext *key);
+        CiphertextArray(const size_t n_elements, const size_t width, const KeyContext *key);
+        CiphertextArray(const CiphertextArray &other);
+        CiphertextArray(CiphertextArray &&other);
+        CiphertextArray &operator=(const CiphertextArray &other);
+        CiphertextArray &operator=(CiphertextArray &&other);
+
+        void allocate();
+
+        mp_limb_t *element(const size_t i);
+        const mp_limb_t *element(const size_t i) const;
+
+        /**
+         * Element-wise homomorphic addition of other, in place.
+         * The elements are split into contiguous chunks, one per
+         * thread, which do not share cache lines.
+         */
+        void add_elements(const CiphertextArray &other);
+
+    public:
+        /**
+         * Key shared by all elements, see Ciphertext::key
+         */
+        const KeyContext *key;
+
+        /**
+         * Number of limbs used per element, i.e. width
+         * of n^2 in limbs.
+         */
+        size_t limbs_per_element() const;
+
+        /**
+         * Size of the element buffer in bytes
+         */
+        size_t memory_usage() const;
+
+        /**
+         * Total number of elements
+         */
+        size_t size() const;
+
+        /**
+         * Get element i (row major index for matrices)
+         */
+        Ciphertext at(const size_t i) const;
+
+        /**
+         * Read only mpz view of element i, without copying.
+         * Valid as long as the container is not modified.
+         * @param tmp storage for the view, see mpz_roinit_n
+         */
+        mpz_srcptr view(const size_t i, mpz_ptr tmp) const;
+
+        /**
+         * Set element i. data has to be in [0, n^2).
+         */
+        void set_data(const size_t i, const Integer &data);
+
+        /**
+         * Raw element data. Element i starts at
+         * data() + i * element_stride() and is
+         * limbs_per_element() limbs long, least
+         * significant limb first.
+         */
+        const mp_limb_t *data() const;
+        size_t element_stride() const;
+    };
+
+    /**
+     * Vector of ciphertexts in flat storage, see CiphertextArray.
+     */
+    class CiphertextVector: public CiphertextArray {
+    public:
+        CiphertextVector();
+
+        /**
+         * Vector with n elements, all set to 0
+         */
+        CiphertextVector(const size_t n, const KeyContext *key);
+
+        /**
+         * Vector with n elements and the given width (in limbs). Used when
+         * deserializing, where the modulus might not be known.
+         */
+        CiphertextVector(const size_t n, const size_t width, const KeyContext *key);
+
+        /**
+         * Convert from NTL vector. The key context is taken from
+         * the first element, all elements have to use the same key.
+         */
+        explicit CiphertextVector(const Vec<Ciphertext> &v);
+
+        long length() const;
+
+        Ciphertext get(const size_t i) const;
+        void set(const size_t i, const Ciphertext &c);
+
+        /**
+         * Convert to NTL vector
+         */
+        Vec<Ciphertext> to_vec() const;
+
+        /**
+         * Element-wise homomorphic addition, in place
+         */
+        CiphertextVector &operator+=(const CiphertextVector &other);
+
+        /**
+         * Compare data. Encryption moduli are not compared.
+         */
+        bool operator==(const CiphertextVector &other) const;
+        bool operator!=(const CiphertextVector &other) const;
+    };
+
+    /**
+     * Row major matrix of ciphertexts in flat storage,
+     * see CiphertextArray.
+     */
+    class CiphertextMatrix: public CiphertextArray {
+        size_t n_rows;
+        size_t n_cols;
+
+    public:
+        CiphertextMatrix();
+
+        /**
+         * n x m matrix, all elements set to 0
+         */
+        CiphertextMatrix(const size_t n, const size_t m, const KeyContext *key);
+
+        /**
+         * n x m matrix with the given width (in limbs). Used when
+         * deserializing, where the modulus might not be known.
+         */
+        CiphertextMatrix(const size_t n, const size_t m, const size_t width, const KeyContext *key);
+
+        /**
+         * Convert from NTL matrix. The key context is taken from
+         * the first element, all elements have to use the same key.
+         */
+        explicit CiphertextMatrix(const Mat<Ciphertext> &m);
+
+        long NumRows() const;
+        long NumCols() const;
+
+        Ciphertext get(const size_t i, const size_t j) const;
+        void set(const size_t i, const size_t j, const Ciphertext &c);
+
+        /**
+         * Copy of row i
+         */
+        CiphertextVector row(const size_t i) const;
+
+        /**
+         * Convert to NTL matrix
+         */
+        Mat<Ciphertext> to_mat() const;
+
+        /**
+         * Compare data. Encryption moduli are not compared.
+         */
+        bool operator==(const CiphertextMatrix &other) const;
+        bool operator!=(const CiphertextMatrix &other) const;
+    };
+
+    /**
+     * Symmetric n x n matrix of ciphertexts in flat storage, see
+     * CiphertextArray. Only the upper triangle (including the diagonal)
+     * is stored, row major, i.e. n * (n + 1) / 2 elements. E.g. an
+     * encrypted outer product x * x^T only needs half the encryptions,
+     * additions and bytes on the wire.
+     */
+    class SymmetricCiphertextMatrix: public CiphertextArray {
+        size_t n;
+
+    public:
+        SymmetricCiphertextMatrix();
+
+        /**
+         * n x n matrix, all elements set to 0
+         */
+        SymmetricCiphertextMatrix(const size_t n, const KeyContext *key);
+
+        /**
+         * n x n matrix with the given width (in limbs). Used when
+         * deserializing, where the modulus might not be known.
+         */
+        SymmetricCiphertextMatrix(const size_t n, const size_t width, const KeyContext *key);
+
+        /**
+         * Convert from NTL matrix, which has to be square. Only the
+         * upper triangle is used, the lower one is not checked.
+         */
+        explicit SymmetricCiphertextMatrix(const Mat<Ciphertext> &m);
+
+        long NumRows() const;
+        long NumCols() const;
+
+        /**
+         * Position of (i, j) in the upper triangle, i.e. the index
+         * for at() and view()
+         */
+        size_t index(size_t i, size_t j) const;
+
+        /**
+         * Element (i, j), same as (j, i)
+         */
+        Ciphertext get(const size_t i, const size_t j) const;
+
+        /**
+         * Set element (i, j) and thereby (j, i)
+         */
+        void set(const size_t i, const size_t j, const Ciphertext &c);
+
+        /**
+         * Convert to full NTL matrix
+         */
+        Mat<Ciphertext> to_mat() const;
+
+        /**
+         * Element-wise homomorphic addition and negation
+         */
+        SymmetricCiphertextMatrix &operator+=(const SymmetricCiphertextMatrix &other);
+        SymmetricCiphertextMatrix operator+(const SymmetricCiphertextMatrix &other) const;
+        SymmetricCiphertextMatrix operator-() const;
+
+        /**
+         * Compare data. Encryption moduli are not compared.
+         */
+        bool operator==(const SymmetricCiphertextMatrix &other) const;
+        bool operator!=(const SymmetricCiphertextMatrix &other) const;
+    };
+
+    namespace Vector {
+        /**
+         * Encrypt vector into flat storage
+         */
+        CiphertextVector encrypt_flat(const Vec<Integer> &plain, const PaillierBase &pai);
+
+        /**
+         * Encrypt matrix into flat storage
+         */
+        CiphertextMatrix encrypt_flat(const Mat<Integer> &plain, const PaillierBase &pai);
+
+        /**
+         * Encrypt the upper triangle of a square matrix
+         */
+        SymmetricCiphertextMatrix encrypt_symmetric(const Mat<Integer> &plain, const PaillierBase &pai);
+
+        /**
+         * Encrypt the outer product x * x^T, without computing
+         * the lower triangle
+         */
+        SymmetricCiphertextMatrix encrypt_outer(const Vec<Integer> &x, const PaillierBase &pai);
+
+        Vec<Integer> decrypt(const CiphertextVector &cipher, const PaillierBase &pai);
+        Mat<Integer> decrypt(const CiphertextMatrix &cipher, const PaillierBase &pai);
+        Mat<Integer> decrypt(const SymmetricCiphertextMatrix &cipher, const PaillierBase &pai);
+
+        /**
+         * Sum of all elements (homomorphic addition)
+         */
+        Ciphertext sum(const CiphertextVector &v);
+
+        /**
+         * Sum over an axis, see sum(const Mat<number>&, const int)
+         */
+        CiphertextVector sum(const CiphertextMatrix &m, const int axis);
+
+        /**
+         * Element-wise sum of all matrices (homomorphic addition)
+         */
+        SymmetricCiphertextMatrix sum(const Vec<SymmetricCiphertextMatrix> &v);
+
+        /**
+         * Dot product
+         * @param A Ciphertext vector
+         * @param B Integer vector
+         */
+        Ciphertext dot(const CiphertextVector &A, const Vec<Integer> &B);
+
+        /**
+         * Dot product
+         * @param A is n x d, Ciphertext
+         * @param B is d x 1, Integer
+         * @return n x 1, Ciphertext
+         */
+        CiphertextVector dot(const CiphertextMatrix &A, const Vec<Integer> &B);
+
+        /**
+         * Dot product
+         * @param A is n x n, Ciphertext
+         * @param B is n x 1, Integer
+         * @return n x 1, Ciphertext
+         */
+        CiphertextVector dot(const SymmetricCiphertextMatrix &A, const Vec<Integer> &B);
+
+        /**
+         * Pack a vector of ciphertexts, see pack_ciphertexts_vec(const Vec<Ciphertext>&, ...)
+         */
+        Vec<PackedCiphertext> pack_ciphertexts_vec(const CiphertextVector &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai);
+
+        /**
+         * Decrypt using packing, see decrypt_fast(const Vec<Ciphertext>&, ...)
+         */
+        Vec<Integer> decrypt_fast(const CiphertextVector &cipher, const PaillierBase &pai, const size_t plaintext_bits);
+
+        /**
+         * Decrypt using packing, see decrypt_fast(const Mat<Ciphertext>&, ...)
+         */
+        Mat<Integer> decrypt_fast(const CiphertextMatrix &cipher, const PaillierBase &pai, const size_t plaintext_bits);
+    }
+}
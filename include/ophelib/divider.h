@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ophelib/integer.h"
+
+namespace ophelib {
+
+    /**
+     * Division by a fixed divisor, for dividing many numbers by the
+     * same Integer, e.g. a whole vector in every iteration of a
+     * gradient descent.
+     *
+     * The divisor is split into sign * odd * 2^shift once. A division
+     * is then a shift, followed by a division by the odd part, with
+     * mpz_fdiv_q_ui if it fits into a limb. Powers of two, like the
+     * default Integerizer factors, are a plain shift.
+     *
+     * A Barrett style reciprocal is not used, for the sizes in ophelib
+     * it is slower than GMP's division, which already works with a
+     * precomputed inverse of the leading limbs.
+     *
+     * Results are rounded towards -inf, same as operator/ of Integer.
+     */
+    class Divider {
+        const Integer divisor;
+
+        /**
+         * divisor = (negative ? -1 : 1) * odd * 2^shift
+         */
+        const bool negative;
+        const size_t shift;
+        const Integer odd;
+
+        /**
+         * odd, if it fits into an unsigned long, 0 otherwise
+         */
+        const unsigned long odd_ui;
+
+    public:
+        /**
+         * @param divisor must not be 0
+         */
+        explicit Divider(const Integer &divisor);
+
+        const Integer &get_divisor() const;
+
+        /**
+         * dst = a / divisor, rounded towards -inf. dst may be the
+         * same object as a.
+         */
+        void divide(Integer &dst, const Integer &a) const;
+
+        Integer divide(const Integer &a) const;
+    };
+
+    Integer operator/(const Integer &lhs, const Divider &rhs);
+    Integer operator/(Integer &&lhs, const Divider &rhs);
+}
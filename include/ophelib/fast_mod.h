@@ -2,6 +2,8 @@
 
 #include "ophelib/integer.h"
 
+#include <vector>
+
 namespace ophelib {
 
     /*
@@ -22,6 +24,17 @@ namespace ophelib {
     class FastMod {
         const Integer p, q, p2, q2, n, n2;
 
+        /**
+         * q^2^-1 mod p^2, for recombining with Garner's formula
+         */
+        const Integer q2_inv;
+
+        /**
+         * Combine x_p = x mod p^2 and x_q = x mod q^2 into dst = x mod n^2.
+         * Overwrites x_p.
+         */
+        void crt_combine(Integer &dst, Integer &x_p, const Integer &x_q) const;
+
     public:
 
         /**
@@ -38,6 +51,11 @@ namespace ophelib {
 
         const Integer &get_n2() const;
 
+        /**
+         * Bytes used by this instance, including the object itself
+         */
+        size_t memory_usage() const;
+
         /**
          * First part of the acceleration: split the (mod n^2) calculation
          * into two calculations (mod p^2) and (mod q^2). The use the
@@ -49,6 +67,12 @@ namespace ophelib {
          */
         Integer pow_mod_n2(const Integer &base, const Integer &exp) const;
 
+        /**
+         * In-place variant, dst = base^exp mod n^2. dst may be the same
+         * object as base or exp. Uses thread local scratch, see mul_mod().
+         */
+        void pow_mod_n2(Integer &dst, const Integer &base, const Integer &exp) const;
+
         /**
          * Same as pow_mod_n2 but parallelized.
          * Is about 3x faster than "classic" pow_mod_n2.
@@ -57,5 +81,14 @@ namespace ophelib {
          * * pow completed in 2.55037s
          */
         Integer pow_mod_n2_par(const Integer &base, const Integer &exp) const;
+
+        /**
+         * dst = x_0^(2^(shift*(k-1))) * x_1^(2^(shift*(k-2))) * ... * x_{k-1} mod n^2,
+         * Horner's scheme with factor 2^shift as used for packing ciphertexts.
+         * The whole chain is computed mod p^2 and mod q^2, in parallel, and
+         * combined only once at the end, instead of once per step.
+         * @param xs k > 0 values, must not alias dst
+         */
+        void horner_pow2_n2(Integer &dst, const std::vector<mpz_srcptr> &xs, const size_t shift) const;
     };
 }
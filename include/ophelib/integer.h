@@ -46,7 +46,16 @@ namespace ophelib {
     public:
         /* Constructors */
         Integer();
+        Integer(const Integer &input);
         Integer(const mpz_class &input);
+
+        /**
+         * Move constructors. These take over the limbs of input,
+         * input is left as 0 (without any allocated limbs).
+         */
+        Integer(Integer &&input) noexcept;
+        Integer(mpz_class &&input) noexcept;
+
         Integer(const long &input);
         Integer(const long long &input);
         Integer(const int &input);
@@ -57,15 +66,23 @@ namespace ophelib {
 
         Integer &operator=(const Integer &input);
         Integer &operator=(const mpz_class &input);
+
+        /**
+         * Move assignment. Swaps the limbs, so the old limbs of this
+         * are freed together with input.
+         */
+        Integer &operator=(Integer &&input) noexcept;
+        Integer &operator=(mpz_class &&input) noexcept;
         Integer &operator=(const long &input);
         Integer &operator=(const int &input);
         Integer &operator=(const unsigned int &input);
         Integer &operator=(const unsigned long &input);
 
         /**
-         * Unary -
+         * Unary -. The rvalue version negates in place.
          */
-        Integer operator-() const;
+        Integer operator-() const &;
+        Integer operator-() &&;
 
         /* conversions */
         long to_long() const;
@@ -78,6 +95,12 @@ namespace ophelib {
          */
         size_t size_bits() const;
 
+        /**
+         * Bytes used by this Integer, including the object itself
+         * and the allocator overhead of its limbs.
+         */
+        size_t memory_usage() const;
+
         /**
          * Power with long exponent
          */
@@ -86,12 +109,12 @@ namespace ophelib {
         /**
          * Power modulo mod
          */
-        Integer pow_mod_n(const Integer &exponent, const Integer mod) const;
+        Integer pow_mod_n(const Integer &exponent, const Integer &mod) const;
 
         /**
          * Multiplicative inverse modulo mod
          */
-        Integer inv_mod_n(const Integer mod) const;
+        Integer inv_mod_n(const Integer &mod) const;
 
         /**
          * String representation. If brief = true, only size
@@ -107,10 +130,13 @@ namespace ophelib {
         std::string to_string_(const unsigned int base = 10) const;
 
         /**
-         * Test if prime, using Miller-Rabin. See the macro
-         * N_PRIME_CHEKS_FOR_SIZE for more details.
+         * Test if prime. Does trial division by small primes (a single
+         * GCD with their product), followed by a Baillie-PSW test.
+         * @param confirm additionally run Miller-Rabin with random
+         *        bases, see the macro N_PRIME_CHEKS_FOR_SIZE for
+         *        more details.
          */
-        bool is_prime() const;
+        bool is_prime(const bool confirm = false) const;
 
         /**
          * Least common multiple
@@ -147,4 +173,68 @@ namespace ophelib {
     Integer operator/(const Integer &lhs, const int &rhs);
     Integer operator<<(const mpz_class &lhs, const size_t &rhs);
     Integer operator>>(const mpz_class &lhs, const size_t &rhs);
+
+    /* Overloads for temporaries. These compute the result in place,
+     * reusing the limbs of the temporary instead of allocating
+     * new ones. */
+    Integer operator+(Integer &&lhs, const mpz_class &rhs);
+    Integer operator+(const mpz_class &lhs, Integer &&rhs);
+    Integer operator+(Integer &&lhs, Integer &&rhs);
+    Integer operator+(Integer &&lhs, const int &rhs);
+    Integer operator+(Integer &&lhs, const unsigned int &rhs);
+    Integer operator-(Integer &&lhs, const mpz_class &rhs);
+    Integer operator-(Integer &&lhs, const int &rhs);
+    Integer operator-(Integer &&lhs, const unsigned int &rhs);
+    Integer operator*(Integer &&lhs, const Integer &rhs);
+    Integer operator*(const Integer &lhs, Integer &&rhs);
+    Integer operator*(Integer &&lhs, Integer &&rhs);
+    Integer operator%(Integer &&lhs, const Integer &rhs);
+    Integer operator/(Integer &&lhs, const Integer &rhs);
+    Integer operator/(Integer &&lhs, const int &rhs);
+    Integer operator<<(Integer &&lhs, const size_t &rhs);
+    Integer operator>>(Integer &&lhs, const size_t &rhs);
+
+    /* In-place modular arithmetic. The result is written to dst, which
+     * may be the same object as any of the inputs, and is in [0, mod).
+     * Products are computed in a thread local scratch buffer, so once
+     * dst and the scratch have the size of the modulus, no heap
+     * allocations are done. */
+
+    /**
+     * dst = a * b mod mod
+     */
+    void mul_mod(Integer &dst, const Integer &a, const Integer &b, const Integer &mod);
+
+    /**
+     * dst = a^2 mod mod
+     */
+    void sqr_mod(Integer &dst, const Integer &a, const Integer &mod);
+
+    /**
+     * dst = a * b^-1 mod mod
+     */
+    void div_mod(Integer &dst, const Integer &a, const Integer &b, const Integer &mod);
+
+    /**
+     * dst = a^-1 mod mod
+     */
+    void inv_mod(Integer &dst, const Integer &a, const Integer &mod);
+
+    /**
+     * dst = base^exp mod mod
+     */
+    void pow_mod(Integer &dst, const Integer &base, const Integer &exp, const Integer &mod);
+
+    /* Fused accumulate, mpz_addmul and mpz_submul. The product is added
+     * to dst directly, without a temporary Integer. */
+
+    /**
+     * dst = dst + a * b
+     */
+    void add_mul(Integer &dst, const Integer &a, const Integer &b);
+
+    /**
+     * dst = dst - a * b
+     */
+    void sub_mul(Integer &dst, const Integer &a, const Integer &b);
 }
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "ophelib/paillier_fast.h"
+
+#include <memory>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+namespace ophelib {
+
+    /**
+     * Pool of ready to use PaillierFast instances, for issuing a
+     * fresh key pair per session without paying for generate_keys()
+     * and the precomputation (FastMod, mu, randomizer lookup table)
+     * at session setup.
+     *
+     * A fixed set of key sizes is managed, for each of them up to
+     * `capacity` instances are kept. Background threads refill the
+     * pool whenever an instance is taken out. If the pool for a key
+     * size is empty, acquire() generates a key synchronously.
+     *
+     * Instances are handed out as shared pointers and are never
+     * handed out twice.
+     */
+    class KeyPool {
+    public:
+        /**
+         * Counters, see stats()
+         */
+        struct Stats {
+            /**
+             * acquire() calls served from the pool
+             */
+            size_t hits;
+
+            /**
+             * acquire() calls which had to generate a key
+             */
+            size_t misses;
+
+            /**
+             * Keys generated by the background threads
+             */
+            size_t generated;
+        };
+
+        /**
+         * @param key_sizes key sizes to keep in the pool, see PaillierFast
+         *        for supported values.
+         * @param capacity number of instances to keep per key size.
+         *        With 0, every acquire() is a miss.
+         * @param n_threads number of background threads. Each of
+         *        them uses the OpenMP parallel key generation.
+         *        Has to be at least 1 if capacity > 0.
+         */
+        KeyPool(const std::vector<size_t> &key_sizes, const size_t capacity, const size_t n_threads = 1);
+
+        /**
+         * Stops the background threads. Waits for keys currently
+         * being generated.
+         */
+        ~KeyPool();
+
+        KeyPool(const KeyPool&) = delete;
+        KeyPool &operator=(const KeyPool&) = delete;
+
+        /**
+         * Take a fully precomputed instance with a fresh key pair.
+         * Rethrows the error if key generation in a background
+         * thread failed.
+         * @param key_size_bits has to be one of the managed sizes
+         */
+        std::shared_ptr<PaillierFast> acquire(const size_t key_size_bits);
+
+        /**
+         * Number of instances ready for the given key size
+         */
+        size_t available(const size_t key_size_bits) const;
+
+        /**
+         * Block until the pool is full for all key sizes. Rethrows
+         * the error if key generation in a background thread failed.
+         */
+        void wait_full() const;
+
+        Stats stats() const;
+
+    private:
+        struct Slot {
+            std::deque<std::shared_ptr<PaillierFast>> ready;
+
+            /**
+             * Number of keys currently being generated
+             * by the background threads
+             */
+            size_t in_flight = 0;
+        };
+
+        void worker();
+
+        /**
+         * Key size which needs a refill the most, or 0 if
+         * all are full. Needs the lock to be held.
+         */
+        size_t next_to_fill() const;
+
+        const size_t capacity;
+        std::map<size_t, Slot> slots;
+        Stats counters;
+        bool stopping;
+
+        /**
+         * First error of a background thread, the failing
+         * thread stops
+         */
+        std::exception_ptr error;
+
+        mutable std::mutex mutex;
+        /**
+         * Signals the workers that something was taken out
+         */
+        std::condition_variable refill;
+        /**
+         * Signals waiters that something was put in
+         */
+        mutable std::condition_variable filled;
+
+        std::vector<std::thread> threads;
+    };
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ophelib {
+
+    /**
+     * Opt-in memory mode for GMP limbs. Every homomorphic operation
+     * allocates and frees a few limb buffers of about the size of n^2,
+     * which inside OpenMP loops makes malloc a scaling bottleneck.
+     *
+     * When enabled, the GMP memory functions are replaced with thread
+     * local pools, one per size class. A size class is a limb count, up
+     * to twice the width of n^2 (the size of a product before it is
+     * reduced). Freed blocks are kept in the pool of the calling thread
+     * and handed out again, larger requests go straight to the
+     * previously installed GMP memory functions, which also back the
+     * pools.
+     *
+     * Blocks are not tagged: a block is put into the pool of the largest
+     * class fitting the size GMP reports on free. Because of this, blocks
+     * allocated before enable() can be freed afterwards and vice versa.
+     *
+     * enable() and disable() call mp_set_memory_functions(), which is not
+     * thread safe. Call them at process start, or at least while no other
+     * thread is using GMP.
+     */
+    class LimbArena {
+    public:
+        /**
+         * Counters, summed over all threads, see stats()
+         */
+        struct Stats {
+            /**
+             * Allocations served from a pool
+             */
+            uint64_t hits;
+
+            /**
+             * Allocations in the pooled range with an empty pool
+             */
+            uint64_t misses;
+
+            /**
+             * Allocations too large to be pooled
+             */
+            uint64_t fallbacks;
+
+            /**
+             * Blocks and bytes currently kept in the pools
+             */
+            uint64_t cached_blocks;
+            uint64_t cached_bytes;
+
+            /**
+             * Number of threads which currently have pools
+             */
+            size_t n_threads;
+
+            /**
+             * Bytes handed out to GMP and not yet freed, counted from
+             * the first enable() on. Numbers allocated before enable()
+             * are subtracted when freed, so enable it at process start
+             * for exact numbers.
+             */
+            int64_t live_bytes;
+        };
+
+        /**
+         * Install the pools, with size classes tuned for the given key size.
+         * Calling it again just changes the tuning.
+         * @param key_size_bits size of n in bits
+         * @param max_cached_per_class blocks to keep per size class and
+         *        thread, more are given back right away. With 0, nothing
+         *        is pooled and only live_bytes() is kept up to date.
+         */
+        static void enable(const size_t key_size_bits, const size_t max_cached_per_class = 64);
+
+        /**
+         * Restore the GMP memory functions which were installed before
+         * enable(). Frees the pools of the calling thread, pools of other
+         * threads are freed when those threads exit.
+         */
+        static void disable();
+
+        static bool enabled();
+
+        /**
+         * Largest pooled block, in limbs. 0 if disabled.
+         */
+        static size_t max_limbs();
+
+        static Stats stats();
+    };
+
+    /**
+     * Estimated size of a heap allocation of `bytes` bytes, including
+     * the header and padding of the allocator (glibc malloc: one size_t
+     * header, 16 byte granularity, 32 bytes minimum). 0 for 0 bytes.
+     */
+    size_t heap_block_size(const size_t bytes);
+
+    /**
+     * Heap memory owned by x, i.e. x.memory_usage() without
+     * the object itself.
+     */
+    template<typename T>
+    size_t heap_usage(const T &x) {
+        return x.memory_usage() - sizeof(T);
+    }
+
+    /**
+     * Bytes currently allocated by ophelib, for exporting to monitoring.
+     * Counts the limbs of GMP numbers (only while LimbArena is enabled,
+     * see LimbArena::Stats::live_bytes) and the buffers of flat
+     * ciphertext containers (always).
+     */
+    int64_t live_bytes();
+
+    /**
+     * Add to the live_bytes() counter. For containers
+     * which allocate memory themselves.
+     */
+    void track_live_bytes(const int64_t delta);
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "ophelib/integer.h"
+#include "ophelib/ciphertext_matrix.h"
 #include "ophelib/paillier_fast.h"
 #include "ophelib/packing.h"
 #include "ophelib/vector.h"
 
 #include <functional>
+#include <memory>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -322,6 +324,69 @@ namespace ophelib {
             static const client_callback_t construct_client_callback(const PaillierBase &paillier);
         };
 
+        /**
+         * Running sums of the client contributions to LinregEncEncUsers
+         * and LinregPlainEncUsers, for when users send their data one
+         * at a time. Every contribution is folded into the sums in place,
+         * so memory stays O(n_features^2), no matter how many users
+         * contribute. Pass the aggregator to fit() when done.
+         *
+         * Contributions can be given as NTL containers or as flat ones,
+         * e.g. directly deserialized from the wire. add() is not thread
+         * safe, it parallelizes over the elements of the sums itself.
+         */
+        class UsersAggregator {
+            size_t n_users;
+
+            /**
+             * Sum of all Ai, empty for LinregPlainEncUsers
+             */
+            SymmetricCiphertextMatrix A;
+
+            /**
+             * Sum of all bi, or rows of B for LinregPlainEncUsers
+             */
+            CiphertextVector b;
+
+        public:
+            UsersAggregator();
+
+            /**
+             * Add one user of LinregEncEncUsers, i.e. one element of
+             * client_preprocess_A() and one row of client_preprocess_b().
+             * Ai is symmetric, only the upper triangle is used.
+             */
+            void add(const Mat<Ciphertext> &Ai, const Vec<Ciphertext> &bi);
+            void add(const SymmetricCiphertextMatrix &Ai, const CiphertextVector &bi);
+
+            /**
+             * Add one user of LinregPlainEncUsers, i.e. one row
+             * of client_preprocess().
+             */
+            void add(const Vec<Ciphertext> &bi);
+            void add(const CiphertextVector &bi);
+
+            /**
+             * Number of users added so far
+             */
+            size_t size() const;
+
+            /**
+             * Number of features, 0 if no user was added yet
+             */
+            long n_features() const;
+
+            /**
+             * Sum of all Ai, throws if there is none
+             */
+            const SymmetricCiphertextMatrix &get_A() const;
+
+            /**
+             * Sum of all bi, throws if there is none
+             */
+            const CiphertextVector &get_b() const;
+        };
+
         /**
          * Linear regression with plaintext X (features), encrypted y (target)
          * and encrypted theta (weights).
@@ -345,6 +410,17 @@ namespace ophelib {
              */
             typedef std::function< Vec<Ciphertext> (Vec<Ciphertext>, Integer)> client_callback_t;
 
+            /**
+             * Type for client callback, when fitting on packed ciphertexts.
+             * Arguments:
+             * - PackedCiphertext vector, dividends
+             * - Plaintext, divisor
+             *
+             * Should return
+             *   encrypt(decrypt_pack(arg1) / (arg2));
+             */
+            typedef std::function< Vec<Ciphertext> (Vec<PackedCiphertext>, Integer)> packed_client_callback_t;
+
         private:
 
             /**
@@ -353,6 +429,22 @@ namespace ophelib {
              */
             const client_callback_t client_callback;
 
+            /**
+             * Same for packed ciphertexts
+             */
+            const packed_client_callback_t packed_client_callback;
+
+            /**
+             * Paillier pubkey instance, needed for the packed fit
+             */
+            const std::shared_ptr<const PaillierFast> paillier;
+
+            /**
+             * Solve the normal equation, used by fit()
+             * @param b sum of all rows of B
+             */
+            void fit_sum(const Mat<float> &X, const Mat<float> &X_t, const Vec<Ciphertext> &b);
+
             /**
              * Integerizer which will be used for X
              */
@@ -376,6 +468,18 @@ namespace ophelib {
              */
             LinregPlainEncUsers(const client_callback_t &client_callback, const Vector::Integerizer &inter);
 
+            /**
+             * Initialize a new linear regressor, which is fitted on packed
+             * ciphertexts as generated by client_preprocess_packed().
+             *
+             * @param packed_client_callback Callback, implemented by client, which does division.
+             *        Will get called only once during fit.
+             * @param inter Integerizer which was used for y
+             *        will be used for integerizing (X^T * X)^-1 * X^T
+             * @param pubkey needed for multiplying packed ciphertexts
+             */
+            LinregPlainEncUsers(const packed_client_callback_t &packed_client_callback, const Vector::Integerizer &inter, const PublicKey &pubkey);
+
             /**
              * Train.
              * @param X features and is a n_feature x n_samples matrix. Must
@@ -385,6 +489,24 @@ namespace ophelib {
             void fit(const Mat<float> &X, const Mat<Ciphertext> &B);
             void fit(const Mat<float> &X, const Mat<float> &X_t, const Mat<Ciphertext> &B);
 
+            /**
+             * Train on packed ciphertexts, the sum over all samples is done
+             * slot-wise, so there is one addition per pack instead of one per
+             * value. Needs the packed client callback.
+             * @param X features, see above
+             * @param B encrypted values as generated by client_preprocess_packed.
+             */
+            void fit(const Mat<float> &X, const Mat<PackedCiphertext> &B);
+            void fit(const Mat<float> &X, const Mat<float> &X_t, const Mat<PackedCiphertext> &B);
+
+            /**
+             * Train on the contributions of all users, see UsersAggregator.
+             * @param X features, see above
+             * @param users rows of client_preprocess(), added one at a time
+             */
+            void fit(const Mat<float> &X, const UsersAggregator &users);
+            void fit(const Mat<float> &X, const Mat<float> &X_t, const UsersAggregator &users);
+
             /**
              * Predict target values from feature matrix
              * @return Predicted values
@@ -405,11 +527,36 @@ namespace ophelib {
              */
             static Mat<Ciphertext> client_preprocess(const Mat<float> &X, const Vec<float> &y, const Vector::Integerizer &inter, const PaillierBase &paillier);
 
+            /**
+             * Same as client_preprocess(), but every row of B is packed, which
+             * saves about a factor of pack_count() in encryption time and
+             * upload size.
+             *
+             * All clients have to use the same n_bits and headroom_bits.
+             * The headroom has to cover the sum over all samples and the
+             * product with (X^T * X)^-1 in fit(): at least log2(n_samples) +
+             * bits of the integerized (X^T * X)^-1 + log2(n_features) + 1,
+             * fit() throws if it is too small.
+             *
+             * Every pack holds at most half of pack_count() plaintexts, so
+             * the product can be done on the packs, see Vector::dot().
+             *
+             * @param n_bits maximum bit size of the integerized X[i] * y[i]
+             * @param headroom_bits extra bits per slot, see above
+             */
+            static Mat<PackedCiphertext> client_preprocess_packed(const Mat<float> &X, const Vec<float> &y, const Vector::Integerizer &inter, const size_t n_bits, const size_t headroom_bits, const PaillierBase &paillier);
+
             /**
              * Helper function to construct the client callback
              * function
              */
             static const client_callback_t construct_client_callback(const PaillierBase &paillier);
+
+            /**
+             * Helper function to construct the packed client callback
+             * function
+             */
+            static const packed_client_callback_t construct_packed_client_callback(const PaillierBase &paillier);
         };
 
         /**
@@ -471,11 +618,24 @@ namespace ophelib {
 
             /**
              * Implements gradient descent, used by fit()
-             * @param AA -sum of all Ai
-             * @param bb sum of all bi
+             * @param error computes bb + AA * theta for the current theta,
+             *        where AA and bb are the sums of all Ai and bi, packed
+             *        for the client callback
              * @return computed weight vector theta
              */
-            Vec<Integer> gradient_descent(const Mat<Ciphertext> &AA, const Vec<Ciphertext> bb);
+            Vec<Integer> gradient_descent(const std::function< Vec<PackedCiphertext> (const Vec<Integer>&)> &error);
+
+            /**
+             * Divisor of the error in every gradient descent step
+             */
+            Integer step_divisor() const;
+
+            /**
+             * Gradient descent on the sums, used by fit()
+             * @param AA sum of all Ai
+             * @param bb sum of all bi
+             */
+            size_t fit_sums(const SymmetricCiphertextMatrix &AA, const Vec<Ciphertext> &bb);
 
         public:
             /**
@@ -506,14 +666,58 @@ namespace ophelib {
              */
             static Mat<Ciphertext> client_preprocess_b(const Mat<Integer> &X, const Vec<Integer> &y, const PaillierBase &paillier);
 
+            /**
+             * Same as client_preprocess_A(), but every Ai is stored as
+             * SymmetricCiphertextMatrix, so only the upper triangle
+             * is encrypted, uploaded and summed.
+             * @param X features, normalized and integerized
+             * @return A to pass to fit()
+             */
+            static Vec<SymmetricCiphertextMatrix> client_preprocess_A_symmetric(const Mat<Integer> &X, const PaillierBase &paillier);
+
+            /**
+             * Packed variants of client_preprocess_A() and client_preprocess_b().
+             * Every row of Ai and every bi is packed, which saves about a factor
+             * of pack_count() in encryption time, upload size and additions
+             * on the server.
+             *
+             * A and b of all clients have to be packed with the same n_bits and
+             * headroom_bits. The headroom has to cover the sum over all samples
+             * and the gradient descent: at least log2(n_samples) + bits of
+             * theta + log2(n_features) + 1. fit() throws if it is too small.
+             *
+             * @param n_bits maximum bit size of the entries of Ai and bi
+             * @param headroom_bits extra bits per slot, see above
+             */
+            static Vec<Mat<PackedCiphertext>> client_preprocess_A_packed(const Mat<Integer> &X, const size_t n_bits, const size_t headroom_bits, const PaillierBase &paillier);
+            static Mat<PackedCiphertext> client_preprocess_b_packed(const Mat<Integer> &X, const Vec<Integer> &y, const size_t n_bits, const size_t headroom_bits, const PaillierBase &paillier);
+
             /**
              * Train.
-             * @param A encrypted values as generated by client_preprocess_A()
+             * @param A encrypted values as generated by client_preprocess_A().
+             *        The full matrices are summed, for symmetric Ai the
+             *        overloads taking SymmetricCiphertextMatrix or a
+             *        UsersAggregator only need the upper triangles.
              * @param b encrypted values as generated by client_preprocess_b()
              * @return number of gradient descent iterations. If smaller than n_iter,
              *         this means that it converged faster than n_iter.
              */
             size_t fit(const Vec<Mat<Ciphertext>> &A, const Mat<Ciphertext> &b);
+            size_t fit(const Vec<SymmetricCiphertextMatrix> &A, const Mat<Ciphertext> &b);
+
+            /**
+             * Train on the contributions of all users, see UsersAggregator.
+             * @return number of gradient descent iterations, see above
+             */
+            size_t fit(const UsersAggregator &users);
+
+            /**
+             * Train on packed ciphertexts.
+             * @param A encrypted values as generated by client_preprocess_A_packed()
+             * @param b encrypted values as generated by client_preprocess_b_packed()
+             * @return number of gradient descent iterations, see above
+             */
+            size_t fit(const Vec<Mat<PackedCiphertext>> &A, const Mat<PackedCiphertext> &b);
 
             /**
              * Predict target values from feature matrix
@@ -16,13 +16,15 @@ namespace ophelib {
      * Conversions from to NTL/GMP number format.
      * NTL actually uses GMPs low-level representation and
      * functions internally, however does not offer a way
-     * to access those representations for import/export
-     * in any way. So the only thing we can do is to convert
-     * over string representation.
+     * to access those representations directly. So numbers
+     * are converted over their little endian byte representation
+     * (BytesFromZZ/ZZFromBytes and mpz_export/mpz_import),
+     * RR over its mantissa and exponent. A thread local buffer
+     * is used for the bytes.
      */
 
     /**
-     * From NTL::RR float to Integer
+     * From NTL::RR float to Integer, rounds towards -inf
      * @param z output parameter
      * @param a input value
      */
@@ -40,5 +42,13 @@ namespace ophelib {
      * @param z output parameter
      * @param a input value
      */
+    void conv(NTL::ZZ& z, const ophelib::Integer& a);
+
+    /**
+     * From Integer to NTL::RR float. Rounded to the
+     * current RR precision.
+     * @param z output parameter
+     * @param a input value
+     */
     void conv(NTL::RR& z, const ophelib::Integer& a);
 }
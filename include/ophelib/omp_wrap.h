@@ -18,5 +18,7 @@
 #define omp_set_lock(x);
 #define omp_unset_lock(x);
 #define omp_destroy_lock(x);
+#define omp_set_num_threads(x);
+#define omp_get_max_threads() 1
 
 #endif
@@ -3,6 +3,8 @@
 #include "ophelib/vector.h"
 #include "ophelib/paillier_base.h"
 
+#include <vector>
+
 namespace ophelib {
 
     /**
@@ -20,11 +22,32 @@ namespace ophelib {
         size_t n_plaintexts;
 
         /**
-         * Size in bit of every packed plaintext
+         * Size in bit of every packed plaintext. Grows with the
+         * slot-wise operations below.
          */
         size_t plaintext_bits;
 
+        /**
+         * Width in bit of every slot, fixed when packing. At least
+         * plaintext_bits + Vector::pack_buffer, the rest is headroom
+         * for the slot-wise operations.
+         */
+        size_t slot_bits;
+
+        /**
+         * Plaintexts sit in every slot_stride-th slot, in the highest slot
+         * of each group. The slots between hold the cross terms of a
+         * product, see Vector::dot(). 1 for normal packing.
+         */
+        size_t slot_stride;
+
+        /**
+         * Slots without headroom, slot_bits = plaintext_bits + Vector::pack_buffer
+         */
         PackedCiphertext(const Ciphertext &data, const size_t n_plaintexts, const size_t plaintext_bits);
+        PackedCiphertext(Ciphertext &&data, const size_t n_plaintexts, const size_t plaintext_bits);
+        PackedCiphertext(const Ciphertext &data, const size_t n_plaintexts, const size_t plaintext_bits, const size_t slot_bits, const size_t slot_stride = 1);
+        PackedCiphertext(Ciphertext &&data, const size_t n_plaintexts, const size_t plaintext_bits, const size_t slot_bits, const size_t slot_stride = 1);
         PackedCiphertext();
 
         /**
@@ -37,11 +60,114 @@ namespace ophelib {
          */
         bool operator!=(const PackedCiphertext &input) const;
 
+        /**
+         * Slot-wise unary -
+         */
+        PackedCiphertext operator-() const &;
+        PackedCiphertext operator-() &&;
+
+        /**
+         * Slot-wise add. Both ciphertexts need the same layout
+         * (n_plaintexts, slot_bits and slot_stride), the result has one more
+         * plaintext bit. Throws if the slots could overflow, pack
+         * with headroom_bits to avoid that.
+         */
+        PackedCiphertext operator+(const PackedCiphertext &other) const &;
+        PackedCiphertext operator+(const PackedCiphertext &other) &&;
+        void operator+=(const PackedCiphertext &other);
+
+        /**
+         * Slot-wise subtract, same rules as for +
+         */
+        PackedCiphertext operator-(const PackedCiphertext &other) const &;
+        PackedCiphertext operator-(const PackedCiphertext &other) &&;
+        void operator-=(const PackedCiphertext &other);
+
+        /**
+         * Multiply every slot with the same scalar. The result has
+         * ceil(log2(|other|)) more plaintext bits, throws if the
+         * slots could overflow.
+         */
+        PackedCiphertext operator*(const Integer &other) const &;
+        PackedCiphertext operator*(const Integer &other) &&;
+        void operator*=(const Integer &other);
+
+        /**
+         * Bytes used by this ciphertext, see Ciphertext::memory_usage()
+         */
+        size_t memory_usage() const;
+
         const std::string to_string(const bool brief = true) const;
     };
 
     std::ostream& operator<<(std::ostream& stream, const PackedCiphertext& c);
 
+    /**
+     * Places plaintexts of different sizes into as few ciphertexts as
+     * possible, e.g. the fields of a record which mixes 8 bit flags with
+     * 64 bit amounts. Every field takes its bits plus Vector::pack_buffer,
+     * the fields are distributed over the packs first fit decreasing.
+     *
+     * Counterpart of the uniform plaintext_bits of PackedCiphertext, see
+     * the Vector::encrypt_pack(), Vector::pack_ciphertexts() and
+     * Vector::decrypt_pack() overloads taking a layout.
+     */
+    class PackLayout {
+    public:
+        /**
+         * Maximum bit size of every field
+         */
+        std::vector<size_t> field_bits;
+
+        /**
+         * Pack every field is placed in
+         */
+        std::vector<size_t> field_pack;
+
+        /**
+         * Offset in bit of every field inside its pack
+         */
+        std::vector<size_t> field_offset;
+
+        /**
+         * Number of packs
+         */
+        size_t n_packs;
+
+        /**
+         * Plan the layout for fields of the given sizes.
+         * @param field_bits maximum bit size of every field
+         * @param pai paillier instance, needed for determining plaintext size
+         */
+        PackLayout(const std::vector<size_t> &field_bits, const PaillierBase &pai);
+
+        /**
+         * Restore a layout, e.g. a deserialized one. Throws if fields
+         * overlap, are placed in packs >= n_packs, or if there are more
+         * packs than fields. Whether the layout fits a key is checked
+         * when it is used.
+         */
+        PackLayout(const std::vector<size_t> &field_bits, const std::vector<size_t> &field_pack, const std::vector<size_t> &field_offset, const size_t n_packs);
+        PackLayout();
+
+        /**
+         * Number of fields
+         */
+        size_t n_fields() const;
+
+        /**
+         * Fields of every pack, ordered by offset
+         */
+        std::vector< std::vector<size_t> > pack_fields() const;
+
+        bool operator==(const PackLayout &input) const;
+        bool operator!=(const PackLayout &input) const;
+
+        const std::string to_string(const bool brief = true) const;
+    };
+
+    std::ostream& operator<<(std::ostream& stream, const PackLayout& l);
+
     namespace Vector {
         /**
          * How much buffer (bits) to add in front of each number
@@ -53,11 +179,36 @@ namespace ophelib {
          * How many plaintexts of a given size can be fit into a single packed
          * ciphertext. Use this to determine the max size of the vector you pass to
          * encrypt_pack().
+         *
+         * Every slot is plaintext_bits + pack_buffer bits wide. Unpacking reads
+         * each slot once from the decrypted number, so it is linear in the
+         * plaintext size for any slot width. If the slots are a multiple of the
+         * limb size (see aligned_plaintext_bits()), a slot is read with a plain
+         * limb copy instead of a shift and mask. That is cheaper per slot, but
+         * fits fewer slots: for a 2048 bit key, 10 bit plaintexts fit 186
+         * slots, aligned to 64 bits only 31. Decryption costs far more than
+         * unpacking, so the aligned layout only pays off for wide plaintexts
+         * which lose few slots by rounding up.
+         *
+         * headroom_bits widens every slot, so that the slot-wise operations
+         * of PackedCiphertext have room to grow. Summing n packs needs
+         * ceil(log2(n)) bits of headroom.
          * @param plaintext_bits Maximum bit size of every plaintext Integer
          *                       which will later be passed to encrypt_pack()
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot for slot-wise operations
+         */
+        size_t pack_count(const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
+
+        /**
+         * Smallest plaintext size >= plaintext_bits for which the slots of a
+         * packed ciphertext are aligned to limb boundaries (GMP_NUMB_BITS).
+         * Pass the result as plaintext_bits, together with the same
+         * headroom_bits, to the packing functions to use the aligned layout,
+         * see pack_count().
+         * @param headroom_bits extra bits per slot, see pack_count()
          */
-        size_t pack_count(const size_t plaintext_bits, const PaillierBase &pai);
+        size_t aligned_plaintext_bits(const size_t plaintext_bits, const size_t headroom_bits = 0);
 
         /**
          * Pack multiple ciphertexts into a single one.
@@ -67,8 +218,9 @@ namespace ophelib {
          * @param plaintext_bits how many (plaintext) bits each ciphertext contains
          *        at max
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot, see pack_count()
          */
-        PackedCiphertext pack_ciphertexts(const Ciphertext *ciphertexts_begin, const Ciphertext *ciphertexts_end, const size_t plaintext_bits, const PaillierBase &pai);
+        PackedCiphertext pack_ciphertexts(const Ciphertext *ciphertexts_begin, const Ciphertext *ciphertexts_end, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
 
         /**
          * Pack multiple ciphertexts into a single one.
@@ -76,8 +228,9 @@ namespace ophelib {
          * @param plaintext_bits how many (plaintext) bits each ciphertext contains
          *        at max
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot, see pack_count()
          */
-        PackedCiphertext pack_ciphertexts(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai);
+        PackedCiphertext pack_ciphertexts(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
 
         /**
          * Pack a vector of ciphertexts into a vector of packed plaintexts.
@@ -85,12 +238,13 @@ namespace ophelib {
          * @param plaintext_bits how many (plaintext) bits each ciphertext contains
          *        at max
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot, see pack_count()
          *
          * The difference to pack_ciphertexts() is that this function supports
          * arbitrary length vectors. This means it will split the input vector
          * into chunks which each fit into a packed ciphertext.
          */
-        Vec<PackedCiphertext> pack_ciphertexts_vec(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai);
+        Vec<PackedCiphertext> pack_ciphertexts_vec(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
 
         /**
          * Encrypt a vector of plaintexts packed in a single ciphertext.
@@ -100,8 +254,9 @@ namespace ophelib {
          * @param plaintext_bits maximum bit size each plaintext has
          *        (determined by `plaintexts[i].size_bits()`).
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot, see pack_count()
          */
-        PackedCiphertext encrypt_pack(const Integer *plaintexts_begin, const Integer *plaintexts_end, const size_t plaintext_bits, const PaillierBase &pai);
+        PackedCiphertext encrypt_pack(const Integer *plaintexts_begin, const Integer *plaintexts_end, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
 
         /**
          * Encrypt a vector of plaintexts packed in a single ciphertext.
@@ -109,8 +264,9 @@ namespace ophelib {
          * @param plaintext_bits maximum bit size each plaintext has
          *        (determined by `plaintexts[i].size_bits()`).
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot, see pack_count()
          */
-        PackedCiphertext encrypt_pack(const Vec<Integer> &plaintexts, const size_t plaintext_bits, const PaillierBase &pai);
+        PackedCiphertext encrypt_pack(const Vec<Integer> &plaintexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
 
         /**
          * Encrypt a vector of plaintexts into a vector of packed plaintexts.
@@ -118,6 +274,7 @@ namespace ophelib {
          * @param plaintext_bits maximum bit size each plaintext has
          *        (determined by `plaintexts[i].size_bits()`).
          * @param pai paillier instance, needed for determining plaintext size
+         * @param headroom_bits extra bits per slot, see pack_count()
          *
          * The difference to encrypt_pack() is that this function supports arbitrary
          * length vectors. This means it will split the plaintext vector
@@ -130,7 +287,7 @@ namespace ophelib {
          * in time series data. However if we wrapped the size information into the encrypted
          * value too, this could be avoided and possible some space be saved.
          */
-        Vec<PackedCiphertext> encrypt_pack_vec(const Vec<Integer> &plaintexts, const size_t plaintext_bits, const PaillierBase &pai);
+        Vec<PackedCiphertext> encrypt_pack_vec(const Vec<Integer> &plaintexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits = 0);
 
         /**
          * Decrypt packed ciphertext and put results in the plaintext vector.
@@ -187,5 +344,64 @@ namespace ophelib {
          *        maximally contains
          */
         Mat<Integer> decrypt_fast(const Mat<Ciphertext> &cipher, const PaillierBase &pai, const size_t plaintext_bits);
+
+        /**
+         * Slot-wise sum of packed ciphertexts with the same layout, e.g.
+         * packed uploads of many clients. One homomorphic addition per pack.
+         * The result has ceil(log2(n)) more plaintext bits, throws if the
+         * slots could overflow.
+         */
+        PackedCiphertext sum(const Vec<PackedCiphertext> &v);
+
+        /**
+         * Product W x of a plaintext matrix and an encrypted vector, with x
+         * and the result packed. Costs one scalar multiplication per pair of
+         * input and output pack, and the result needs one decryption per
+         * output pack instead of one per row.
+         *
+         * Multiplying a pack with a scalar convolves the slots of both. The
+         * scalar for every row holds the weights in reverse, so that the dot
+         * product lands in one slot and the cross terms in the slots around
+         * it. The result has slot_stride = x[0].n_plaintexts, so each pack
+         * fits about plaintext size / (slot_bits * slot_stride) rows:
+         * shorter input packs give denser results. The decrypting party sees
+         * the cross terms too, so this leaks more about W than W x itself.
+         *
+         * The result slots must hold x_bits + ceil(log2(max |W|)) +
+         * ceil(log2(x length)) bits, pack x with that much headroom.
+         * Decoding is cheapest with limb aligned slots, see
+         * aligned_plaintext_bits().
+         * @param W plaintext matrix, W.NumCols() has to match the total
+         *        number of plaintexts in x
+         * @param x packed vector, all packs with the same slot_bits, slot_stride 1,
+         *        and at most x[0].n_plaintexts plaintexts
+         * @param pai paillier instance, needed for determining plaintext size
+         */
+        Vec<PackedCiphertext> dot(const Mat<Integer> &W, const Vec<PackedCiphertext> &x, const PaillierBase &pai);
+
+        /**
+         * Encrypt the fields of a record, packed as planned by the layout.
+         * @param fields one plaintext per field of the layout
+         * @param layout see PackLayout
+         * @param pai paillier instance used for encryption
+         * @return one ciphertext per pack of the layout
+         */
+        Vec<Ciphertext> encrypt_pack(const Vec<Integer> &fields, const PackLayout &layout, const PaillierBase &pai);
+
+        /**
+         * Pack already encrypted fields as planned by the layout.
+         * @param fields one ciphertext per field of the layout
+         * @param layout see PackLayout
+         * @param pai paillier instance, needed for determining plaintext size
+         * @return one ciphertext per pack of the layout
+         */
+        Vec<Ciphertext> pack_ciphertexts(const Vec<Ciphertext> &fields, const PackLayout &layout, const PaillierBase &pai);
+
+        /**
+         * Decrypt packs made with a layout and return the fields.
+         * Counterpart to the layout versions of encrypt_pack() and
+         * pack_ciphertexts().
+         */
+        Vec<Integer> decrypt_pack(const Vec<Ciphertext> &packs, const PackLayout &layout, const PaillierBase &pai);
     }
 }
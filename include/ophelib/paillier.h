@@ -36,6 +36,8 @@ namespace ophelib {
         Integer decrypt(const Ciphertext &ciphertext) const;
         Ciphertext encrypt(const Integer &plaintext) const;
 
+        size_t memory_usage() const;
+
         const std::string to_string(const bool brief = true) const;
     };
 
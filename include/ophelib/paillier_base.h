@@ -6,9 +6,71 @@
 
 #include <memory>
 #include <vector>
+#include <cstdint>
 
 namespace ophelib {
 
+    /**
+     * Everything needed to operate on ciphertexts of a given key:
+     * the modulus n^2, the FastMod instance (if any) and a fingerprint
+     * of n^2.
+     *
+     * Instances are owned by the Paillier class which created them,
+     * ciphertexts only keep a plain (non owning) pointer. So copying
+     * a ciphertext does not touch any reference counts.
+     */
+    class KeyContext {
+    public:
+        const std::shared_ptr<Integer> n2_shared;
+        const std::shared_ptr<FastMod> fast_mod;
+
+        /**
+         * 64 bit hash of n^2. Two contexts with the same fingerprint
+         * are considered to belong to the same key, so checking if
+         * ciphertexts are compatible does not need to compare n^2.
+         */
+        const uint64_t fingerprint;
+
+        KeyContext(const std::shared_ptr<Integer> &n2_shared, const std::shared_ptr<FastMod> &fast_mod = nullptr);
+
+        const Integer &n2() const;
+
+        /**
+         * Bytes used by this context, including n^2 and the
+         * FastMod instance.
+         */
+        size_t memory_usage() const;
+
+        /**
+         * Check if two key handles belong to the same key. This is
+         * O(1), the fingerprints are compared if the pointers differ.
+         * A nullptr is only compatible with another nullptr.
+         */
+        static bool same_key(const KeyContext *a, const KeyContext *b);
+
+        static uint64_t compute_fingerprint(const Integer &n2);
+
+        /**
+         * Get a context for n2_shared and fast_mod which is owned by a
+         * process wide registry and never freed. There is one context
+         * per key (and per with/without fast_mod), so calling this
+         * repeatedly for the same key does not grow the registry.
+         *
+         * Only meant for code which has the shared pointers but no
+         * Paillier instance, like the deprecated wire deserialize
+         * overloads. Prefer PaillierBase::get_key_context().
+         */
+        static const KeyContext *intern(const std::shared_ptr<Integer> &n2_shared, const std::shared_ptr<FastMod> &fast_mod = nullptr);
+    };
+
+    /* In-place arithmetic modulo n^2 of a key, see mul_mod(Integer&, ...).
+     * pow_mod uses the FastMod instance (CRT) if the context has one. */
+    void mul_mod(Integer &dst, const Integer &a, const Integer &b, const KeyContext &ctx);
+    void sqr_mod(Integer &dst, const Integer &a, const KeyContext &ctx);
+    void div_mod(Integer &dst, const Integer &a, const Integer &b, const KeyContext &ctx);
+    void inv_mod(Integer &dst, const Integer &a, const KeyContext &ctx);
+    void pow_mod(Integer &dst, const Integer &base, const Integer &exp, const KeyContext &ctx);
+
     /**
      * An encrypted Integer value
      */
@@ -20,20 +82,16 @@ namespace ophelib {
         Integer data;
 
         /**
-         * Shared pointer to the modulus, so we can do operations
-         * without need for the Paillier class.
+         * Handle to the key context (modulus, FastMod), so we can do
+         * operations without need for the Paillier class. Not owned,
+         * the Paillier instance which created the ciphertext has to
+         * outlive it. nullptr if the ciphertext is not bound to a key,
+         * e.g. after deserialization.
          */
-        std::shared_ptr<Integer> n2_shared;
+        const KeyContext *key;
 
-        /**
-         * Shared pointer to the FastMod. An instance is tied to a
-         * specific modulus (n^2), so it makes sense to keep one around
-         * for every pub/priv key.
-         */
-        std::shared_ptr<FastMod> fast_mod;
-
-        Ciphertext(const Integer &data, const std::shared_ptr<Integer> &n2_shared, const std::shared_ptr<FastMod> &fast_mod);
-        Ciphertext(const Integer &data, const std::shared_ptr<Integer> &n2_shared);
+        Ciphertext(const Integer &data, const KeyContext *key);
+        Ciphertext(Integer &&data, const KeyContext *key);
         Ciphertext(const Integer &data);
         Ciphertext();
 
@@ -50,12 +108,15 @@ namespace ophelib {
         /**
          * Unary -
          */
-        Ciphertext operator-() const;
+        Ciphertext operator-() const &;
+        Ciphertext operator-() &&;
 
         /**
-         * Add ciphertexts
+         * Add ciphertexts. The rvalue versions of the binary
+         * operators work in place on the temporary.
          */
-        Ciphertext operator+(const Ciphertext &other) const;
+        Ciphertext operator+(const Ciphertext &other) const &;
+        Ciphertext operator+(const Ciphertext &other) &&;
         void operator+=(const Ciphertext &other);
 
         /**
@@ -63,15 +124,24 @@ namespace ophelib {
          * +, as we first have to negate the second ciphertext
          * and then add the two.
          */
-        Ciphertext operator-(const Ciphertext &other) const;
+        Ciphertext operator-(const Ciphertext &other) const &;
+        Ciphertext operator-(const Ciphertext &other) &&;
         void operator-=(const Ciphertext &other);
 
         /**
          * Scalar multiplication
          */
-        Ciphertext operator*(const Integer &other) const;
+        Ciphertext operator*(const Integer &other) const &;
+        Ciphertext operator*(const Integer &other) &&;
         void operator*=(const Integer &other);
 
+        /**
+         * Bytes used by this ciphertext, including the object itself.
+         * The key context is shared by many ciphertexts and is not
+         * included, see KeyContext::memory_usage().
+         */
+        size_t memory_usage() const;
+
         /**
          * String representation
          */
@@ -168,6 +238,21 @@ namespace ophelib {
         std::shared_ptr<Integer> n2_shared;
         std::shared_ptr<FastMod> fast_mod;
 
+        /**
+         * Key context handed out to ciphertexts. Contexts of
+         * previous keys (if generate_keys() was called more than
+         * once) are kept until release_retired_key_contexts(), so
+         * their ciphertexts stay valid.
+         */
+        std::shared_ptr<KeyContext> key_context;
+        std::vector<std::shared_ptr<KeyContext>> retired_key_contexts;
+
+        /**
+         * Create a new key context from n2_shared and fast_mod.
+         * Has to be called whenever one of them changes.
+         */
+        void update_key_context();
+
         /**
          * Before encryption, negative numbers will be converted to
          * positive numbers by transfering them to the space above
@@ -193,17 +278,17 @@ namespace ophelib {
 
         const PublicKey &get_pub() const;
         const PrivateKey &get_priv() const;
-        const KeyPair get_keypair() const;
+        KeyPair get_keypair() const;
 
         /**
          * Minimum value plaintext numbers to encrypt can have
          */
-        virtual const Integer plaintext_lower_boundary() const;
+        virtual Integer plaintext_lower_boundary() const;
 
         /**
          * Maximum value plaintext numbers to encrypt can have
          */
-        virtual const Integer plaintext_upper_boundary() const;
+        virtual Integer plaintext_upper_boundary() const;
 
         /**
          * How many bits a ciphertext will need at max.
@@ -226,6 +311,22 @@ namespace ophelib {
          */
         const std::shared_ptr<Integer> get_n2() const;
 
+        /**
+         * Get the key context handed to ciphertexts of this instance.
+         * Valid as long as this instance exists, and until
+         * release_retired_key_contexts() after the key changed.
+         */
+        const KeyContext *get_key_context() const;
+
+        /**
+         * Free the key contexts of previous keys. Every key change
+         * (generate_keys(), loading a key) keeps the old context
+         * alive, so ciphertexts of the old key stay usable. Call this
+         * once none of them is used anymore, otherwise an instance
+         * which rotates keys grows by one n^2 (and FastMod) per key.
+         */
+        void release_retired_key_contexts();
+
         /**
          * Generate a pub/priv keypair
          */
@@ -241,6 +342,13 @@ namespace ophelib {
          */
         virtual Ciphertext encrypt(const Integer &plaintext) const = 0;
 
+        /**
+         * Bytes used by this instance: keys, precomputed values and
+         * the key contexts, including retired ones. Shared state is
+         * counted once.
+         */
+        virtual size_t memory_usage() const;
+
         virtual const std::string to_string(const bool brief = true) const;
     };
 }
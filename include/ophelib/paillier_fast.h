@@ -47,7 +47,7 @@ namespace ophelib {
         protected:
             const PaillierFast *paillier;
             Integer g_pow_n;
-            const Integer r() const;
+            Integer r() const;
             bool precomputed = false;
 
         public:
@@ -57,7 +57,13 @@ namespace ophelib {
             /**
              * Get a random value to randomize the ciphertext with
              */
-            virtual const Integer get_noise() const;
+            virtual Integer get_noise() const;
+
+            /**
+             * Bytes used by this instance, including the object itself
+             */
+            virtual size_t memory_usage() const;
+
             virtual const std::string to_string(const bool brief = true) const;
         };
 
@@ -88,7 +94,13 @@ namespace ophelib {
              * Fill random cache
              */
             void precompute();
-            const Integer get_noise() const;
+            Integer get_noise() const;
+
+            /**
+             * Bytes used by this instance, lookup table included
+             */
+            size_t memory_usage() const;
+
             const std::string to_string(const bool brief = true) const;
         };
 
@@ -141,6 +153,12 @@ namespace ophelib {
         Ciphertext encrypt(const Integer &plaintext) const final;
         Ciphertext zero_ciphertext() const;
 
+        /**
+         * See PaillierBase::memory_usage(). Includes the
+         * randomizer lookup table.
+         */
+        size_t memory_usage() const final;
+
         const std::string to_string(const bool brief = true) const final;
     };
 }
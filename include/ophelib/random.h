@@ -2,25 +2,53 @@
 
 #include "ophelib/integer.h"
 
+#include <stdint.h>
+
 namespace ophelib {
 
     /**
-     * Random provider. Wraps GMPs mpz_urandomm(). Is implemented as a singleton,
-     * so you can't instantiate it. Get an instance via instance().
+     * Seed for a reproducible random stream, see
+     * Random(const Seed&, const uint64_t).
+     */
+    struct Seed {
+        explicit Seed(const uint64_t value): value(value) {}
+        const uint64_t value;
+    };
+
+    /**
+     * Random provider. Is a ChaCha20 based deterministic random bit
+     * generator, keyed with 256 bits from /dev/urandom. Random numbers
+     * are produced by filling GMP limbs directly from the keystream.
+     *
+     * There is one instance per thread, so it can be used from inside
+     * OpenMP loops without locking and without threads sharing state.
+     * Get the instance of the current thread via instance(). Do not
+     * pass the reference on to other threads.
+     *
+     * For reproducible output (tests, benchmarks), a generator can
+     * be constructed from a seed and a stream number instead. Every
+     * (seed, stream) pair gives an independent keystream, so e.g. one
+     * stream per matrix element gives the same matrix no matter how
+     * the work is split between threads. These are not suitable for
+     * cryptographic use, the seed is only 64 bits.
      */
     class Random {
     public:
         /**
-         * Get an instance.
+         * Get the instance of the calling thread.
          */
         static Random& instance() {
-            static Random _instance;
+            static thread_local Random _instance;
             return _instance;
         }
+        /**
+         * Deterministic generator for stream number `stream` of `seed`.
+         */
+        Random(const Seed &seed, const uint64_t stream);
         ~Random();
 
         /**
-         * Get an integer <= max.
+         * Get an integer in the interval [0, max).
          */
         Integer rand_int(const Integer &max);
 
@@ -35,11 +63,36 @@ namespace ophelib {
          * The number is guaranteed to have exactly n_bits bits.
          */
         Integer rand_prime(const size_t n_bits);
+
+        /**
+         * Get a machine word in the interval [0, max). Cheaper than
+         * rand_int() for small bounds, e.g. for lookup table indices.
+         */
+        unsigned long rand_ulong(const unsigned long max);
+
+        /**
+         * Fill a buffer with random bytes.
+         */
+        void fill(void *buf, const size_t n_bytes);
+
     private:
         Random();
         Random( const Random& ) {};
         Random & operator = (const Random &) { return *this; };
 
-        gmp_randstate_t state;
+        /**
+         * Generate the next keystream block into block
+         */
+        void refill();
+
+        uint32_t key[8];
+        uint64_t nonce;
+        uint64_t counter;
+
+        /**
+         * Current keystream block, and how many bytes of it are used up
+         */
+        unsigned char block[64];
+        size_t block_pos;
     };
 }
@@ -9,11 +9,22 @@
 #define STR_EXPAND(tok) #tok
 #define STR(tok) STR_EXPAND(tok)
 
+/**
+ * Mark a declaration as deprecated, with a message shown by the compiler
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define OPHELIB_DEPRECATED(MESSAGE) __attribute__((deprecated(MESSAGE)))
+#elif defined(_MSC_VER)
+#define OPHELIB_DEPRECATED(MESSAGE) __declspec(deprecated(MESSAGE))
+#else
+#define OPHELIB_DEPRECATED(MESSAGE)
+#endif
+
 namespace ophelib {
     /**
      * Binomial coefficient
      */
-    const Integer nCr(const Integer n_, const Integer r_);
+    Integer nCr(const Integer n_, const Integer r_);
 
     /**
      * Binomial coefficient
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "ophelib/paillier_base.h"
+#include "ophelib/divider.h"
 #include "ophelib/ntl_conv.h"
+#include "ophelib/random.h"
 
 #include <fstream>
 
@@ -155,6 +157,13 @@ namespace ophelib {
         template<typename number>
         Mat<number> operator/(const Mat<number>& a, const number& b);
 
+        /**
+         * Scalar division by a Divider, same as dividing by its
+         * divisor, without preprocessing the divisor on every call.
+         */
+        Vec<Integer> operator/(const Vec<Integer>& a, const Divider& b);
+        Mat<Integer> operator/(const Mat<Integer>& a, const Divider& b);
+
         /**
          * Scalar addition
          */
@@ -215,6 +224,38 @@ namespace ophelib {
         template<typename number>
         Mat<number> operator-(const Mat<number>& a, const Mat<number>& b);
 
+        /**
+         * Overloads for temporaries. The result is computed in place,
+         * reusing the storage of a, so no new vectors (or GMP limbs)
+         * have to be allocated.
+         */
+        template<typename number, typename scalar>
+        Vec<number> operator*(Vec<number>&& a, const scalar& b);
+
+        template<typename number, typename scalar>
+        Mat<number> operator*(Mat<number>&& a, const scalar& b);
+
+        template<typename number>
+        Vec<number> operator-(Vec<number>&& a);
+
+        template<typename number>
+        Mat<number> operator-(Mat<number>&& a);
+
+        template<typename number>
+        Vec<number> operator+(Vec<number>&& a, const Vec<number>& b);
+
+        template<typename number>
+        Mat<number> operator+(Mat<number>&& a, const Mat<number>& b);
+
+        template<typename number>
+        Vec<number> operator-(Vec<number>&& a, const Vec<number>& b);
+
+        template<typename number>
+        Mat<number> operator-(Mat<number>&& a, const Mat<number>& b);
+
+        Vec<Integer> operator/(Vec<Integer>&& a, const Divider& b);
+        Mat<Integer> operator/(Mat<Integer>&& a, const Divider& b);
+
         template<typename number>
         bool operator==(const Mat<number>& a, const Mat<number>& b);
 
@@ -299,6 +340,14 @@ namespace ophelib {
         class Integerizer {
             const Integer factor;
 
+            /**
+             * factor as double if x * factor is exact in double
+             * precision for all floats x in [-1, 1] and fits
+             * in a long, 0 otherwise. Then, transform() and
+             * inverse_transform() work with doubles instead of RR.
+             */
+            const double fast_factor;
+
         public:
             /**
              * There are two ways to initialize an Integerizer:
@@ -459,6 +508,20 @@ namespace ophelib {
          */
         Vec<Integer> rand_primes(const size_t n, const size_t n_bits);
 
+        /**
+         * Reproducible variants of the functions above. Element k
+         * (row major) is drawn from Random(seed, k), so the result
+         * only depends on the seed and not on the number of threads.
+         */
+        Mat<Integer> rand(const size_t n, const size_t m, const Integer &max, const Seed &seed);
+        Vec<Integer> rand(const size_t n, const Integer &max, const Seed &seed);
+        Mat<Integer> rand_bits(const size_t n, const size_t m, const size_t n_bits, const Seed &seed);
+        Vec<Integer> rand_bits(const size_t n, const size_t n_bits, const Seed &seed);
+        Mat<Integer> rand_bits_neg(const size_t n, const size_t m, const size_t n_bits, const Seed &seed);
+        Vec<Integer> rand_bits_neg(const size_t n, const size_t n_bits, const Seed &seed);
+        Mat<Integer> rand_primes(const size_t n, const size_t m, const size_t n_bits, const Seed &seed);
+        Vec<Integer> rand_primes(const size_t n, const size_t n_bits, const Seed &seed);
+
         /**
          * Make n x n id matrix (diagonally 1)
          */
@@ -526,5 +589,20 @@ namespace ophelib {
          * @param len of string data
          */
         void load_data_str(const char *data, const size_t len, Mat<float> &X, Vec<float> &y);
+
+        /**
+         * Bytes used by a vector: the object, its NTL buffer and the
+         * memory owned by the elements. For ciphertexts, every distinct
+         * key context referenced is counted once.
+         * Implemented for Integer, Ciphertext and PackedCiphertext.
+         */
+        template<typename number>
+        size_t memory_usage(const Vec<number> &v);
+
+        /**
+         * Bytes used by a matrix, see memory_usage(const Vec<number>&)
+         */
+        template<typename number>
+        size_t memory_usage(const Mat<number> &m);
     }
 }
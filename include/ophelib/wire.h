@@ -5,10 +5,13 @@
 #include "ophelib/packing.h"
 #include "ophelib/error.h"
 #include "ophelib/vector.h"
+#include "ophelib/ciphertext_matrix.h"
+#include "ophelib/util.h"
 
 #include "ophelib/schemas/integer_generated.h"
 #include "ophelib/schemas/ciphertext_generated.h"
 #include "ophelib/schemas/packed_ciphertext_generated.h"
+#include "ophelib/schemas/pack_layout_generated.h"
 #include "ophelib/schemas/vec_float_generated.h"
 #include "ophelib/schemas/vec_integer_generated.h"
 #include "ophelib/schemas/vec_ciphertext_generated.h"
@@ -16,6 +19,9 @@
 #include "ophelib/schemas/mat_float_generated.h"
 #include "ophelib/schemas/mat_integer_generated.h"
 #include "ophelib/schemas/mat_ciphertext_generated.h"
+#include "ophelib/schemas/flat_vec_ciphertext_generated.h"
+#include "ophelib/schemas/flat_mat_ciphertext_generated.h"
+#include "ophelib/schemas/flat_sym_mat_ciphertext_generated.h"
 #include "ophelib/schemas/public_key_generated.h"
 #include "ophelib/schemas/private_key_generated.h"
 #include "ophelib/schemas/key_pair_generated.h"
@@ -137,18 +143,32 @@ namespace ophelib {
 
     /**
      * Deserialize Ciphertext
+     *
+     * @TODO save a copy of n^2 into serialization format, so we don't have to do this (get n^2 from outside on deserializaion)
+     *
+     * @param key set in deserialized ciphertext, see PaillierBase::get_key_context()
+     */
+    void deserialize(const Wire::Ciphertext *c, Ciphertext &out, const KeyContext *key);
+
+    /**
+     * Deserialize Ciphertext
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in deserialized ciphertext
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const Wire::Ciphertext *c, Ciphertext &out, std::shared_ptr<Integer> n2_shared);
 
     /**
      * Deserialize Ciphertext
-     *
-     * @TODO save a copy of n^2 into serialization format, so we don't have to do this (get n^2 from outside on deserializaion)
-     *
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in deserialized ciphertext
      * @param fast_mod set in deserialized ciphertext
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const Wire::Ciphertext *c, Ciphertext &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod);
 
     /**
@@ -166,6 +186,21 @@ namespace ophelib {
      */
     void deserialize(const Wire::PackedCiphertext *p, PackedCiphertext &out);
 
+    /**
+     * Serialize PackLayout
+     */
+    flatbuffers::Offset<Wire::PackLayout> serialize(flatbuffers::FlatBufferBuilder &builder, const PackLayout &l);
+
+    /**
+     * Deserialize PackLayout from raw buffer
+     */
+    void deserialize(const void* buf, PackLayout &out);
+
+    /**
+     * Deserialize PackLayout
+     */
+    void deserialize(const Wire::PackLayout *l, PackLayout &out);
+
     /**
      * Serialize Vec<float>
      */
@@ -213,28 +248,56 @@ namespace ophelib {
 
     /**
      * Deserialize Vec<Ciphertext>
+     * @param key set in all deserialized ciphertexts
+     */
+    void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, const KeyContext *key);
+
+    /**
+     * Deserialize Vec<Ciphertext>
+     * @param key set in all deserialized ciphertexts
+     */
+    void deserialize(const void* buf, Vec<Ciphertext> &out, const KeyContext *key);
+
+    /**
+     * Deserialize Vec<Ciphertext>
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in all deserialized ciphertexts
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared);
 
     /**
      * Deserialize Vec<Ciphertext>
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in all deserialized ciphertexts
      * @param fast_mod set in all deserialized ciphertexts
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod);
 
     /**
      * Deserialize Vec<Ciphertext>
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in all deserialized ciphertexts
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const void* buf, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared);
 
     /**
      * Deserialize Vec<Ciphertext>
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in all deserialized ciphertexts
      * @param fast_mod set in all deserialized ciphertexts
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const void* buf, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod);
 
     /**
@@ -299,17 +362,118 @@ namespace ophelib {
 
     /**
      * Deserialize Mat<Ciphertext>
+     * @param key set in all deserialized ciphertexts
+     */
+    void deserialize(const Wire::MatCiphertext *mat, Mat<Ciphertext> &out, const KeyContext *key);
+
+    /**
+     * Deserialize Mat<Ciphertext>
+     * @param key set in all deserialized ciphertexts
+     */
+    void deserialize(const void* buf, Mat<Ciphertext> &out, const KeyContext *key);
+
+    /**
+     * Deserialize Mat<Ciphertext>
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in all deserialized ciphertexts
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const Wire::MatCiphertext *mat, Mat<Ciphertext> &out, std::shared_ptr<Integer> n2_shared);
 
     /**
      * Deserialize Mat<Ciphertext>
+     * @deprecated ciphertexts keep a KeyContext handle now, use the
+     *             overload taking PaillierBase::get_key_context().
+     *             The shared pointers are wrapped with KeyContext::intern().
      * @param n2_shared set in all deserialized ciphertexts
      * @param fast_mod set in all deserialized ciphertexts
      */
+    OPHELIB_DEPRECATED("use the overload taking a KeyContext")
     void deserialize(const Wire::MatCiphertext *mat, Mat<Ciphertext> &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod);
 
+    /**
+     * Serialize CiphertextVector
+     */
+    flatbuffers::Offset<Wire::FlatVecCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const CiphertextVector &v);
+
+    /**
+     * Deserialize CiphertextVector from raw buffer
+     */
+    void deserialize(const void* buf, CiphertextVector &out);
+
+    /**
+     * Deserialize CiphertextVector
+     */
+    void deserialize(const Wire::FlatVecCiphertext *v, CiphertextVector &out);
+
+    /**
+     * Deserialize CiphertextVector
+     * @param key set in the deserialized container
+     */
+    void deserialize(const Wire::FlatVecCiphertext *v, CiphertextVector &out, const KeyContext *key);
+
+    /**
+     * Deserialize CiphertextVector from raw buffer
+     * @param key set in the deserialized container
+     */
+    void deserialize(const void* buf, CiphertextVector &out, const KeyContext *key);
+
+    /**
+     * Serialize CiphertextMatrix
+     */
+    flatbuffers::Offset<Wire::FlatMatCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const CiphertextMatrix &mat);
+
+    /**
+     * Deserialize CiphertextMatrix from raw buffer
+     */
+    void deserialize(const void* buf, CiphertextMatrix &out);
+
+    /**
+     * Deserialize CiphertextMatrix
+     */
+    void deserialize(const Wire::FlatMatCiphertext *mat, CiphertextMatrix &out);
+
+    /**
+     * Deserialize CiphertextMatrix
+     * @param key set in the deserialized container
+     */
+    void deserialize(const Wire::FlatMatCiphertext *mat, CiphertextMatrix &out, const KeyContext *key);
+
+    /**
+     * Deserialize CiphertextMatrix from raw buffer
+     * @param key set in the deserialized container
+     */
+    void deserialize(const void* buf, CiphertextMatrix &out, const KeyContext *key);
+
+    /**
+     * Serialize SymmetricCiphertextMatrix
+     */
+    flatbuffers::Offset<Wire::FlatSymMatCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const SymmetricCiphertextMatrix &mat);
+
+    /**
+     * Deserialize SymmetricCiphertextMatrix from raw buffer
+     */
+    void deserialize(const void* buf, SymmetricCiphertextMatrix &out);
+
+    /**
+     * Deserialize SymmetricCiphertextMatrix
+     */
+    void deserialize(const Wire::FlatSymMatCiphertext *mat, SymmetricCiphertextMatrix &out);
+
+    /**
+     * Deserialize SymmetricCiphertextMatrix
+     * @param key set in the deserialized container
+     */
+    void deserialize(const Wire::FlatSymMatCiphertext *mat, SymmetricCiphertextMatrix &out, const KeyContext *key);
+
+    /**
+     * Deserialize SymmetricCiphertextMatrix from raw buffer
+     * @param key set in the deserialized container
+     */
+    void deserialize(const void* buf, SymmetricCiphertextMatrix &out, const KeyContext *key);
+
     /**
      * Serialize PublicKey
      */
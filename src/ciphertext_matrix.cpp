@@ -0,0 +1,773 @@
+#include "ophelib/ciphertext_matrix.h"
+#include "ophelib/error.h"
+#include "ophelib/omp_wrap.h"
+#include "ophelib/memory.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace ophelib {
+
+    namespace {
+        /**
+         * Elements are padded to a multiple of this
+         */
+        const size_t cache_line_bytes = 64;
+        const size_t cache_line_limbs = cache_line_bytes / sizeof(mp_limb_t);
+
+        void check_same_key(const KeyContext *a, const KeyContext *b) {
+            if(!a || !b)
+                error_exit("no modulus set!");
+            if(!KeyContext::same_key(a, b))
+                error_exit("cannot operate on ciphertexts from different keys!");
+        }
+
+        /**
+         * dst = element k of a, raised to e (homomorphic scalar multiplication)
+         */
+        void pow_element(Integer &dst, const CiphertextArray &a, const size_t k, const Integer &e) {
+            mpz_t tmp;
+            mpz_set(dst.get_mpz_t(), a.view(k, tmp));
+            pow_mod(dst, dst, e, *a.key);
+        }
+
+        /**
+         * acc = acc * element k of a mod n^2 (homomorphic addition)
+         */
+        void mul_element(Integer &acc, const CiphertextArray &a, const size_t k) {
+            mpz_t tmp;
+            mpz_mul(acc.get_mpz_t(), acc.get_mpz_t(), a.view(k, tmp));
+            mpz_mod(acc.get_mpz_t(), acc.get_mpz_t(), a.key->n2().get_mpz_t());
+        }
+
+        /**
+         * Pack elements [begin, end) of a, see Vector::pack_ciphertexts()
+         */
+        PackedCiphertext pack_elements(const CiphertextArray &a, const size_t begin, const size_t end, const size_t plaintext_bits, const PaillierBase &pai) {
+            const size_t shift = plaintext_bits + Vector::pack_buffer;
+            const size_t n_ciphertexts = end - begin;
+            if(n_ciphertexts < 1)
+                error_exit("not enough ciphertexts!");
+            if(n_ciphertexts > Vector::pack_count(plaintext_bits, pai))
+                error_exit("too many ciphertexts!");
+
+            /* With the private key, the whole chain runs mod p^2 and q^2 */
+            if(a.key->fast_mod) {
+                std::vector<__mpz_struct> views(n_ciphertexts);
+                std::vector<mpz_srcptr> xs(n_ciphertexts);
+                for(size_t k = 0; k < n_ciphertexts; k++)
+                    xs[k] = a.view(begin + k, &views[k]);
+
+                Ciphertext sum(Integer(), a.key);
+                a.key->fast_mod->horner_pow2_n2(sum.data, xs, shift);
+                return PackedCiphertext(std::move(sum), n_ciphertexts, plaintext_bits);
+            }
+
+            const Integer mul = Integer(1) << shift;
+
+            Ciphertext sum = a.at(begin);
+            for(size_t k = begin + 1; k < end; k++) {
+                pow_mod(sum.data, sum.data, mul, *a.key);
+                mul_element(sum.data, a, k);
+            }
+
+            return PackedCiphertext(std::move(sum), n_ciphertexts, plaintext_bits);
+        }
+    }
+
+    void CiphertextArray::LimbDeleter::operator()(mp_limb_t *p) const {
+        track_live_bytes(-(int64_t) bytes);
+        free(p);
+    }
+
+    CiphertextArray::CiphertextArray()
+            : n_elements(0),
+              width(0),
+              stride(0),
+              key(nullptr) { }
+
+    CiphertextArray::CiphertextArray(const size_t n_elements_, const KeyContext *key_)
+            : CiphertextArray(n_elements_,
+                              key_ ? mpz_size(key_->n2().get_mpz_t()) : 0,
+                              key_) {
+        if(!key)
+            error_exit("no modulus set!");
+    }
+
+    CiphertextArray::CiphertextArray(const size_t n_elements_, const size_t width_, const KeyContext *key_)
+            : n_elements(n_elements_),
+              width(width_),
+              stride((width_ + cache_line_limbs - 1) / cache_line_limbs * cache_line_limbs),
+              key(key_) {
+        allocate();
+    }
+
+    CiphertextArray::CiphertextArray(const CiphertextArray &other)
+            : n_elements(other.n_elements),
+              width(other.width),
+              stride(other.stride),
+              key(other.key) {
+        allocate();
+        if(limbs)
+            memcpy(limbs.get(), other.limbs.get(), memory_usage());
+    }
+
+    CiphertextArray::CiphertextArray(CiphertextArray &&other)
+            : n_elements(other.n_elements),
+              width(other.width),
+              stride(other.stride),
+              limbs(std::move(other.limbs)),
+              key(other.key) {
+        other.n_elements = 0;
+    }
+
+    CiphertextArray &CiphertextArray::operator=(const CiphertextArray &other) {
+        if(this != &other) {
+            CiphertextArray tmp(other);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    CiphertextArray &CiphertextArray::operator=(CiphertextArray &&other) {
+        n_elements = other.n_elements;
+        width = other.width;
+        stride = other.stride;
+        limbs = std::move(other.limbs);
+        key = other.key;
+        other.n_elements = 0;
+        return *this;
+    }
+
+    void CiphertextArray::allocate() {
+        const size_t n_bytes = memory_usage();
+        if(n_bytes == 0) {
+            limbs.reset();
+            return;
+        }
+
+        void *p = nullptr;
+        if(posix_memalign(&p, cache_line_bytes, n_bytes) != 0)
+            error_exit("could not allocate ciphertext storage");
+        memset(p, 0, n_bytes);
+        limbs = std::unique_ptr<mp_limb_t[], LimbDeleter>((mp_limb_t *) p, LimbDeleter{n_bytes});
+        track_live_bytes(n_bytes);
+    }
+
+    mp_limb_t *CiphertextArray::element(const size_t i) {
+        return limbs.get() + i * stride;
+    }
+
+    const mp_limb_t *CiphertextArray::element(const size_t i) const {
+        return limbs.get() + i * stride;
+    }
+
+    void CiphertextArray::add_elements(const CiphertextArray &other) {
+        if(n_elements != other.n_elements)
+            dimension_mismatch();
+        check_same_key(key, other.key);
+
+        const long n = n_elements;
+        #pragma omp parallel for schedule(static)
+        for(long k = 0; k < n; k++) {
+            mpz_t tmp;
+            Integer acc;
+            mpz_set(acc.get_mpz_t(), view(k, tmp));
+            mul_element(acc, other, k);
+            set_data(k, acc);
+        }
+    }
+
+    size_t CiphertextArray::limbs_per_element() const {
+        return width;
+    }
+
+    size_t CiphertextArray::memory_usage() const {
+        return n_elements * stride * sizeof(mp_limb_t);
+    }
+
+    size_t CiphertextArray::size() const {
+        return n_elements;
+    }
+
+    const mp_limb_t *CiphertextArray::data() const {
+        return limbs.get();
+    }
+
+    size_t CiphertextArray::element_stride() const {
+        return stride;
+    }
+
+    mpz_srcptr CiphertextArray::view(const size_t i, mpz_ptr tmp) const {
+        if(i >= n_elements)
+            error_exit("index out of range");
+
+        /* mpz_roinit_n normalizes the size, so the zero padding
+           in the high limbs does not matter */
+        return mpz_roinit_n(tmp, element(i), (mp_size_t) width);
+    }
+
+    Ciphertext CiphertextArray::at(const size_t i) const {
+        mpz_t tmp;
+        Integer data;
+        mpz_set(data.get_mpz_t(), view(i, tmp));
+        return Ciphertext(data, key);
+    }
+
+    void CiphertextArray::set_data(const size_t i, const Integer &data) {
+        if(i >= n_elements)
+            error_exit("index out of range");
+        if(data < 0)
+            error_exit("ciphertext data must not be negative");
+
+        const size_t size = mpz_size(data.get_mpz_t());
+        if(size > width)
+            error_exit("ciphertext too large for this container");
+
+        mp_limb_t *dst = element(i);
+        if(size > 0)
+            memcpy(dst, mpz_limbs_read(data.get_mpz_t()), size * sizeof(mp_limb_t));
+        memset(dst + size, 0, (width - size) * sizeof(mp_limb_t));
+    }
+
+    CiphertextVector::CiphertextVector() { }
+
+    CiphertextVector::CiphertextVector(const size_t n, const KeyContext *key_)
+            : CiphertextArray(n, key_) { }
+
+    CiphertextVector::CiphertextVector(const size_t n, const size_t width_, const KeyContext *key_)
+            : CiphertextArray(n, width_, key_) { }
+
+    CiphertextVector::CiphertextVector(const Vec<Ciphertext> &v) {
+        const long n = v.length();
+        if(n == 0)
+            return;
+
+        *this = CiphertextVector(n, v[0].key);
+        for(long i = 0; i < n; i++) {
+            check_same_key(key, v[i].key);
+            set_data(i, v[i].data);
+        }
+    }
+
+    long CiphertextVector::length() const {
+        return n_elements;
+    }
+
+    Ciphertext CiphertextVector::get(const size_t i) const {
+        return at(i);
+    }
+
+    void CiphertextVector::set(const size_t i, const Ciphertext &c) {
+        check_same_key(key, c.key);
+        set_data(i, c.data);
+    }
+
+    Vec<Ciphertext> CiphertextVector::to_vec() const {
+        Vec<Ciphertext> ret;
+        const long n = n_elements;
+        ret.SetLength(n);
+        #pragma omp parallel for
+        for(long i = 0; i < n; i++) {
+            ret[i] = at(i);
+        }
+        return ret;
+    }
+
+    CiphertextVector &CiphertextVector::operator+=(const CiphertextVector &other) {
+        add_elements(other);
+        return *this;
+    }
+
+    bool CiphertextVector::operator==(const CiphertextVector &other) const {
+        if(n_elements != other.n_elements)
+            return false;
+        mpz_t a, b;
+        for(size_t i = 0; i < n_elements; i++) {
+            if(mpz_cmp(view(i, a), other.view(i, b)) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool CiphertextVector::operator!=(const CiphertextVector &other) const {
+        return !(*this == other);
+    }
+
+    CiphertextMatrix::CiphertextMatrix()
+            : n_rows(0),
+              n_cols(0) { }
+
+    CiphertextMatrix::CiphertextMatrix(const size_t n, const size_t m, const KeyContext *key_)
+            : CiphertextArray(n * m, key_),
+              n_rows(n),
+              n_cols(m) { }
+
+    CiphertextMatrix::CiphertextMatrix(const size_t n, const size_t m, const size_t width_, const KeyContext *key_)
+            : CiphertextArray(n * m, width_, key_),
+              n_rows(n),
+              n_cols(m) { }
+
+    CiphertextMatrix::CiphertextMatrix(const Mat<Ciphertext> &m)
+            : n_rows(0),
+              n_cols(0) {
+        const long n = m.NumRows(), d = m.NumCols();
+        if(n == 0 || d == 0)
+            return;
+
+        *this = CiphertextMatrix(n, d, m[0][0].key);
+        for(long i = 0; i < n; i++) {
+            for(long j = 0; j < d; j++) {
+                check_same_key(key, m[i][j].key);
+                set_data(i * d + j, m[i][j].data);
+            }
+        }
+    }
+
+    long CiphertextMatrix::NumRows() const {
+        return n_rows;
+    }
+
+    long CiphertextMatrix::NumCols() const {
+        return n_cols;
+    }
+
+    Ciphertext CiphertextMatrix::get(const size_t i, const size_t j) const {
+        if(j >= n_cols)
+            error_exit("index out of range");
+        return at(i * n_cols + j);
+    }
+
+    void CiphertextMatrix::set(const size_t i, const size_t j, const Ciphertext &c) {
+        if(j >= n_cols)
+            error_exit("index out of range");
+        check_same_key(key, c.key);
+        set_data(i * n_cols + j, c.data);
+    }
+
+    CiphertextVector CiphertextMatrix::row(const size_t i) const {
+        if(i >= n_rows)
+            error_exit("index out of range");
+        CiphertextVector ret(n_cols, width, key);
+        if(n_cols > 0)
+            memcpy(ret.element(0), element(i * n_cols), ret.memory_usage());
+        return ret;
+    }
+
+    Mat<Ciphertext> CiphertextMatrix::to_mat() const {
+        Mat<Ciphertext> ret;
+        const long n = n_rows, d = n_cols;
+        ret.SetDims(n, d);
+        #pragma omp parallel for
+        for(long i = 0; i < n; i++) {
+            for(long j = 0; j < d; j++) {
+                ret[i][j] = at(i * d + j);
+            }
+        }
+        return ret;
+    }
+
+    bool CiphertextMatrix::operator==(const CiphertextMatrix &other) const {
+        if(n_rows != other.n_rows || n_cols != other.n_cols)
+            return false;
+        mpz_t a, b;
+        for(size_t i = 0; i < n_elements; i++) {
+            if(mpz_cmp(view(i, a), other.view(i, b)) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool CiphertextMatrix::operator!=(const CiphertextMatrix &other) const {
+        return !(*this == other);
+    }
+
+    SymmetricCiphertextMatrix::SymmetricCiphertextMatrix()
+            : n(0) { }
+
+    SymmetricCiphertextMatrix::SymmetricCiphertextMatrix(const size_t n_, const KeyContext *key_)
+            : CiphertextArray(n_ * (n_ + 1) / 2, key_),
+              n(n_) { }
+
+    SymmetricCiphertextMatrix::SymmetricCiphertextMatrix(const size_t n_, const size_t width_, const KeyContext *key_)
+            : CiphertextArray(n_ * (n_ + 1) / 2, width_, key_),
+              n(n_) { }
+
+    SymmetricCiphertextMatrix::SymmetricCiphertextMatrix(const Mat<Ciphertext> &m)
+            : n(0) {
+        const long d = m.NumRows();
+        if(d != m.NumCols())
+            dimension_mismatch();
+        if(d == 0)
+            return;
+
+        *this = SymmetricCiphertextMatrix(d, m[0][0].key);
+        for(long i = 0; i < d; i++) {
+            for(long j = i; j < d; j++) {
+                check_same_key(key, m[i][j].key);
+                set_data(index(i, j), m[i][j].data);
+            }
+        }
+    }
+
+    size_t SymmetricCiphertextMatrix::index(size_t i, size_t j) const {
+        if(i > j)
+            std::swap(i, j);
+        if(j >= n)
+            error_exit("index out of range");
+        /* rows above i hold n, n - 1, ..., n - i + 1 elements */
+        return i * n - i * (i - 1) / 2 + (j - i);
+    }
+
+    long SymmetricCiphertextMatrix::NumRows() const {
+        return n;
+    }
+
+    long SymmetricCiphertextMatrix::NumCols() const {
+        return n;
+    }
+
+    Ciphertext SymmetricCiphertextMatrix::get(const size_t i, const size_t j) const {
+        return at(index(i, j));
+    }
+
+    void SymmetricCiphertextMatrix::set(const size_t i, const size_t j, const Ciphertext &c) {
+        check_same_key(key, c.key);
+        set_data(index(i, j), c.data);
+    }
+
+    Mat<Ciphertext> SymmetricCiphertextMatrix::to_mat() const {
+        Mat<Ciphertext> ret;
+        const long d = n;
+        ret.SetDims(d, d);
+        #pragma omp parallel for
+        for(long i = 0; i < d; i++) {
+            for(long j = 0; j < d; j++) {
+                ret[i][j] = at(index(i, j));
+            }
+        }
+        return ret;
+    }
+
+    SymmetricCiphertextMatrix &SymmetricCiphertextMatrix::operator+=(const SymmetricCiphertextMatrix &other) {
+        if(n != other.n)
+            dimension_mismatch();
+        add_elements(other);
+        return *this;
+    }
+
+    SymmetricCiphertextMatrix SymmetricCiphertextMatrix::operator+(const SymmetricCiphertextMatrix &other) const {
+        SymmetricCiphertextMatrix ret = *this;
+        ret += other;
+        return ret;
+    }
+
+    SymmetricCiphertextMatrix SymmetricCiphertextMatrix::operator-() const {
+        if(!key)
+            error_exit("no modulus set!");
+
+        SymmetricCiphertextMatrix ret(n, width, key);
+        const long n_el = n_elements;
+        #pragma omp parallel for
+        for(long k = 0; k < n_el; k++) {
+            mpz_t tmp;
+            Integer x;
+            mpz_set(x.get_mpz_t(), view(k, tmp));
+            inv_mod(x, x, *key);
+            ret.set_data(k, x);
+        }
+        return ret;
+    }
+
+    bool SymmetricCiphertextMatrix::operator==(const SymmetricCiphertextMatrix &other) const {
+        if(n != other.n)
+            return false;
+        mpz_t a, b;
+        for(size_t i = 0; i < n_elements; i++) {
+            if(mpz_cmp(view(i, a), other.view(i, b)) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    bool SymmetricCiphertextMatrix::operator!=(const SymmetricCiphertextMatrix &other) const {
+        return !(*this == other);
+    }
+
+    namespace Vector {
+
+        CiphertextVector encrypt_flat(const Vec<Integer> &plain, const PaillierBase &pai) {
+            const long n = plain.length();
+            CiphertextVector ret(n, pai.get_key_context());
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                ret.set_data(i, pai.encrypt(plain[i]).data);
+            }
+            return ret;
+        }
+
+        CiphertextMatrix encrypt_flat(const Mat<Integer> &plain, const PaillierBase &pai) {
+            const long n = plain.NumRows(), d = plain.NumCols();
+            CiphertextMatrix ret(n, d, pai.get_key_context());
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < d; j++) {
+                    ret.set_data(i * d + j, pai.encrypt(plain[i][j]).data);
+                }
+            }
+            return ret;
+        }
+
+        SymmetricCiphertextMatrix encrypt_symmetric(const Mat<Integer> &plain, const PaillierBase &pai) {
+            const long d = plain.NumRows();
+            if(d != plain.NumCols())
+                dimension_mismatch();
+
+            SymmetricCiphertextMatrix ret(d, pai.get_key_context());
+            #pragma omp parallel for schedule(dynamic)
+            for(long i = 0; i < d; i++) {
+                for(long j = i; j < d; j++) {
+                    ret.set_data(ret.index(i, j), pai.encrypt(plain[i][j]).data);
+                }
+            }
+            return ret;
+        }
+
+        SymmetricCiphertextMatrix encrypt_outer(const Vec<Integer> &x, const PaillierBase &pai) {
+            const long d = x.length();
+
+            SymmetricCiphertextMatrix ret(d, pai.get_key_context());
+            #pragma omp parallel for schedule(dynamic)
+            for(long i = 0; i < d; i++) {
+                for(long j = i; j < d; j++) {
+                    ret.set_data(ret.index(i, j), pai.encrypt(x[i] * x[j]).data);
+                }
+            }
+            return ret;
+        }
+
+        Vec<Integer> decrypt(const CiphertextVector &cipher, const PaillierBase &pai) {
+            Vec<Integer> ret;
+            const long n = cipher.length();
+            ret.SetLength(n);
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                ret[i] = pai.decrypt(cipher.at(i));
+            }
+            return ret;
+        }
+
+        Mat<Integer> decrypt(const CiphertextMatrix &cipher, const PaillierBase &pai) {
+            Mat<Integer> ret;
+            const long n = cipher.NumRows(), d = cipher.NumCols();
+            ret.SetDims(n, d);
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < d; j++) {
+                    ret[i][j] = pai.decrypt(cipher.at(i * d + j));
+                }
+            }
+            return ret;
+        }
+
+        Mat<Integer> decrypt(const SymmetricCiphertextMatrix &cipher, const PaillierBase &pai) {
+            Mat<Integer> ret;
+            const long d = cipher.NumRows();
+            ret.SetDims(d, d);
+            #pragma omp parallel for schedule(dynamic)
+            for(long i = 0; i < d; i++) {
+                for(long j = i; j < d; j++) {
+                    ret[i][j] = pai.decrypt(cipher.get(i, j));
+                    ret[j][i] = ret[i][j];
+                }
+            }
+            return ret;
+        }
+
+        Ciphertext sum(const CiphertextVector &v) {
+            const long n = v.length();
+            if(n == 0)
+                error_exit("empty vector!");
+            if(!v.key)
+                error_exit("no modulus set!");
+
+            mpz_t tmp;
+            Integer acc;
+            mpz_set(acc.get_mpz_t(), v.view(0, tmp));
+            for(long i = 1; i < n; i++)
+                mul_element(acc, v, i);
+            return Ciphertext(std::move(acc), v.key);
+        }
+
+        CiphertextVector sum(const CiphertextMatrix &m, const int axis) {
+            if(axis > 1)
+                error_exit("invalid axis");
+            const long n = m.NumRows(), d = m.NumCols();
+            if(n == 0 || d == 0)
+                error_exit("empty matrix!");
+            if(!m.key)
+                error_exit("no modulus set!");
+
+            /* axis 0: sum over rows (one result per column),
+               axis 1: sum over columns (one result per row) */
+            const long n_out = axis == 0 ? d : n,
+                       n_in = axis == 0 ? n : d,
+                       step_out = axis == 0 ? 1 : d,
+                       step_in = axis == 0 ? d : 1;
+
+            CiphertextVector ret(n_out, m.limbs_per_element(), m.key);
+            omp_set_nested(0);
+            #pragma omp parallel for
+            for(long i = 0; i < n_out; i++) {
+                mpz_t tmp;
+                Integer acc;
+                mpz_set(acc.get_mpz_t(), m.view(i * step_out, tmp));
+                for(long j = 1; j < n_in; j++)
+                    mul_element(acc, m, i * step_out + j * step_in);
+                ret.set_data(i, acc);
+            }
+            return ret;
+        }
+
+        SymmetricCiphertextMatrix sum(const Vec<SymmetricCiphertextMatrix> &v) {
+            const long n = v.length();
+            if(n == 0)
+                error_exit("empty vector!");
+            if(!v[0].key)
+                error_exit("no modulus set!");
+            const long d = v[0].NumRows();
+            for(long i = 1; i < n; i++) {
+                if(v[i].NumRows() != d)
+                    dimension_mismatch();
+                check_same_key(v[0].key, v[i].key);
+            }
+
+            SymmetricCiphertextMatrix ret(d, v[0].limbs_per_element(), v[0].key);
+            const long n_el = ret.size();
+            omp_set_nested(0);
+            #pragma omp parallel for
+            for(long k = 0; k < n_el; k++) {
+                mpz_t tmp;
+                Integer acc;
+                mpz_set(acc.get_mpz_t(), v[0].view(k, tmp));
+                for(long i = 1; i < n; i++)
+                    mul_element(acc, v[i], k);
+                ret.set_data(k, acc);
+            }
+            return ret;
+        }
+
+        Ciphertext dot(const CiphertextVector &A, const Vec<Integer> &B) {
+            const long n = A.length();
+            if(n != B.length())
+                dimension_mismatch();
+            if(n == 0)
+                error_exit("empty vector");
+            if(!A.key)
+                error_exit("no modulus set!");
+
+            Integer acc, term;
+            pow_element(acc, A, 0, B[0]);
+            for(long i = 1; i < n; i++) {
+                pow_element(term, A, i, B[i]);
+                mul_mod(acc, acc, term, *A.key);
+            }
+            return Ciphertext(std::move(acc), A.key);
+        }
+
+        CiphertextVector dot(const CiphertextMatrix &A, const Vec<Integer> &B) {
+            const long n = A.NumRows(),
+                    d = A.NumCols();
+
+            if(d != B.length())
+                dimension_mismatch();
+            if(n == 0 || d == 0)
+                error_exit("empty matrix");
+            if(!A.key)
+                error_exit("no modulus set!");
+
+            CiphertextVector ret(n, A.limbs_per_element(), A.key);
+            omp_set_nested(0);
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                Integer acc, term;
+                pow_element(acc, A, i * d, B[0]);
+                for(long j = 1; j < d; j++) {
+                    pow_element(term, A, i * d + j, B[j]);
+                    mul_mod(acc, acc, term, *A.key);
+                }
+                ret.set_data(i, acc);
+            }
+            return ret;
+        }
+
+        CiphertextVector dot(const SymmetricCiphertextMatrix &A, const Vec<Integer> &B) {
+            const long d = A.NumRows();
+
+            if(d != B.length())
+                dimension_mismatch();
+            if(d == 0)
+                error_exit("empty matrix");
+            if(!A.key)
+                error_exit("no modulus set!");
+
+            CiphertextVector ret(d, A.limbs_per_element(), A.key);
+            omp_set_nested(0);
+            #pragma omp parallel for
+            for(long i = 0; i < d; i++) {
+                Integer acc, term;
+                pow_element(acc, A, A.index(i, 0), B[0]);
+                for(long j = 1; j < d; j++) {
+                    pow_element(term, A, A.index(i, j), B[j]);
+                    mul_mod(acc, acc, term, *A.key);
+                }
+                ret.set_data(i, acc);
+            }
+            return ret;
+        }
+
+        Vec<PackedCiphertext> pack_ciphertexts_vec(const CiphertextVector &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai) {
+            const size_t n = ciphertexts.length();
+            const auto plaintexts_per_pack = pack_count(plaintext_bits, pai);
+            const auto n_packs = (n + plaintexts_per_pack - 1) / plaintexts_per_pack;
+
+            Vec<PackedCiphertext> ret;
+            ret.SetLength(n_packs);
+            #pragma omp parallel for schedule(dynamic)
+            for(long i = 0; i < (long) n_packs; i++) {
+                const size_t begin = i * plaintexts_per_pack;
+                const size_t end = std::min(begin + plaintexts_per_pack, n);
+                ret[i] = pack_elements(ciphertexts, begin, end, plaintext_bits, pai);
+            }
+            return ret;
+        }
+
+        Vec<Integer> decrypt_fast(const CiphertextVector &cipher, const PaillierBase &pai, const size_t plaintext_bits) {
+            const size_t n = cipher.length();
+            const auto plaintexts_per_pack = pack_count(plaintext_bits, pai);
+            const auto n_packs = (n + plaintexts_per_pack - 1) / plaintexts_per_pack;
+
+            Vec<Integer> ret;
+            ret.SetLength(n);
+            for(size_t i = 0; i < n_packs; i++) {
+                const size_t begin = i * plaintexts_per_pack;
+                const size_t end = std::min(begin + plaintexts_per_pack, n);
+                const auto packed = pack_elements(cipher, begin, end, plaintext_bits, pai);
+                decrypt_pack(packed, ret.begin() + begin, ret.begin() + end, pai);
+            }
+            return ret;
+        }
+
+        Mat<Integer> decrypt_fast(const CiphertextMatrix &cipher, const PaillierBase &pai, const size_t plaintext_bits) {
+            Mat<Integer> ret;
+            ret.SetDims(cipher.NumRows(), cipher.NumCols());
+            #pragma omp parallel for
+            for(long i = 0; i < cipher.NumRows(); i++) {
+                ret[i] = decrypt_fast(cipher.row(i), pai, plaintext_bits);
+            }
+            return ret;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "ophelib/divider.h"
+#include "ophelib/error.h"
+
+#include <utility>
+
+namespace ophelib {
+
+    namespace {
+        const Integer &check_divisor(const Integer &divisor) {
+            if(mpz_sgn(divisor.get_mpz_t()) == 0)
+                math_error_exit("division by zero!");
+            return divisor;
+        }
+    }
+
+    Divider::Divider(const Integer &divisor_)
+            : divisor(check_divisor(divisor_)),
+              negative(mpz_sgn(divisor_.get_mpz_t()) < 0),
+              shift(mpz_scan1(divisor_.get_mpz_t(), 0)),
+              odd(negative ? (-divisor_ >> shift) : (divisor_ >> shift)),
+              odd_ui(mpz_fits_ulong_p(odd.get_mpz_t()) ? mpz_get_ui(odd.get_mpz_t()) : 0) { }
+
+    const Integer &Divider::get_divisor() const {
+        return divisor;
+    }
+
+    void Divider::divide(Integer &dst, const Integer &a) const {
+        mpz_ptr d = dst.get_mpz_t();
+        mpz_srcptr src = a.get_mpz_t();
+
+        /* floor(a / -x) = floor(-a / x), and for positive x, y
+         * floor(floor(a / x) / y) = floor(a / (x * y)) */
+        if(negative) {
+            mpz_neg(d, src);
+            src = d;
+        }
+        if(shift > 0) {
+            mpz_fdiv_q_2exp(d, src, shift);
+            src = d;
+        }
+
+        if(odd_ui == 1) {
+            if(src != d)
+                mpz_set(d, src);
+        } else if(odd_ui != 0) {
+            mpz_fdiv_q_ui(d, src, odd_ui);
+        } else {
+            mpz_fdiv_q(d, src, odd.get_mpz_t());
+        }
+    }
+
+    Integer Divider::divide(const Integer &a) const {
+        Integer ret;
+        divide(ret, a);
+        return ret;
+    }
+
+    Integer operator/(const Integer &lhs, const Divider &rhs) {
+        return rhs.divide(lhs);
+    }
+
+    Integer operator/(Integer &&lhs, const Divider &rhs) {
+        rhs.divide(lhs, lhs);
+        return std::move(lhs);
+    }
+}
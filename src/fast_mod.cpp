@@ -1,6 +1,7 @@
 #include "ophelib/integer.h"
 #include "ophelib/fast_mod.h"
 #include "ophelib/error.h"
+#include "ophelib/memory.h"
 
 #include <future>
 #include <vector>
@@ -12,7 +13,8 @@ namespace ophelib {
               p2(p * p),
               q2(q * q),
               n(p * q),
-              n2(n * n) { }
+              n2(n * n),
+              q2_inv(q2.inv_mod_n(p2)) { }
 
     FastMod::FastMod(const Integer &p_, const Integer &q_, const Integer &p2_, const Integer &q2_, const Integer &n_, const Integer &n2_)
             : p(p_),
@@ -20,29 +22,74 @@ namespace ophelib {
               p2(p2_),
               q2(q2_),
               n(n_),
-              n2(n2_) { }
+              n2(n2_),
+              q2_inv(q2.inv_mod_n(p2)) { }
 
     const Integer &FastMod::get_n2() const {
         return n2;
     }
 
-    Integer FastMod::pow_mod_n2(const Integer &base, const Integer &exp) const {
-        const Integer p_ = base.pow_mod_n(exp, p2);
-        const Integer q_ = base.pow_mod_n(exp, q2);
+    size_t FastMod::memory_usage() const {
+        return sizeof(FastMod)
+               + heap_usage(p) + heap_usage(q)
+               + heap_usage(p2) + heap_usage(q2)
+               + heap_usage(n) + heap_usage(n2)
+               + heap_usage(q2_inv);
+    }
 
-        Integer gcd, r, s;
-        mpz_gcdext(gcd.get_mpz_t(), r.get_mpz_t(), s.get_mpz_t(), p2.get_mpz_t(), q2.get_mpz_t());
+    void FastMod::crt_combine(Integer &dst, Integer &x_p, const Integer &x_q) const {
+        /* dst = x_q + q^2 * ((x_p - x_q) * (q^2)^-1 mod p^2), which is
+         * in [0, n^2) without a final reduction */
+        mpz_sub(x_p.get_mpz_t(), x_p.get_mpz_t(), x_q.get_mpz_t());
+        mul_mod(x_p, x_p, q2_inv, p2);
+        mpz_mul(dst.get_mpz_t(), x_p.get_mpz_t(), q2.get_mpz_t());
+        mpz_add(dst.get_mpz_t(), dst.get_mpz_t(), x_q.get_mpz_t());
+    }
+
+    void FastMod::pow_mod_n2(Integer &dst, const Integer &base, const Integer &exp) const {
+        static thread_local Integer x_p, x_q;
+        pow_mod(x_p, base, exp, p2);
+        pow_mod(x_q, base, exp, q2);
+        crt_combine(dst, x_p, x_q);
+    }
 
-        return (p_ * s * q2 + q_ * r * p2) % n2;
+    Integer FastMod::pow_mod_n2(const Integer &base, const Integer &exp) const {
+        Integer ret;
+        pow_mod_n2(ret, base, exp);
+        return ret;
     }
 
     Integer FastMod::pow_mod_n2_par(const Integer &base, const Integer &exp) const {
         auto p_ = std::async(std::launch::async, [&](){return base.pow_mod_n(exp, p2);});
         auto q_ = std::async(std::launch::async, [&](){return base.pow_mod_n(exp, q2);});
 
-        Integer gcd, r, s;
-        mpz_gcdext(gcd.get_mpz_t(), r.get_mpz_t(), s.get_mpz_t(), p2.get_mpz_t(), q2.get_mpz_t());
+        Integer x_p = p_.get(), ret;
+        crt_combine(ret, x_p, q_.get());
+        return ret;
+    }
+
+    void FastMod::horner_pow2_n2(Integer &dst, const std::vector<mpz_srcptr> &xs, const size_t shift) const {
+        const size_t k = xs.size();
+        if(k < 1)
+            error_exit("nothing to combine!");
+
+        const Integer mul = Integer(1) << shift;
+        const Integer *mods[2] = { &p2, &q2 };
+        Integer x[2], tmp[2];
+
+        /* The chains are inherently serial, each step needs the result of
+         * the previous one, so there is no more parallelism than this */
+        #pragma omp parallel for
+        for(int r = 0; r < 2; r++) {
+            const Integer &mod = *mods[r];
+            mpz_mod(x[r].get_mpz_t(), xs[0], mod.get_mpz_t());
+            for(size_t i = 1; i < k; i++) {
+                pow_mod(x[r], x[r], mul, mod);
+                mpz_mul(tmp[r].get_mpz_t(), x[r].get_mpz_t(), xs[i]);
+                mpz_mod(x[r].get_mpz_t(), tmp[r].get_mpz_t(), mod.get_mpz_t());
+            }
+        }
 
-        return (p_.get() * s * q2 + q_.get() * r * p2) % n2;
+        crt_combine(dst, x[0], x[1]);
     }
 }
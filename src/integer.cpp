@@ -1,5 +1,6 @@
 #include "ophelib/integer.h"
 #include "ophelib/error.h"
+#include "ophelib/memory.h"
 
 #include <gmpxx.h>
 
@@ -33,14 +34,168 @@ namespace ophelib {
         return o.str();
     }
 
-    bool Integer::is_prime() const {
-        return 0 != mpz_probab_prime_p(this->get_mpz_t(), N_PRIME_CHEKS_FOR_SIZE(size_bits()));
+    namespace {
+        /**
+         * Bound for the trial division prefilter in is_prime
+         */
+        const unsigned long trial_division_bound = 1UL << 12;
+
+        /**
+         * Product of all odd primes below trial_division_bound
+         */
+        const mpz_class &small_primes_product() {
+            static const mpz_class product = [](){
+                mpz_class ret = 1;
+                for(unsigned long i = 3; i < trial_division_bound; i += 2) {
+                    bool prime = true;
+                    for(unsigned long j = 3; j * j <= i && prime; j += 2)
+                        prime = i % j != 0;
+                    if(prime)
+                        ret *= i;
+                }
+                return ret;
+            }();
+            return product;
+        }
+
+        /**
+         * Strong probable prime test to base 2, for odd n > 2
+         */
+        bool is_strong_probable_prime_base2(const mpz_class &n) {
+            const mpz_class n_1 = n - 1;
+            const mp_bitcnt_t s = mpz_scan1(n_1.get_mpz_t(), 0);
+            mpz_class d, x, two = 2;
+            mpz_fdiv_q_2exp(d.get_mpz_t(), n_1.get_mpz_t(), s);
+
+            mpz_powm(x.get_mpz_t(), two.get_mpz_t(), d.get_mpz_t(), n.get_mpz_t());
+            if(x == 1 || x == n_1)
+                return true;
+            for(mp_bitcnt_t r = 1; r < s; r++) {
+                mpz_powm_ui(x.get_mpz_t(), x.get_mpz_t(), 2, n.get_mpz_t());
+                if(x == n_1)
+                    return true;
+                if(x == 1)
+                    return false;
+            }
+            return false;
+        }
+
+        /**
+         * x / 2 mod n, for odd n and 0 <= x < n
+         */
+        inline void half_mod(mpz_class &x, const mpz_class &n) {
+            if(mpz_odd_p(x.get_mpz_t()))
+                x += n;
+            mpz_fdiv_q_2exp(x.get_mpz_t(), x.get_mpz_t(), 1);
+        }
+
+        /**
+         * Strong Lucas probable prime test with Selfridge's parameters
+         * (method A), for odd n > 2 which are not a perfect square.
+         */
+        bool is_strong_lucas_probable_prime(const mpz_class &n) {
+            /* first D in 5, -7, 9, -11, ... with jacobi(D, n) = -1 */
+            long D = 5;
+            while(true) {
+                const int j = mpz_si_kronecker(D, n.get_mpz_t());
+                if(j == -1)
+                    break;
+                if(j == 0 && mpz_cmpabs_ui(n.get_mpz_t(), D < 0 ? -D : D) != 0)
+                    return false;
+                D = D < 0 ? -D + 2 : -D - 2;
+            }
+            const long P = 1, Q = (1 - D) / 4;
+
+            /* n + 1 = d * 2^s */
+            const mpz_class n_1 = n + 1;
+            const mp_bitcnt_t s = mpz_scan1(n_1.get_mpz_t(), 0);
+            mpz_class d;
+            mpz_fdiv_q_2exp(d.get_mpz_t(), n_1.get_mpz_t(), s);
+
+            /* left to right binary ladder for U_d, V_d and Q^d */
+            mpz_class U = 1, V = P, Qk = Q, tmp;
+            if(Qk < 0)
+                Qk += n;
+            for(long bit = (long) mpz_sizeinbase(d.get_mpz_t(), 2) - 2; bit >= 0; bit--) {
+                /* k -> 2k */
+                U = U * V % n;
+                V = (V * V - 2 * Qk) % n;
+                if(V < 0)
+                    V += n;
+                Qk = Qk * Qk % n;
+
+                if(mpz_tstbit(d.get_mpz_t(), bit)) {
+                    /* k -> k + 1 */
+                    tmp = P * U + V;
+                    V = (D * U + P * V) % n;
+                    if(V < 0)
+                        V += n;
+                    U = tmp % n;
+                    half_mod(U, n);
+                    half_mod(V, n);
+                    Qk = Qk * Q % n;
+                    if(Qk < 0)
+                        Qk += n;
+                }
+            }
+
+            if(U == 0 || V == 0)
+                return true;
+            for(mp_bitcnt_t r = 1; r < s; r++) {
+                V = (V * V - 2 * Qk) % n;
+                if(V < 0)
+                    V += n;
+                if(V == 0)
+                    return true;
+                Qk = Qk * Qk % n;
+            }
+            return false;
+        }
+    }
+
+    bool Integer::is_prime(const bool confirm) const {
+        mpz_class n;
+        mpz_abs(n.get_mpz_t(), this->get_mpz_t());
+
+        if(n < trial_division_bound) {
+            if(n < 2)
+                return false;
+            const unsigned long n_ = n.get_ui();
+            for(unsigned long i = 2; i * i <= n_; i++)
+                if(n_ % i == 0)
+                    return false;
+            return true;
+        }
+        if(mpz_even_p(n.get_mpz_t()))
+            return false;
+
+        /* trial division by all small primes at once */
+        mpz_class g;
+        mpz_gcd(g.get_mpz_t(), n.get_mpz_t(), small_primes_product().get_mpz_t());
+        if(g != 1)
+            return false;
+
+        /* Baillie-PSW */
+        if(!is_strong_probable_prime_base2(n))
+            return false;
+        if(mpz_perfect_square_p(n.get_mpz_t()))
+            return false;
+        if(!is_strong_lucas_probable_prime(n))
+            return false;
+
+        if(confirm)
+            return 0 != mpz_probab_prime_p(n.get_mpz_t(), N_PRIME_CHEKS_FOR_SIZE(size_bits()));
+        return true;
     }
 
     size_t Integer::size_bits() const {
         return mpz_sizeinbase(this->get_mpz_t(), 2);
     }
 
+    size_t Integer::memory_usage() const {
+        return sizeof(Integer) + heap_block_size(get_mpz_t()->_mp_alloc * sizeof(mp_limb_t));
+    }
+
     Integer Integer::pow(const long &exponent) const {
         Integer ret;
         if (exponent < 0) {
@@ -51,25 +206,15 @@ namespace ophelib {
         return ret;
     }
 
-    Integer Integer::pow_mod_n(const Integer &exponent, const Integer mod) const {
+    Integer Integer::pow_mod_n(const Integer &exponent, const Integer &mod) const {
         Integer ret;
-
-        if(mod == 0) {
-            math_error_exit("cannot operate with mod=0");
-        }
-
-        mpz_powm(ret.get_mpz_t(), this->get_mpz_t(), exponent.get_mpz_t(), mod.get_mpz_t());
+        ophelib::pow_mod(ret, *this, exponent, mod);
         return ret;
     }
 
-    Integer Integer::inv_mod_n(const Integer mod) const {
+    Integer Integer::inv_mod_n(const Integer &mod) const {
         Integer ret;
-        int stat = mpz_invert(ret.get_mpz_t(), this->get_mpz_t(), mod.get_mpz_t());
-
-        if(stat == 0) {
-            math_error_exit("inverse of n=" + this->to_string() + " does not exist!");
-        }
-
+        ophelib::inv_mod(ret, *this, mod);
         return ret;
     }
 
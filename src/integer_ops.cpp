@@ -1,12 +1,52 @@
 #include "ophelib/integer.h"
+#include "ophelib/error.h"
+
+#include <utility>
 
 namespace ophelib {
+
+    namespace {
+        /**
+         * Scratch buffers of the mod kernels, they grow to the
+         * largest operands seen by the calling thread
+         */
+        mpz_ptr product_scratch() {
+            static thread_local Integer scratch;
+            return scratch.get_mpz_t();
+        }
+
+        mpz_ptr inverse_scratch() {
+            static thread_local Integer scratch;
+            return scratch.get_mpz_t();
+        }
+
+        inline void check_mod(const Integer &mod) {
+            if(mpz_sgn(mod.get_mpz_t()) == 0)
+                math_error_exit("cannot operate with mod=0");
+        }
+
+        inline void invert(mpz_ptr dst, const Integer &a, const Integer &mod) {
+            if(mpz_invert(dst, a.get_mpz_t(), mod.get_mpz_t()) == 0)
+                math_error_exit("inverse of n=" + a.to_string() + " does not exist!");
+        }
+    }
     Integer::Integer() { }
 
+    Integer::Integer(const Integer &input)
+            : mpz_class(input) { }
+
     Integer::Integer(const mpz_class &input) {
         mpz_set(this->get_mpz_t(), input.get_mpz_t());
     }
 
+    Integer::Integer(Integer &&input) noexcept {
+        mpz_swap(this->get_mpz_t(), input.get_mpz_t());
+    }
+
+    Integer::Integer(mpz_class &&input) noexcept {
+        mpz_swap(this->get_mpz_t(), input.get_mpz_t());
+    }
+
     Integer::Integer(const int &input) {
         mpz_set_si(this->get_mpz_t(), input);
     }
@@ -45,6 +85,16 @@ namespace ophelib {
         return *this;
     }
 
+    Integer &Integer::operator=(Integer &&input) noexcept {
+        mpz_swap(this->get_mpz_t(), input.get_mpz_t());
+        return *this;
+    }
+
+    Integer &Integer::operator=(mpz_class &&input) noexcept {
+        mpz_swap(this->get_mpz_t(), input.get_mpz_t());
+        return *this;
+    }
+
     Integer &Integer::operator=(const int &input) {
         mpz_set_si(this->get_mpz_t(), input);
         return *this;
@@ -65,12 +115,17 @@ namespace ophelib {
         return *this;
     }
 
-    Integer Integer::operator-() const {
+    Integer Integer::operator-() const & {
         Integer ret;
         mpz_neg(ret.get_mpz_t(), this->get_mpz_t());
         return ret;
     }
 
+    Integer Integer::operator-() && {
+        mpz_neg(this->get_mpz_t(), this->get_mpz_t());
+        return std::move(*this);
+    }
+
     std::ostream &operator<<(std::ostream &stream, const Integer &i) {
         stream << i.to_string_();
         return stream;
@@ -143,14 +198,138 @@ namespace ophelib {
     }
 
     Integer operator<<(const mpz_class &lhs, const size_t &rhs) {
-        Integer ret = lhs;
-        ret <<= rhs;
+        Integer ret;
+        mpz_mul_2exp(ret.get_mpz_t(), lhs.get_mpz_t(), rhs);
         return ret;
     }
 
     Integer operator>>(const mpz_class &lhs, const size_t &rhs) {
-        Integer ret = lhs;
-        ret >>= rhs;
+        Integer ret;
+        mpz_fdiv_q_2exp(ret.get_mpz_t(), lhs.get_mpz_t(), rhs);
         return ret;
     }
+
+    Integer operator+(Integer &&lhs, const mpz_class &rhs) {
+        mpz_add(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator+(const mpz_class &lhs, Integer &&rhs) {
+        mpz_add(rhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(rhs);
+    }
+
+    Integer operator+(Integer &&lhs, Integer &&rhs) {
+        mpz_add(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator+(Integer &&lhs, const int &rhs) {
+        if(rhs > 0)
+            mpz_add_ui(lhs.get_mpz_t(), lhs.get_mpz_t(), (unsigned int)rhs);
+        else
+            mpz_sub_ui(lhs.get_mpz_t(), lhs.get_mpz_t(), (unsigned int)-rhs);
+        return std::move(lhs);
+    }
+
+    Integer operator+(Integer &&lhs, const unsigned int &rhs) {
+        mpz_add_ui(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs);
+        return std::move(lhs);
+    }
+
+    Integer operator-(Integer &&lhs, const mpz_class &rhs) {
+        mpz_sub(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator-(Integer &&lhs, const int &rhs) {
+        if(rhs > 0)
+            mpz_sub_ui(lhs.get_mpz_t(), lhs.get_mpz_t(), (unsigned int)rhs);
+        else
+            mpz_add_ui(lhs.get_mpz_t(), lhs.get_mpz_t(), (unsigned int)-rhs);
+        return std::move(lhs);
+    }
+
+    Integer operator-(Integer &&lhs, const unsigned int &rhs) {
+        mpz_sub_ui(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs);
+        return std::move(lhs);
+    }
+
+    Integer operator*(Integer &&lhs, const Integer &rhs) {
+        mpz_mul(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator*(const Integer &lhs, Integer &&rhs) {
+        mpz_mul(rhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(rhs);
+    }
+
+    Integer operator*(Integer &&lhs, Integer &&rhs) {
+        mpz_mul(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator%(Integer &&lhs, const Integer &rhs) {
+        mpz_mod(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator/(Integer &&lhs, const Integer &rhs) {
+        mpz_div(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs.get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator/(Integer &&lhs, const int &rhs) {
+        mpz_div(lhs.get_mpz_t(), lhs.get_mpz_t(), mpz_class(rhs).get_mpz_t());
+        return std::move(lhs);
+    }
+
+    Integer operator<<(Integer &&lhs, const size_t &rhs) {
+        mpz_mul_2exp(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs);
+        return std::move(lhs);
+    }
+
+    Integer operator>>(Integer &&lhs, const size_t &rhs) {
+        mpz_fdiv_q_2exp(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs);
+        return std::move(lhs);
+    }
+
+    void mul_mod(Integer &dst, const Integer &a, const Integer &b, const Integer &mod) {
+        check_mod(mod);
+        mpz_ptr tmp = product_scratch();
+        mpz_mul(tmp, a.get_mpz_t(), b.get_mpz_t());
+        mpz_mod(dst.get_mpz_t(), tmp, mod.get_mpz_t());
+    }
+
+    void sqr_mod(Integer &dst, const Integer &a, const Integer &mod) {
+        mul_mod(dst, a, a, mod);
+    }
+
+    void div_mod(Integer &dst, const Integer &a, const Integer &b, const Integer &mod) {
+        check_mod(mod);
+        mpz_ptr inv = inverse_scratch();
+        invert(inv, b, mod);
+        mpz_ptr tmp = product_scratch();
+        mpz_mul(tmp, a.get_mpz_t(), inv);
+        mpz_mod(dst.get_mpz_t(), tmp, mod.get_mpz_t());
+    }
+
+    void inv_mod(Integer &dst, const Integer &a, const Integer &mod) {
+        check_mod(mod);
+        invert(dst.get_mpz_t(), a, mod);
+    }
+
+    void pow_mod(Integer &dst, const Integer &base, const Integer &exp, const Integer &mod) {
+        check_mod(mod);
+        mpz_powm(dst.get_mpz_t(), base.get_mpz_t(), exp.get_mpz_t(), mod.get_mpz_t());
+    }
+
+    void add_mul(Integer &dst, const Integer &a, const Integer &b) {
+        mpz_addmul(dst.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+    }
+
+    void sub_mul(Integer &dst, const Integer &a, const Integer &b) {
+        mpz_submul(dst.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+    }
 }
@@ -0,0 +1,140 @@
+#include "ophelib/key_pool.h"
+#include "ophelib/error.h"
+
+namespace ophelib {
+
+    namespace {
+        std::shared_ptr<PaillierFast> make_instance(const size_t key_size_bits) {
+            auto ret = std::make_shared<PaillierFast>(key_size_bits);
+            ret->generate_keys();
+            return ret;
+        }
+    }
+
+    KeyPool::KeyPool(const std::vector<size_t> &key_sizes, const size_t capacity_, const size_t n_threads)
+            : capacity(capacity_),
+              counters{0, 0, 0},
+              stopping(false) {
+        if(key_sizes.empty())
+            error_exit("need at least one key size!");
+        if(capacity > 0 && n_threads == 0)
+            error_exit("need at least one thread to fill the pool!");
+
+        for(const auto key_size_bits: key_sizes) {
+            /* checks if the key size is supported */
+            PaillierFast check(key_size_bits);
+            slots[key_size_bits];
+        }
+
+        if(capacity > 0) {
+            for(size_t i = 0; i < n_threads; i++)
+                threads.emplace_back(&KeyPool::worker, this);
+        }
+    }
+
+    KeyPool::~KeyPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        refill.notify_all();
+        for(auto &t: threads)
+            t.join();
+    }
+
+    size_t KeyPool::next_to_fill() const {
+        size_t ret = 0, min_count = capacity;
+        for(const auto &slot: slots) {
+            const size_t count = slot.second.ready.size() + slot.second.in_flight;
+            if(count < min_count) {
+                min_count = count;
+                ret = slot.first;
+            }
+        }
+        return ret;
+    }
+
+    void KeyPool::worker() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            size_t key_size_bits;
+            refill.wait(lock, [this, &key_size_bits]() {
+                key_size_bits = next_to_fill();
+                return stopping || key_size_bits != 0;
+            });
+            if(stopping)
+                return;
+
+            Slot &slot = slots[key_size_bits];
+            slot.in_flight++;
+            lock.unlock();
+
+            std::shared_ptr<PaillierFast> instance;
+            try {
+                instance = make_instance(key_size_bits);
+            } catch(...) {
+                /* an exception escaping a std::thread would terminate the process,
+                 * hand it to acquire() / wait_full() instead */
+                lock.lock();
+                slot.in_flight--;
+                if(!error)
+                    error = std::current_exception();
+                filled.notify_all();
+                return;
+            }
+
+            lock.lock();
+            slot.in_flight--;
+            slot.ready.push_back(instance);
+            counters.generated++;
+            filled.notify_all();
+        }
+    }
+
+    std::shared_ptr<PaillierFast> KeyPool::acquire(const size_t key_size_bits) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto slot = slots.find(key_size_bits);
+        if(slot == slots.end())
+            error_exit("key size not managed by this pool!");
+        if(error)
+            std::rethrow_exception(error);
+
+        if(!slot->second.ready.empty()) {
+            auto ret = slot->second.ready.front();
+            slot->second.ready.pop_front();
+            counters.hits++;
+            lock.unlock();
+            refill.notify_one();
+            return ret;
+        }
+
+        counters.misses++;
+        lock.unlock();
+        return make_instance(key_size_bits);
+    }
+
+    size_t KeyPool::available(const size_t key_size_bits) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto slot = slots.find(key_size_bits);
+        return slot == slots.end() ? 0 : slot->second.ready.size();
+    }
+
+    void KeyPool::wait_full() const {
+        std::unique_lock<std::mutex> lock(mutex);
+        filled.wait(lock, [this]() {
+            if(error)
+                return true;
+            for(const auto &slot: slots)
+                if(slot.second.ready.size() < capacity)
+                    return false;
+            return true;
+        });
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    KeyPool::Stats KeyPool::stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return counters;
+    }
+}
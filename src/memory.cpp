@@ -0,0 +1,275 @@
+#include "ophelib/memory.h"
+#include "ophelib/error.h"
+
+#include <gmp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace ophelib {
+
+    namespace {
+        typedef void *(*alloc_func)(size_t);
+        typedef void *(*realloc_func)(void *, size_t, size_t);
+        typedef void (*free_func)(void *, size_t);
+
+        /* GMP memory functions installed before enable(), these back the pools */
+        alloc_func backing_alloc = nullptr;
+        realloc_func backing_realloc = nullptr;
+        free_func backing_free = nullptr;
+
+        /* largest pooled size class in limbs, 0 if disabled */
+        std::atomic<size_t> pooled_limbs(0);
+        std::atomic<size_t> max_cached(0);
+
+        /**
+         * Pools of a single thread. Counters are only written by the
+         * owning thread, they are atomic so stats() can read them.
+         */
+        struct ThreadPools {
+            /* free blocks, indexed by size class (limb count) */
+            std::vector<std::vector<void*>> classes;
+
+            std::atomic<uint64_t> hits{0};
+            std::atomic<uint64_t> misses{0};
+            std::atomic<uint64_t> fallbacks{0};
+            std::atomic<uint64_t> cached_blocks{0};
+            std::atomic<uint64_t> cached_bytes{0};
+
+            /* bytes handed out minus bytes given back, might be
+             * negative if blocks move between threads */
+            std::atomic<int64_t> live_bytes{0};
+        };
+
+        /* single writer, so no need for an atomic read-modify-write */
+        template<typename T>
+        inline void bump(std::atomic<T> &counter, const T delta) {
+            counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+        /* buffers of flat containers, allocated rarely */
+        std::atomic<int64_t> container_bytes(0);
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<ThreadPools*> pools;
+
+            /* counters of threads which already exited */
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t fallbacks = 0;
+            int64_t live_bytes = 0;
+        };
+
+        /* never destroyed, threads might exit after static destruction */
+        Registry &registry() {
+            static Registry *instance = new Registry;
+            return *instance;
+        }
+
+        void release(ThreadPools *p) {
+            for(size_t limbs = 0; limbs < p->classes.size(); limbs++) {
+                for(void *ptr: p->classes[limbs])
+                    backing_free(ptr, limbs * sizeof(mp_limb_t));
+                p->classes[limbs].clear();
+            }
+            p->cached_blocks = 0;
+            p->cached_bytes = 0;
+        }
+
+        /* marks a thread whose pools were already destroyed */
+        ThreadPools *const destroyed = reinterpret_cast<ThreadPools*>(1);
+
+        /* trivially destructible, so it can still be read during thread exit */
+        thread_local ThreadPools *current = nullptr;
+
+        /**
+         * Gives the pools of a thread back on thread exit. GMP numbers
+         * destroyed later on are freed through the backing functions.
+         */
+        struct PoolsOwner {
+            bool active = false;
+
+            ~PoolsOwner() {
+                ThreadPools *p = current;
+                current = destroyed;
+                if(p == nullptr || p == destroyed)
+                    return;
+
+                auto &r = registry();
+                {
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    r.pools.erase(std::find(r.pools.begin(), r.pools.end(), p));
+                    r.hits += p->hits;
+                    r.misses += p->misses;
+                    r.fallbacks += p->fallbacks;
+                    r.live_bytes += p->live_bytes;
+                }
+                release(p);
+                delete p;
+            }
+        };
+        thread_local PoolsOwner owner;
+
+        ThreadPools *get_pools() {
+            ThreadPools *p = current;
+            if(p == destroyed)
+                return nullptr;
+            if(p == nullptr) {
+                owner.active = true;
+                p = new ThreadPools;
+
+                auto &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.pools.push_back(p);
+                current = p;
+            }
+            return p;
+        }
+
+        void *arena_alloc(size_t size) {
+            const size_t max = pooled_limbs.load(std::memory_order_relaxed);
+            const size_t limbs = (size + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t);
+            ThreadPools *p = get_pools();
+
+            if(p != nullptr && limbs > 0 && limbs <= max) {
+                if(limbs < p->classes.size() && !p->classes[limbs].empty()) {
+                    void *ret = p->classes[limbs].back();
+                    p->classes[limbs].pop_back();
+                    bump<uint64_t>(p->hits, 1);
+                    bump<uint64_t>(p->cached_blocks, -1);
+                    bump<uint64_t>(p->cached_bytes, -(uint64_t) (limbs * sizeof(mp_limb_t)));
+                    bump<int64_t>(p->live_bytes, size);
+                    return ret;
+                }
+                bump<uint64_t>(p->misses, 1);
+                bump<int64_t>(p->live_bytes, size);
+                /* round up to the size class, so the block can be pooled */
+                return backing_alloc(limbs * sizeof(mp_limb_t));
+            }
+
+            if(p != nullptr) {
+                bump<uint64_t>(p->fallbacks, 1);
+                bump<int64_t>(p->live_bytes, size);
+            }
+            return backing_alloc(size);
+        }
+
+        void arena_free(void *ptr, size_t size) {
+            const size_t max = pooled_limbs.load(std::memory_order_relaxed);
+            /* round down, the block is at least `size` bytes large */
+            const size_t limbs = size / sizeof(mp_limb_t);
+            ThreadPools *p = get_pools();
+            if(p != nullptr)
+                bump<int64_t>(p->live_bytes, -(int64_t) size);
+
+            if(limbs > 0 && limbs <= max) {
+                if(p != nullptr) {
+                    if(p->classes.size() <= limbs)
+                        p->classes.resize(std::max(limbs, max) + 1);
+                    auto &pool = p->classes[limbs];
+                    if(pool.size() < max_cached.load(std::memory_order_relaxed)) {
+                        pool.push_back(ptr);
+                        bump<uint64_t>(p->cached_blocks, 1);
+                        bump<uint64_t>(p->cached_bytes, limbs * sizeof(mp_limb_t));
+                        return;
+                    }
+                }
+            }
+            backing_free(ptr, size);
+        }
+
+        void *arena_realloc(void *ptr, size_t old_size, size_t new_size) {
+            const size_t max_bytes = pooled_limbs.load(std::memory_order_relaxed) * sizeof(mp_limb_t);
+            if(old_size > max_bytes && new_size > max_bytes) {
+                ThreadPools *p = get_pools();
+                if(p != nullptr)
+                    bump<int64_t>(p->live_bytes, (int64_t) new_size - (int64_t) old_size);
+                return backing_realloc(ptr, old_size, new_size);
+            }
+
+            void *ret = arena_alloc(new_size);
+            std::memcpy(ret, ptr, std::min(old_size, new_size));
+            arena_free(ptr, old_size);
+            return ret;
+        }
+    }
+
+    void LimbArena::enable(const size_t key_size_bits, const size_t max_cached_per_class) {
+        if(key_size_bits == 0)
+            error_exit("key size has to be > 0!");
+
+        alloc_func a;
+        realloc_func r;
+        free_func f;
+        mp_get_memory_functions(&a, &r, &f);
+        if(a != arena_alloc) {
+            backing_alloc = a;
+            backing_realloc = r;
+            backing_free = f;
+        }
+
+        /* n^2 has 2 * key_size_bits, a product of two of them twice that.
+         * GMP sometimes allocates an additional limb. */
+        const size_t n2_limbs = (2 * key_size_bits + GMP_LIMB_BITS - 1) / GMP_LIMB_BITS;
+        max_cached = max_cached_per_class;
+        pooled_limbs = 2 * n2_limbs + 2;
+
+        mp_set_memory_functions(arena_alloc, arena_realloc, arena_free);
+    }
+
+    void LimbArena::disable() {
+        if(!enabled())
+            return;
+
+        pooled_limbs = 0;
+        mp_set_memory_functions(backing_alloc, backing_realloc, backing_free);
+
+        ThreadPools *p = current;
+        if(p != nullptr && p != destroyed)
+            release(p);
+    }
+
+    bool LimbArena::enabled() {
+        return pooled_limbs != 0;
+    }
+
+    size_t LimbArena::max_limbs() {
+        return pooled_limbs;
+    }
+
+    LimbArena::Stats LimbArena::stats() {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        Stats ret = { r.hits, r.misses, r.fallbacks, 0, 0, r.pools.size(), r.live_bytes };
+        for(const auto p: r.pools) {
+            ret.live_bytes += p->live_bytes;
+            ret.hits += p->hits;
+            ret.misses += p->misses;
+            ret.fallbacks += p->fallbacks;
+            ret.cached_blocks += p->cached_blocks;
+            ret.cached_bytes += p->cached_bytes;
+        }
+        return ret;
+    }
+
+    size_t heap_block_size(const size_t bytes) {
+        if(bytes == 0)
+            return 0;
+        const size_t align = 2 * sizeof(size_t);
+        const size_t ret = (bytes + sizeof(size_t) + align - 1) / align * align;
+        return ret < 2 * align ? 2 * align : ret;
+    }
+
+    int64_t live_bytes() {
+        return container_bytes + LimbArena::stats().live_bytes;
+    }
+
+    void track_live_bytes(const int64_t delta) {
+        container_bytes += delta;
+    }
+}
@@ -4,6 +4,33 @@
 namespace ophelib {
     namespace ML {
 
+        namespace {
+            void check_same_key(const KeyContext *a, const KeyContext *b) {
+                if(!a || !b)
+                    error_exit("no modulus set!");
+                if(!KeyContext::same_key(a, b))
+                    error_exit("cannot operate on ciphertexts from different keys!");
+            }
+
+            /**
+             * Slot-wise sum over the rows of M, i.e. over all samples
+             */
+            Vec<PackedCiphertext> sum_rows(const Mat<PackedCiphertext> &M) {
+                const long n = M.NumRows(),
+                           m = M.NumCols();
+
+                Vec<PackedCiphertext> col, ret;
+                col.SetLength(n);
+                ret.SetLength(m);
+                for(long j = 0; j < m; j++) {
+                    for(long i = 0; i < n; i++)
+                        col[i] = M[i][j];
+                    ret[j] = Vector::sum(col);
+                }
+                return ret;
+            }
+        }
+
         LinregPlain::LinregPlain(const Integer &multiplier_, const Integer &alpha_inv_, const size_t n_iter_)
                 : multiplier(multiplier_),
                   alpha_inv(alpha_inv_),
@@ -12,11 +39,13 @@ namespace ophelib {
 
         bool LinregPlain::grad_desc_step(const Mat<Integer> &X, const Vec<Integer> &y) {
             using namespace Vector;
-            const auto n = Integer(X.NumRows());
+            const Divider n(X.NumRows());
+            const Divider div_multiplier(multiplier);
 
-            const auto hypothesis = dot(X, theta) / multiplier;
+            const auto hypothesis = dot(X, theta) / div_multiplier;
             const auto loss = hypothesis - y;
-            const auto grad = dot(transpose(X), loss) / n / multiplier;
+            // loss^T X == X^T loss, without transposing X
+            const auto grad = dot(loss, X) / n / div_multiplier;
 
             #ifdef DEBUG
             const auto cost = dot(loss, loss) / n;
@@ -119,7 +148,7 @@ namespace ophelib {
             // initialize weights with cipher zero
             theta.SetLength(n_features);
             for(long i = 0 ; i < m; i++) {
-                theta[i] = Ciphertext(1, y[0].n2_shared);
+                theta[i] = Ciphertext(1, y[0].key);
             }
 
             const auto div = alpha_inv * Integer(n) * multiplier * multiplier;
@@ -211,11 +240,92 @@ namespace ophelib {
             };
         }
 
+        UsersAggregator::UsersAggregator()
+                : n_users(0) { }
+
+        void UsersAggregator::add(const Mat<Ciphertext> &Ai, const Vec<Ciphertext> &bi) {
+            add(SymmetricCiphertextMatrix(Ai), CiphertextVector(bi));
+        }
+
+        void UsersAggregator::add(const SymmetricCiphertextMatrix &Ai, const CiphertextVector &bi) {
+            /* validate everything first, so a rejected user leaves the sums untouched */
+            if(Ai.NumRows() != bi.length())
+                dimension_mismatch();
+            if(bi.length() < 1)
+                error_exit("no features!");
+            if(n_users > 0 && A.size() == 0)
+                error_exit("cannot mix users with and without A!");
+            check_same_key(Ai.key, bi.key);
+            if(n_users > 0) {
+                if(A.NumRows() != Ai.NumRows())
+                    dimension_mismatch();
+                check_same_key(A.key, Ai.key);
+                check_same_key(b.key, bi.key);
+            }
+
+            if(n_users == 0) {
+                A = Ai;
+                b = bi;
+            } else {
+                A += Ai;
+                b += bi;
+            }
+            n_users++;
+        }
+
+        void UsersAggregator::add(const Vec<Ciphertext> &bi) {
+            add(CiphertextVector(bi));
+        }
+
+        void UsersAggregator::add(const CiphertextVector &bi) {
+            if(A.size() > 0)
+                error_exit("cannot mix users with and without A!");
+            if(bi.length() < 1)
+                error_exit("no features!");
+            if(n_users > 0) {
+                if(bi.length() != b.length())
+                    dimension_mismatch();
+                check_same_key(b.key, bi.key);
+            }
+
+            if(n_users == 0)
+                b = bi;
+            else
+                b += bi;
+            n_users++;
+        }
+
+        size_t UsersAggregator::size() const {
+            return n_users;
+        }
+
+        long UsersAggregator::n_features() const {
+            return b.length();
+        }
+
+        const SymmetricCiphertextMatrix &UsersAggregator::get_A() const {
+            if(A.size() == 0)
+                error_exit("no A added!");
+            return A;
+        }
+
+        const CiphertextVector &UsersAggregator::get_b() const {
+            if(n_users == 0)
+                error_exit("no users added!");
+            return b;
+        }
+
         LinregPlainEncUsers::LinregPlainEncUsers(const client_callback_t &client_callback_, const Vector::Integerizer &inter_)
                 : client_callback(client_callback_),
                   inter(inter_),
                   n_features(0) { }
 
+        LinregPlainEncUsers::LinregPlainEncUsers(const packed_client_callback_t &packed_client_callback_, const Vector::Integerizer &inter_, const PublicKey &pubkey_)
+                : packed_client_callback(packed_client_callback_),
+                  paillier(std::make_shared<const PaillierFast>(pubkey_)),
+                  inter(inter_),
+                  n_features(0) { }
+
         Mat<Ciphertext> LinregPlainEncUsers::client_preprocess(const Mat<float> &X, const Vec<float> &y, const Vector::Integerizer &inter, const PaillierBase &paillier) {
             const long n = X.NumRows(),
                        m = X.NumCols();
@@ -231,6 +341,36 @@ namespace ophelib {
             return Vector::encrypt(inter.transform(B), paillier);
         }
 
+        Mat<PackedCiphertext> LinregPlainEncUsers::client_preprocess_packed(const Mat<float> &X, const Vec<float> &y, const Vector::Integerizer &inter, const size_t n_bits, const size_t headroom_bits, const PaillierBase &paillier) {
+            const long n = X.NumRows(),
+                       m = X.NumCols();
+            if(n != y.length())
+                dimension_mismatch();
+
+            Mat<float> B;
+            B.SetDims(n, m);
+
+            for(long i = 0; i < n; i++) {
+                using Vector::operator*;
+                B[i] = X[i] * y[i];
+            }
+            const auto B_i = inter.transform(B);
+
+            const long per_pack = (long) (Vector::pack_count(n_bits, paillier, headroom_bits) + 1) / 2;
+            const long n_packs = (m + per_pack - 1) / per_pack;
+
+            Mat<PackedCiphertext> ret;
+            ret.SetDims(n, n_packs);
+            for(long i = 0; i < n; i++) {
+                for(long p = 0; p < n_packs; p++) {
+                    const auto begin = B_i[i].begin() + p * per_pack;
+                    const auto end = B_i[i].begin() + std::min(m, (p + 1) * per_pack);
+                    ret[i][p] = Vector::encrypt_pack(begin, end, n_bits, paillier, headroom_bits);
+                }
+            }
+            return ret;
+        }
+
         void LinregPlainEncUsers::fit(const Mat<float> &X, const Mat<Ciphertext> &B) {
             return fit(X, Vector::transpose(X), B);
         }
@@ -244,16 +384,62 @@ namespace ophelib {
                 error_exit("no features!");
             if(m < 1)
                 error_exit("no samples!");
+            fit_sum(X, X_t, Vector::sum(B));
+        }
+
+        void LinregPlainEncUsers::fit(const Mat<float> &X, const UsersAggregator &users) {
+            return fit(X, Vector::transpose(X), users);
+        }
+
+        void LinregPlainEncUsers::fit(const Mat<float> &X, const Mat<float> &X_t, const UsersAggregator &users) {
+            if((long) users.size() != X.NumRows() || users.n_features() != X.NumCols())
+                dimension_mismatch();
+            fit_sum(X, X_t, users.get_b().to_vec());
+        }
+
+        void LinregPlainEncUsers::fit_sum(const Mat<float> &X, const Mat<float> &X_t, const Vec<Ciphertext> &b) {
+            const long n = X.NumRows(),
+                       m = X.NumCols();
+            if(n < 1)
+                error_exit("no features!");
+            if(m < 1)
+                error_exit("no samples!");
+            if(!client_callback)
+                error_exit("no client callback!");
             n_features = m;
 
             const auto A = Vector::inv(Vector::dot(X_t, X));
             const auto A_i = inter.transform(A);
-            auto b = Vector::sum(B);
 
             theta = Vector::dot(b, Vector::transpose(A_i));
             theta = client_callback(theta, inter.get_factor());
         }
 
+        void LinregPlainEncUsers::fit(const Mat<float> &X, const Mat<PackedCiphertext> &B) {
+            return fit(X, Vector::transpose(X), B);
+        }
+
+        void LinregPlainEncUsers::fit(const Mat<float> &X, const Mat<float> &X_t, const Mat<PackedCiphertext> &B) {
+            const long n = X.NumRows(),
+                       m = X.NumCols();
+            if(n != B.NumRows())
+                dimension_mismatch();
+            if(n < 1)
+                error_exit("no features!");
+            if(m < 1)
+                error_exit("no samples!");
+            if(!packed_client_callback)
+                error_exit("no packed client callback!");
+            n_features = m;
+
+            const auto A = Vector::inv(Vector::dot(X_t, X));
+            const auto A_i = inter.transform(A);
+            const auto b = sum_rows(B);
+
+            /* A_i * b == b * A_i^T, as above */
+            theta = packed_client_callback(Vector::dot(A_i, b, *paillier), inter.get_factor());
+        }
+
         Vec<Ciphertext> LinregPlainEncUsers::predict(const Mat<Integer> &X) const {
             return predict(X, Vector::transpose(X));
         }
@@ -278,6 +464,13 @@ namespace ophelib {
             };
         }
 
+        const LinregPlainEncUsers::packed_client_callback_t LinregPlainEncUsers::construct_packed_client_callback(const PaillierBase &paillier) {
+            return [&paillier](const Vec<PackedCiphertext> &error, const Integer &divisor) {
+                using Vector::operator/;
+                return Vector::encrypt(Vector::decrypt_pack(error, paillier) / divisor, paillier);
+            };
+        }
+
         LinregEncEncUsers::LinregEncEncUsers(const client_callback_t &client_callback_, const Integer &multiplier_, const PublicKey &pubkey_, const Integer &alpha_inv_, const size_t n_iter_)
                 : client_callback(client_callback_),
                   multiplier(multiplier_),
@@ -300,6 +493,16 @@ namespace ophelib {
             return A;
         }
 
+        Vec<SymmetricCiphertextMatrix> LinregEncEncUsers::client_preprocess_A_symmetric(const Mat<Integer> &X, const PaillierBase &paillier) {
+            const long n = X.NumRows();
+
+            Vec<SymmetricCiphertextMatrix> A;
+            A.SetLength(n);
+            for(long i = 0; i < n; i++)
+                A[i] = Vector::encrypt_outer(X[i], paillier);
+            return A;
+        }
+
         Mat<Ciphertext> LinregEncEncUsers::client_preprocess_b(const Mat<Integer> &X, const Vec<Integer> &y, const PaillierBase &paillier) {
             const long n = X.NumRows();
             if(n != y.length())
@@ -317,18 +520,56 @@ namespace ophelib {
             return b;
         }
 
-        Vec<Integer> LinregEncEncUsers::gradient_descent(const Mat<Ciphertext> &AA, const Vec<Ciphertext> bb) {
+        Vec<Mat<PackedCiphertext>> LinregEncEncUsers::client_preprocess_A_packed(const Mat<Integer> &X, const size_t n_bits, const size_t headroom_bits, const PaillierBase &paillier) {
+            const long n = X.NumRows();
+
+            Vec<Mat<PackedCiphertext>> A;
+            A.SetLength(n);
+            for(long i = 0; i < n; i++) {
+                const auto sample = X[i];
+                const auto Ai = Vector::dot(Vector::col_matrix(sample),
+                                            Vector::row_matrix(sample));
+                for(long k = 0; k < Ai.NumRows(); k++) {
+                    const auto row = Vector::encrypt_pack_vec(Ai[k], n_bits, paillier, headroom_bits);
+                    if(k == 0)
+                        A[i].SetDims(Ai.NumRows(), row.length());
+                    A[i][k] = row;
+                }
+            }
+            return A;
+        }
+
+        Mat<PackedCiphertext> LinregEncEncUsers::client_preprocess_b_packed(const Mat<Integer> &X, const Vec<Integer> &y, const size_t n_bits, const size_t headroom_bits, const PaillierBase &paillier) {
+            const long n = X.NumRows();
+            if(n != y.length())
+                dimension_mismatch();
+
+            using Vector::operator*;
+
+            Mat<PackedCiphertext> b;
+            for(long i = 0; i < n; i++) {
+                const auto sample = X[i];
+                const auto bi = Vector::encrypt_pack_vec(sample * y[i], n_bits, paillier, headroom_bits);
+                if(i == 0)
+                    b.SetDims(n, bi.length());
+                b[i] = bi;
+            }
+            return b;
+        }
+
+        Integer LinregEncEncUsers::step_divisor() const {
+            return alpha_inv * multiplier * multiplier * Integer(n_features);
+        }
+
+        Vec<Integer> LinregEncEncUsers::gradient_descent(const std::function< Vec<PackedCiphertext> (const Vec<Integer>&)> &error) {
             using Vector::operator-;
             using Vector::operator/;
             auto theta = Vector::zeros<Integer>((size_t)n_features);
 
-            const auto divisor = alpha_inv * multiplier * multiplier * Integer(n_features);
+            const Divider divider(step_divisor());
 
             for(size_t k = 0; k < n_iter; k++, n_iter_done = k) {
-                const auto tmp = bb - Vector::dot(AA, theta);
-                const auto n_bits = divisor.size_bits() + multiplier.size_bits() * 2;
-                const auto packed = Vector::pack_ciphertexts_vec(tmp, n_bits, paillier);
-                const auto loss = client_callback(packed) / divisor;
+                const auto loss = client_callback(error(theta)) / divider;
 
                 if(Vector::dot(loss, loss) == 0)
                     break;
@@ -344,28 +585,117 @@ namespace ophelib {
         }
 
         size_t LinregEncEncUsers::fit(const Vec<Mat<Ciphertext>> &A, const Mat<Ciphertext> &b) {
-            using Vector::operator+;
             using Vector::operator-;
 
             if(A.length() < 1)
                 error_exit("A empty!");
             if(b.NumRows() < 1)
-                error_exit("A empty!");
+                error_exit("b empty!");
             const long n = A[0].NumRows(),
                        m = A.length();
             if(n < 1)
                 error_exit("no features!");
-            if(m < 1)
-                error_exit("no samples!");
+            if(b.NumRows() != m || b.NumCols() != n)
+                dimension_mismatch();
+            for(long i = 0; i < m; i++)
+                if(A[i].NumRows() != n || A[i].NumCols() != n)
+                    dimension_mismatch();
             n_features = n;
 
+            /* full matrices, summed in place, one user at a time */
             Mat<Ciphertext> AA = A[0];
             for(long i = 1; i < m; i++)
-                AA = AA + A[i];
+                for(long r = 0; r < n; r++)
+                    for(long c = 0; c < n; c++)
+                        AA[r][c] += A[i][r][c];
+
+            const Vec<Ciphertext> bb = Vector::sum(b);
+
+            AA = -AA;
+            const auto n_bits = step_divisor().size_bits() + multiplier.size_bits() * 2;
+            theta = gradient_descent([&](const Vec<Integer> &weights) {
+                const auto tmp = bb - Vector::dot(AA, weights);
+                return Vector::pack_ciphertexts_vec(tmp, n_bits, paillier);
+            });
+            return n_iter_done;
+        }
 
-            Vec<Ciphertext> bb = Vector::sum(b);
+        size_t LinregEncEncUsers::fit(const Vec<SymmetricCiphertextMatrix> &A, const Mat<Ciphertext> &b) {
+            if(A.length() < 1)
+                error_exit("A empty!");
+            if(b.NumRows() < 1)
+                error_exit("b empty!");
+
+            return fit_sums(Vector::sum(A), Vector::sum(b));
+        }
+
+        size_t LinregEncEncUsers::fit(const UsersAggregator &users) {
+            return fit_sums(users.get_A(), users.get_b().to_vec());
+        }
 
-            theta = gradient_descent(-AA, bb);
+        size_t LinregEncEncUsers::fit_sums(const SymmetricCiphertextMatrix &AA, const Vec<Ciphertext> &bb) {
+            const long n = AA.NumRows();
+            if(n < 1)
+                error_exit("no features!");
+            if(bb.length() != n)
+                dimension_mismatch();
+            n_features = n;
+
+            const auto AA_neg = -AA;
+            const auto n_bits = step_divisor().size_bits() + multiplier.size_bits() * 2;
+            theta = gradient_descent([&](const Vec<Integer> &weights) {
+                using Vector::operator-;
+                const auto tmp = bb - Vector::dot(AA_neg, weights).to_vec();
+                return Vector::pack_ciphertexts_vec(tmp, n_bits, paillier);
+            });
+            return n_iter_done;
+        }
+
+        size_t LinregEncEncUsers::fit(const Vec<Mat<PackedCiphertext>> &A, const Mat<PackedCiphertext> &b) {
+            if(A.length() < 1)
+                error_exit("A empty!");
+            if(b.NumRows() < 1)
+                error_exit("b empty!");
+            const long n = A[0].NumRows(),
+                       m = A.length(),
+                       n_packs = A[0].NumCols();
+            if(n < 1)
+                error_exit("no features!");
+            if(b.NumRows() != m || b.NumCols() != n_packs)
+                dimension_mismatch();
+            for(long i = 0; i < m; i++)
+                if(A[i].NumRows() != n || A[i].NumCols() != n_packs)
+                    dimension_mismatch();
+            n_features = n;
+
+            /* row k of the sum of all Ai, which is also column k, as
+             * every Ai is symmetric. So AA * theta is the sum of the rows,
+             * weighted with theta, and can be done slot-wise. */
+            Mat<PackedCiphertext> AA;
+            AA.SetDims(n, n_packs);
+            Vec<PackedCiphertext> samples;
+            samples.SetLength(m);
+            for(long k = 0; k < n; k++) {
+                for(long p = 0; p < n_packs; p++) {
+                    for(long i = 0; i < m; i++)
+                        samples[i] = A[i][k][p];
+                    AA[k][p] = Vector::sum(samples);
+                }
+            }
+            const auto bb = sum_rows(b);
+
+            theta = gradient_descent([&](const Vec<Integer> &weights) {
+                Vec<PackedCiphertext> terms, ret;
+                terms.SetLength(n + 1);
+                ret.SetLength(n_packs);
+                for(long p = 0; p < n_packs; p++) {
+                    for(long k = 0; k < n; k++)
+                        terms[k] = AA[k][p] * weights[k];
+                    terms[n] = bb[p];
+                    ret[p] = Vector::sum(terms);
+                }
+                return ret;
+            });
             return n_iter_done;
         }
 
@@ -1,43 +1,55 @@
 #include "ophelib/ntl_conv.h"
 
-#include <iostream>
-#include <sstream>
+#include <vector>
 
 namespace ophelib {
+
+    namespace {
+        /**
+         * Byte buffer for the conversions, grows to the
+         * largest number seen by the calling thread
+         */
+        unsigned char *byte_buffer(const size_t n_bytes) {
+            static thread_local std::vector<unsigned char> buffer;
+            if(buffer.size() < n_bytes)
+                buffer.resize(n_bytes);
+            return buffer.data();
+        }
+    }
+
     void conv(ophelib::Integer & z, const NTL::RR & a) {
-        /*
-        ─╔══╗───╔═══╗
-        ╔╬╣╠╝───║╔═╗║──────────╔╦╗
-        ║║║║╔╗╔╗║╚══╦══╦═╦═╦╗─╔╣║║
-        ╚╩╣║║╚╝║╚══╗║╔╗║╔╣╔╣║─║╠╩╝
-        ─╔╣╠╣║║║║╚═╝║╚╝║║║║║╚═╝║
-        ─╚══╩╩╩╝╚═══╩══╩╝╚╝╚═╗╔╝
-        ───────────────────╔═╝║
-        ───────────────────╚══╝
-        */
-        NTL::ZZ tmp;
-        conv(tmp, a);
-        std::ostringstream o(""); o << tmp;
-        mpz_set_str(z.get_mpz_t(), o.str().c_str(), 10);
+        /* a = mantissa * 2^exponent, the mantissa has at most
+         * RR::precision() bits. Rounds towards -inf, like NTL. */
+        conv(z, a.mantissa());
+        const long e = a.exponent();
+        if(e >= 0)
+            mpz_mul_2exp(z.get_mpz_t(), z.get_mpz_t(), (mp_bitcnt_t) e);
+        else
+            mpz_fdiv_q_2exp(z.get_mpz_t(), z.get_mpz_t(), (mp_bitcnt_t) -e);
     }
 
     void conv(ophelib::Integer & z, const NTL::ZZ & a) {
-        /*
-        ─╔══╗───╔═══╗
-        ╔╬╣╠╝───║╔═╗║──────────╔╦╗
-        ║║║║╔╗╔╗║╚══╦══╦═╦═╦╗─╔╣║║
-        ╚╩╣║║╚╝║╚══╗║╔╗║╔╣╔╣║─║╠╩╝
-        ─╔╣╠╣║║║║╚═╝║╚╝║║║║║╚═╝║
-        ─╚══╩╩╩╝╚═══╩══╩╝╚╝╚═╗╔╝
-        ───────────────────╔═╝║
-        ───────────────────╚══╝
-        */
-        std::ostringstream o(""); o << a;
-        mpz_set_str(z.get_mpz_t(), o.str().c_str(), 10);
+        const long n_bytes = NTL::NumBytes(a);
+        unsigned char *p = byte_buffer((size_t) n_bytes);
+        NTL::BytesFromZZ(p, a, n_bytes);
+        mpz_import(z.get_mpz_t(), (size_t) n_bytes, -1, 1, 0, 0, p);
+        if(NTL::sign(a) < 0)
+            mpz_neg(z.get_mpz_t(), z.get_mpz_t());
+    }
+
+    void conv(NTL::ZZ& z, const ophelib::Integer& a) {
+        const size_t n_bytes = (mpz_sizeinbase(a.get_mpz_t(), 2) + 7) / 8;
+        unsigned char *p = byte_buffer(n_bytes);
+        size_t count = 0;
+        mpz_export(p, &count, -1, 1, 0, 0, a.get_mpz_t());
+        NTL::ZZFromBytes(z, p, (long) count);
+        if(mpz_sgn(a.get_mpz_t()) < 0)
+            NTL::negate(z, z);
     }
 
     void conv(NTL::RR& z, const ophelib::Integer& a) {
-        std::ostringstream o(""); o << a.to_string_();
-        conv(z, o.str().c_str());
+        NTL::ZZ tmp;
+        conv(tmp, a);
+        conv(z, tmp);
     }
 }
@@ -1,24 +1,182 @@
 #include "ophelib/packing.h"
+#include "ophelib/memory.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <vector>
 
 namespace ophelib {
 
+    namespace {
+        /**
+         * Collects exceptions of a parallel loop over packs, they must not
+         * leave the OpenMP region. Rethrows the one of the lowest pack, as
+         * a serial loop would.
+         */
+        class PackErrors {
+            long first;
+            std::exception_ptr error;
+
+        public:
+            explicit PackErrors(const size_t n_packs)
+                    : first((long) n_packs) { }
+
+            /**
+             * Call from the catch block of pack i
+             */
+            void record(const long i) {
+                #pragma omp critical(pack_errors)
+                {
+                    if(i < first) {
+                        first = i;
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            void rethrow() const {
+                if(error)
+                    std::rethrow_exception(error);
+            }
+        };
+
+        /**
+         * First bit after a field of a PackLayout, throws if that does
+         * not fit a size_t (e.g. for a corrupt deserialized layout)
+         */
+        size_t field_end(const PackLayout &layout, const size_t f) {
+            const size_t offset = layout.field_offset[f];
+            const size_t width = layout.field_bits[f] + Vector::pack_buffer;
+            if(width < layout.field_bits[f] || offset > std::numeric_limits<size_t>::max() - width)
+                error_exit("invalid pack layout!");
+            return offset + width;
+        }
+
+        void check_layout(const PackedCiphertext &a, const PackedCiphertext &b) {
+            if(a.n_plaintexts != b.n_plaintexts || a.slot_bits != b.slot_bits || a.slot_stride != b.slot_stride)
+                error_exit("packed ciphertexts have different layouts!");
+        }
+
+        /**
+         * plaintext_bits after an operation, if it still fits the slots of c
+         */
+        size_t grown_bits(const PackedCiphertext &c, const size_t plaintext_bits) {
+            if(plaintext_bits + Vector::pack_buffer > c.slot_bits)
+                error_exit("packed slots would overflow, pack with more headroom!");
+            return plaintext_bits;
+        }
+
+        /**
+         * Bits a slot grows when multiplied with x, ceil(log2(|x|))
+         */
+        size_t mul_bits(const Integer &x) {
+            Integer a = x < 0 ? Integer(-x) : x;
+            if(a <= 1)
+                return 0;
+            a -= 1;
+            return a.size_bits();
+        }
+    }
+
     PackedCiphertext::PackedCiphertext(const Ciphertext &data_, const size_t n_plaintexts_, const size_t plaintext_bits_)
+            : PackedCiphertext(data_, n_plaintexts_, plaintext_bits_, plaintext_bits_ + Vector::pack_buffer) { }
+
+    PackedCiphertext::PackedCiphertext(Ciphertext &&data_, const size_t n_plaintexts_, const size_t plaintext_bits_)
+            : PackedCiphertext(std::move(data_), n_plaintexts_, plaintext_bits_, plaintext_bits_ + Vector::pack_buffer) { }
+
+    PackedCiphertext::PackedCiphertext(const Ciphertext &data_, const size_t n_plaintexts_, const size_t plaintext_bits_, const size_t slot_bits_, const size_t slot_stride_)
             : data(data_),
               n_plaintexts(n_plaintexts_),
-              plaintext_bits(plaintext_bits_) { }
+              plaintext_bits(plaintext_bits_),
+              slot_bits(slot_bits_),
+              slot_stride(slot_stride_) { }
+
+    PackedCiphertext::PackedCiphertext(Ciphertext &&data_, const size_t n_plaintexts_, const size_t plaintext_bits_, const size_t slot_bits_, const size_t slot_stride_)
+            : data(std::move(data_)),
+              n_plaintexts(n_plaintexts_),
+              plaintext_bits(plaintext_bits_),
+              slot_bits(slot_bits_),
+              slot_stride(slot_stride_) { }
 
     PackedCiphertext::PackedCiphertext() { }
 
     bool PackedCiphertext::operator==(const PackedCiphertext &input) const {
         return plaintext_bits == input.plaintext_bits &&
+               slot_bits == input.slot_bits &&
+               slot_stride == input.slot_stride &&
                n_plaintexts == input.n_plaintexts &&
                data == input.data;
     }
 
     bool PackedCiphertext::operator!=(const PackedCiphertext &input) const {
-        return plaintext_bits != input.plaintext_bits ||
-               n_plaintexts != input.n_plaintexts ||
-               data != input.data;
+        return !(*this == input);
+    }
+
+    PackedCiphertext PackedCiphertext::operator-() const & {
+        return PackedCiphertext(-data, n_plaintexts, plaintext_bits, slot_bits, slot_stride);
+    }
+
+    PackedCiphertext PackedCiphertext::operator-() && {
+        data = -std::move(data);
+        return std::move(*this);
+    }
+
+    PackedCiphertext PackedCiphertext::operator+(const PackedCiphertext &other) const & {
+        PackedCiphertext ret = *this;
+        ret += other;
+        return ret;
+    }
+
+    PackedCiphertext PackedCiphertext::operator+(const PackedCiphertext &other) && {
+        *this += other;
+        return std::move(*this);
+    }
+
+    void PackedCiphertext::operator+=(const PackedCiphertext &other) {
+        check_layout(*this, other);
+        const size_t bits = grown_bits(*this, std::max(plaintext_bits, other.plaintext_bits) + 1);
+        data += other.data;
+        plaintext_bits = bits;
+    }
+
+    PackedCiphertext PackedCiphertext::operator-(const PackedCiphertext &other) const & {
+        PackedCiphertext ret = *this;
+        ret -= other;
+        return ret;
+    }
+
+    PackedCiphertext PackedCiphertext::operator-(const PackedCiphertext &other) && {
+        *this -= other;
+        return std::move(*this);
+    }
+
+    void PackedCiphertext::operator-=(const PackedCiphertext &other) {
+        check_layout(*this, other);
+        const size_t bits = grown_bits(*this, std::max(plaintext_bits, other.plaintext_bits) + 1);
+        data -= other.data;
+        plaintext_bits = bits;
+    }
+
+    PackedCiphertext PackedCiphertext::operator*(const Integer &other) const & {
+        PackedCiphertext ret = *this;
+        ret *= other;
+        return ret;
+    }
+
+    PackedCiphertext PackedCiphertext::operator*(const Integer &other) && {
+        *this *= other;
+        return std::move(*this);
+    }
+
+    void PackedCiphertext::operator*=(const Integer &other) {
+        const size_t bits = grown_bits(*this, plaintext_bits + mul_bits(other));
+        data *= other;
+        plaintext_bits = bits;
+    }
+
+    size_t PackedCiphertext::memory_usage() const {
+        return sizeof(PackedCiphertext) + heap_usage(data);
     }
 
     const std::string PackedCiphertext::to_string(const bool brief) const {
@@ -27,6 +185,8 @@ namespace ophelib {
         o << "<PackedCiphertext";
         o << " data=" << data.to_string(brief);
         o << " plaintext_bits=" << plaintext_bits;
+        o << " slot_bits=" << slot_bits;
+        o << " slot_stride=" << slot_stride;
         o << " n_plaintexts=" << n_plaintexts;
         o << ">";
 
@@ -38,67 +198,260 @@ namespace ophelib {
         return stream;
     }
 
+    PackLayout::PackLayout(const std::vector<size_t> &field_bits_, const PaillierBase &pai)
+            : field_bits(field_bits_),
+              field_pack(field_bits_.size()),
+              field_offset(field_bits_.size()),
+              n_packs(0) {
+        const size_t capacity = pai.plaintext_size_bits();
+
+        /* first fit decreasing, the widest fields first */
+        std::vector<size_t> order(field_bits.size());
+        for(size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [this](const size_t a, const size_t b) {
+            return field_bits[a] > field_bits[b];
+        });
+
+        std::vector<size_t> used;
+        for(const size_t f: order) {
+            const size_t width = field_bits[f] + Vector::pack_buffer;
+            if(width > capacity)
+                error_exit("plaintext size too large!");
+
+            size_t pack = 0;
+            while(pack < used.size() && used[pack] + width > capacity)
+                pack++;
+            if(pack == used.size())
+                used.push_back(0);
+
+            field_pack[f] = pack;
+            field_offset[f] = used[pack];
+            used[pack] += width;
+        }
+        n_packs = used.size();
+    }
+
+    PackLayout::PackLayout(const std::vector<size_t> &field_bits_, const std::vector<size_t> &field_pack_, const std::vector<size_t> &field_offset_, const size_t n_packs_)
+            : field_bits(field_bits_),
+              field_pack(field_pack_),
+              field_offset(field_offset_),
+              n_packs(n_packs_) {
+        if(field_pack.size() != field_bits.size() || field_offset.size() != field_bits.size())
+            dimension_mismatch();
+        /* every pack holds at least one field */
+        if(n_packs > field_bits.size())
+            error_exit("invalid pack layout!");
+
+        /* throws for overlapping fields */
+        pack_fields();
+    }
+
+    PackLayout::PackLayout()
+            : n_packs(0) { }
+
+    size_t PackLayout::n_fields() const {
+        return field_bits.size();
+    }
+
+    std::vector< std::vector<size_t> > PackLayout::pack_fields() const {
+        std::vector< std::vector<size_t> > ret(n_packs);
+        for(size_t f = 0; f < field_bits.size(); f++) {
+            if(field_pack[f] >= n_packs)
+                error_exit("invalid pack layout!");
+            ret[field_pack[f]].push_back(f);
+        }
+
+        for(auto &fields: ret) {
+            std::sort(fields.begin(), fields.end(), [this](const size_t a, const size_t b) {
+                return field_offset[a] < field_offset[b];
+            });
+            for(size_t i = 1; i < fields.size(); i++) {
+                const size_t below = fields[i - 1];
+                if(field_end(*this, below) > field_offset[fields[i]])
+                    error_exit("invalid pack layout!");
+            }
+        }
+        return ret;
+    }
+
+    bool PackLayout::operator==(const PackLayout &input) const {
+        return n_packs == input.n_packs &&
+               field_bits == input.field_bits &&
+               field_pack == input.field_pack &&
+               field_offset == input.field_offset;
+    }
+
+    bool PackLayout::operator!=(const PackLayout &input) const {
+        return !(*this == input);
+    }
+
+    const std::string PackLayout::to_string(const bool brief) const {
+        std::ostringstream o("");
+
+        o << "<PackLayout";
+        o << " n_fields=" << n_fields();
+        o << " n_packs=" << n_packs;
+        if(!brief) {
+            o << " fields=[";
+            for(size_t f = 0; f < n_fields(); f++) {
+                if(f > 0)
+                    o << " ";
+                o << field_bits[f] << "@" << field_pack[f] << ":" << field_offset[f];
+            }
+            o << "]";
+        }
+        o << ">";
+
+        return o.str();
+    }
+
+    std::ostream &operator<<(std::ostream &stream, const PackLayout &l) {
+        stream << l.to_string(false);
+        return stream;
+    }
+
     namespace Vector {
 
-        size_t pack_count(const size_t plaintext_bits, const PaillierBase &pai) {
-            return pai.plaintext_size_bits() / (plaintext_bits + pack_buffer);
+        namespace {
+            /**
+             * dst = bits [offset, offset + width) of the number with the
+             * given limbs. Only touches the limbs of the field, for
+             * limb aligned fields it is a plain copy.
+             */
+            void extract_bits(mpz_ptr dst, const mp_limb_t *limbs, const mp_size_t n_limbs, const size_t offset, const size_t width) {
+                const mp_size_t first = (mp_size_t) (offset / GMP_NUMB_BITS);
+                const unsigned bit = (unsigned) (offset % GMP_NUMB_BITS);
+                if(first >= n_limbs) {
+                    mpz_set_ui(dst, 0);
+                    return;
+                }
+
+                const mp_size_t field_limbs = (mp_size_t) ((bit + width + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS);
+                const mp_size_t n = std::min(field_limbs, n_limbs - first);
+                mp_limb_t *d = mpz_limbs_write(dst, n);
+                if(bit > 0)
+                    mpn_rshift(d, limbs + first, n, bit);
+                else
+                    mpn_copyi(d, limbs + first, n);
+                mpz_limbs_finish(dst, n);
+
+                if((bit + width) % GMP_NUMB_BITS != 0 || bit > 0)
+                    mpz_tdiv_r_2exp(dst, dst, width);
+            }
+
+            /**
+             * Turn the raw bits of a signed slot into its value, adding the
+             * borrow of the slot below. Returns the borrow for the slot above.
+             * @param slot_range 2^width
+             */
+            bool signed_slot(mpz_ptr x, const size_t width, mpz_srcptr slot_range, const bool carry) {
+                if(carry) {
+                    mpz_add_ui(x, x, 1);
+                    if(mpz_tstbit(x, width)) {
+                        /* all ones plus the carry, 0 and carry on */
+                        mpz_set_ui(x, 0);
+                        return true;
+                    }
+                }
+                if(!mpz_tstbit(x, width - 1))
+                    return false;
+                mpz_sub(x, x, slot_range);
+                return true;
+            }
+        }
+
+        size_t pack_count(const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            return pai.plaintext_size_bits() / (plaintext_bits + headroom_bits + pack_buffer);
+        }
+
+        size_t aligned_plaintext_bits(const size_t plaintext_bits, const size_t headroom_bits) {
+            const size_t slot_bits = plaintext_bits + headroom_bits + pack_buffer;
+            const size_t aligned = (slot_bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS * GMP_NUMB_BITS;
+            return aligned - headroom_bits - pack_buffer;
         }
 
-        PackedCiphertext pack_ciphertexts(const Ciphertext *ciphertexts_begin, const Ciphertext *ciphertexts_end, const size_t plaintext_bits, const PaillierBase &pai) {
-            const size_t shift = plaintext_bits + pack_buffer;
+        PackedCiphertext pack_ciphertexts(const Ciphertext *ciphertexts_begin, const Ciphertext *ciphertexts_end, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            const size_t shift = plaintext_bits + headroom_bits + pack_buffer;
             const size_t n_ciphertexts = (size_t) (ciphertexts_end - ciphertexts_begin);
             if(n_ciphertexts < 1)
                 error_exit("not enough ciphertexts!");
-            if(n_ciphertexts > pack_count(plaintext_bits, pai))
+            if(n_ciphertexts > pack_count(plaintext_bits, pai, headroom_bits))
                 error_exit("too many ciphertexts!");
 
+            const KeyContext *key = ciphertexts_begin->key;
+            if(!key)
+                error_exit("no modulus set!");
+            for(auto iter = ciphertexts_begin + 1; iter < ciphertexts_end; iter++) {
+                if(!KeyContext::same_key(key, iter->key))
+                    error_exit("cannot operate on ciphertexts from different keys!");
+            }
+
+            /* With the private key, the whole chain runs mod p^2 and q^2 */
+            if(key->fast_mod) {
+                std::vector<mpz_srcptr> xs;
+                xs.reserve(n_ciphertexts);
+                for(auto iter = ciphertexts_begin; iter < ciphertexts_end; iter++)
+                    xs.push_back(iter->data.get_mpz_t());
+
+                Ciphertext sum(Integer(), key);
+                key->fast_mod->horner_pow2_n2(sum.data, xs, shift);
+                return PackedCiphertext(std::move(sum), n_ciphertexts, plaintext_bits, shift);
+            }
+
+            /* sum = sum^(2^shift) * c, in place */
             const Integer mul = Integer(1) << shift;
 
             Ciphertext sum = *ciphertexts_begin;
             for(auto iter = ciphertexts_begin + 1; iter < ciphertexts_end; iter++) {
-                sum *= mul;
-                sum += *iter;
+                pow_mod(sum.data, sum.data, mul, *key);
+                mul_mod(sum.data, sum.data, iter->data, *key);
             }
 
             return PackedCiphertext(
-                    sum,
+                    std::move(sum),
                     n_ciphertexts,
-                    plaintext_bits
+                    plaintext_bits,
+                    shift
             );
         }
 
-        PackedCiphertext pack_ciphertexts(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai) {
-            return pack_ciphertexts(ciphertexts.begin(), ciphertexts.end(), plaintext_bits, pai);
+        PackedCiphertext pack_ciphertexts(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            return pack_ciphertexts(ciphertexts.begin(), ciphertexts.end(), plaintext_bits, pai, headroom_bits);
         }
 
-        Vec<PackedCiphertext> pack_ciphertexts_vec(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai) {
-            const auto plaintexts_per_pack = pack_count(plaintext_bits, pai);
-            const auto n_vectors = ciphertexts.length() / plaintexts_per_pack;
-            const auto last_vector = ciphertexts.length() % plaintexts_per_pack;
+        Vec<PackedCiphertext> pack_ciphertexts_vec(const Vec<Ciphertext> &ciphertexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            const size_t n = ciphertexts.length();
+            const auto plaintexts_per_pack = pack_count(plaintext_bits, pai, headroom_bits);
+            const auto n_packs = (n + plaintexts_per_pack - 1) / plaintexts_per_pack;
 
             Vec<PackedCiphertext> ret;
-            ret.SetLength(n_vectors + (last_vector > 0 ? 1 : 0));
-            for(size_t i = 0; i < n_vectors; i++) {
-                const auto begin = ciphertexts.begin() + i * plaintexts_per_pack;
-                const auto end = begin + plaintexts_per_pack;
-                ret[i] = pack_ciphertexts(begin, end, plaintext_bits, pai);
-            }
-
-            if(last_vector > 0) {
-                ret[n_vectors] = pack_ciphertexts(ciphertexts.end() - last_vector,
-                                                  ciphertexts.end(),
-                                                  plaintext_bits,
-                                                  pai);
+            ret.SetLength(n_packs);
+
+            /* packs are independent, the last one may be shorter.
+             * An exception must not leave the parallel region, rethrow
+             * the one of the first failing pack after it. */
+            PackErrors errors(n_packs);
+            #pragma omp parallel for schedule(dynamic)
+            for(long i = 0; i < (long) n_packs; i++) {
+                const size_t begin = i * plaintexts_per_pack;
+                const size_t end = std::min(begin + plaintexts_per_pack, n);
+                try {
+                    ret[i] = pack_ciphertexts(ciphertexts.begin() + begin, ciphertexts.begin() + end, plaintext_bits, pai, headroom_bits);
+                } catch(...) {
+                    errors.record(i);
+                }
             }
+            errors.rethrow();
 
             return ret;
         }
 
-        PackedCiphertext encrypt_pack(const Integer *plaintexts_begin, const Integer *plaintexts_end, const size_t plaintext_bits, const PaillierBase &pai) {
-            const size_t shift = plaintext_bits + pack_buffer;
+        PackedCiphertext encrypt_pack(const Integer *plaintexts_begin, const Integer *plaintexts_end, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            const size_t shift = plaintext_bits + headroom_bits + pack_buffer;
             const size_t n_plaintexts = (size_t) (plaintexts_end - plaintexts_begin);
 
-            if(n_plaintexts > pack_count(plaintext_bits, pai))
+            if(n_plaintexts > pack_count(plaintext_bits, pai, headroom_bits))
                 error_exit("trying to pack too many elements!");
 
             Integer sum = n_plaintexts > 0 ? *plaintexts_begin : 0;
@@ -112,33 +465,36 @@ namespace ophelib {
             return PackedCiphertext(
                     pai.encrypt(sum),
                     (const size_t) n_plaintexts,
-                    plaintext_bits
+                    plaintext_bits,
+                    shift
             );
         }
 
-        PackedCiphertext encrypt_pack(const Vec<Integer> &plaintexts, size_t plaintext_bits, const PaillierBase &pai) {
-            return encrypt_pack(plaintexts.begin(), plaintexts.end(), plaintext_bits, pai);
+        PackedCiphertext encrypt_pack(const Vec<Integer> &plaintexts, size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            return encrypt_pack(plaintexts.begin(), plaintexts.end(), plaintext_bits, pai, headroom_bits);
         }
 
-        Vec<PackedCiphertext> encrypt_pack_vec(const Vec<Integer> &plaintexts, const size_t plaintext_bits, const PaillierBase &pai) {
-            const auto plaintexts_per_pack = pack_count(plaintext_bits, pai);
-            const auto n_vectors = plaintexts.length() / plaintexts_per_pack;
-            const auto last_vector = plaintexts.length() % plaintexts_per_pack;
+        Vec<PackedCiphertext> encrypt_pack_vec(const Vec<Integer> &plaintexts, const size_t plaintext_bits, const PaillierBase &pai, const size_t headroom_bits) {
+            const size_t n = plaintexts.length();
+            const auto plaintexts_per_pack = pack_count(plaintext_bits, pai, headroom_bits);
+            const auto n_packs = (n + plaintexts_per_pack - 1) / plaintexts_per_pack;
 
             Vec<PackedCiphertext> ret;
-            ret.SetLength(n_vectors + (last_vector > 0 ? 1 : 0));
-            for(size_t i = 0; i < n_vectors; i++) {
-                const auto begin = plaintexts.begin() + i * plaintexts_per_pack;
-                const auto end = begin + plaintexts_per_pack;
-                ret[i] = encrypt_pack(begin, end, plaintext_bits, pai);
-            }
-
-            if(last_vector > 0) {
-                ret[n_vectors] = encrypt_pack(plaintexts.end() - last_vector,
-                                              plaintexts.end(),
-                                              plaintext_bits,
-                                              pai);
+            ret.SetLength(n_packs);
+
+            /* one encryption per pack, the last one may be shorter */
+            PackErrors errors(n_packs);
+            #pragma omp parallel for schedule(dynamic)
+            for(long i = 0; i < (long) n_packs; i++) {
+                const size_t begin = i * plaintexts_per_pack;
+                const size_t end = std::min(begin + plaintexts_per_pack, n);
+                try {
+                    ret[i] = encrypt_pack(plaintexts.begin() + begin, plaintexts.begin() + end, plaintext_bits, pai, headroom_bits);
+                } catch(...) {
+                    errors.record(i);
+                }
             }
+            errors.rethrow();
 
             return ret;
         }
@@ -150,38 +506,44 @@ namespace ophelib {
         }
 
         void decrypt_pack(const PackedCiphertext &ciphertext, Integer *plaintexts_begin, Integer *plaintexts_end, const PaillierBase &pai) {
-            const long n_plaintexts = ciphertext.n_plaintexts;
-            const size_t plaintext_bits = ciphertext.plaintext_bits;
+            const size_t n_plaintexts = ciphertext.n_plaintexts;
+            const size_t shift = ciphertext.slot_bits;
+            const size_t stride = ciphertext.slot_stride;
 
-            if(n_plaintexts > (long)pack_count(plaintext_bits, pai))
+            if(shift < 1 || stride < 1 || n_plaintexts * stride > pai.plaintext_size_bits() / shift)
                 error_exit("trying to unpack too many elements!");
 
-            const size_t shift = plaintext_bits + pack_buffer;
-
-            if(n_plaintexts != (plaintexts_end - plaintexts_begin))
+            if((long) n_plaintexts != (plaintexts_end - plaintexts_begin))
                 error_exit("trying to unpack too many elements!");
 
             const Integer mask_plus_1 = Integer(1) << shift;
-            const Integer mask = mask_plus_1 - 1;
 
+            /* The slots are signed, a negative slot borrows 1 from the next
+             * higher one. Read them from the two's complement of the whole
+             * pack, lowest first, and add the borrows back. With a stride,
+             * the slots between the plaintexts only pass on their borrow. */
+            const size_t n_slots = n_plaintexts * stride;
             Integer sum = pai.decrypt(ciphertext.data);
-
-            for(auto i = n_plaintexts; i-- != 0;) {
-                mpz_and(plaintexts_begin[i].get_mpz_t(), sum.get_mpz_t(), mask.get_mpz_t());
-                const bool is_neg = (bool)mpz_tstbit(sum.get_mpz_t(), shift - 1);
-                if(is_neg) {
-                    plaintexts_begin[i] -= mask_plus_1;
-                    sum -= plaintexts_begin[i];
-                }
-                sum >>= shift;
+            mpz_fdiv_r_2exp(sum.get_mpz_t(), sum.get_mpz_t(), shift * n_slots);
+            const mp_limb_t *limbs = mpz_limbs_read(sum.get_mpz_t());
+            const mp_size_t n_limbs = (mp_size_t) mpz_size(sum.get_mpz_t());
+
+            Integer cross_term;
+            bool carry = false;
+            for(size_t k = 0; k < n_slots; k++) {
+                const mpz_ptr x = k % stride == stride - 1
+                                  ? plaintexts_begin[n_plaintexts - 1 - k / stride].get_mpz_t()
+                                  : cross_term.get_mpz_t();
+                extract_bits(x, limbs, n_limbs, k * shift, shift);
+                carry = signed_slot(x, shift, mask_plus_1.get_mpz_t(), carry);
             }
         }
 
         void decrypt_pack(const PackedCiphertext &ciphertext, Vec<Integer> &plaintexts, const PaillierBase &pai) {
             const size_t n_plaintexts = ciphertext.n_plaintexts;
-            const size_t plaintext_bits = ciphertext.plaintext_bits;
+            const size_t shift = ciphertext.slot_bits;
 
-            if(n_plaintexts > pack_count(plaintext_bits, pai))
+            if(shift < 1 || n_plaintexts * ciphertext.slot_stride > pai.plaintext_size_bits() / shift)
                 error_exit("trying to unpack too many elements!");
 
             plaintexts.SetLength(n_plaintexts);
@@ -253,5 +615,228 @@ namespace ophelib {
             }
             return ret;
         }
+
+        PackedCiphertext sum(const Vec<PackedCiphertext> &v) {
+            const long n = v.length();
+            if(n == 0)
+                error_exit("empty vector!");
+
+            size_t bits = 0;
+            for(long i = 0; i < n; i++) {
+                check_layout(v[0], v[i]);
+                bits = std::max(bits, v[i].plaintext_bits);
+            }
+
+            PackedCiphertext ret = v[0];
+            ret.plaintext_bits = grown_bits(ret, bits + mul_bits(n));
+            for(long i = 1; i < n; i++)
+                ret.data += v[i].data;
+            return ret;
+        }
+
+        Vec<PackedCiphertext> dot(const Mat<Integer> &W, const Vec<PackedCiphertext> &x, const PaillierBase &pai) {
+            const long n_packs = x.length();
+            if(n_packs == 0)
+                error_exit("empty vector!");
+
+            const size_t shift = x[0].slot_bits;
+            const size_t stride = x[0].n_plaintexts;
+            const KeyContext *key = x[0].data.key;
+            if(!key)
+                error_exit("no modulus set!");
+
+            /* column of W where every pack starts */
+            std::vector<long> col_begin(n_packs + 1, 0);
+            size_t x_bits = 0;
+            for(long j = 0; j < n_packs; j++) {
+                if(x[j].slot_bits != shift || x[j].slot_stride != 1 ||
+                   x[j].n_plaintexts < 1 || x[j].n_plaintexts > stride)
+                    error_exit("packed ciphertexts have different layouts!");
+                if(!KeyContext::same_key(key, x[j].data.key))
+                    error_exit("cannot operate on ciphertexts from different keys!");
+                x_bits = std::max(x_bits, x[j].plaintext_bits);
+                col_begin[j + 1] = col_begin[j] + (long) x[j].n_plaintexts;
+            }
+            if(W.NumCols() != col_begin[n_packs])
+                dimension_mismatch();
+
+            Integer w_max = 0;
+            for(long r = 0; r < W.NumRows(); r++)
+                for(long c = 0; c < W.NumCols(); c++)
+                    if(mpz_cmpabs(W[r][c].get_mpz_t(), w_max.get_mpz_t()) > 0)
+                        mpz_abs(w_max.get_mpz_t(), W[r][c].get_mpz_t());
+
+            /* every slot, also the cross terms, sums at most x length products */
+            const size_t out_bits = x_bits + mul_bits(w_max) + mul_bits(Integer(W.NumCols()));
+            if(out_bits + pack_buffer > shift)
+                error_exit("packed slots would overflow, pack with more headroom!");
+
+            /* row r of a result pack sits at slot (rows - r) * stride - 1,
+             * its cross terms reach stride - 1 slots above and below */
+            const size_t n_slots = pai.plaintext_size_bits() / shift;
+            if(n_slots + 1 < 2 * stride)
+                error_exit("too many plaintexts per pack for a product!");
+            const long rows_per_pack = (long) ((n_slots + 1) / stride - 1);
+            const long n_rows = W.NumRows();
+            const long n_out = (n_rows + rows_per_pack - 1) / rows_per_pack;
+
+            Vec<PackedCiphertext> ret;
+            ret.SetLength(n_out);
+
+            #pragma omp parallel for schedule(dynamic)
+            for(long o = 0; o < n_out; o++) {
+                const long row_begin = o * rows_per_pack;
+                const long rows = std::min(rows_per_pack, n_rows - row_begin);
+                std::vector<Integer> coeffs((size_t) rows * stride + stride - 1);
+
+                Ciphertext sum;
+                for(long j = 0; j < n_packs; j++) {
+                    /* weight of plaintext i goes to the slot which meets
+                     * its slot n - 1 - i at the row's result slot */
+                    const long n = (long) x[j].n_plaintexts;
+                    for(auto &c: coeffs)
+                        c = 0;
+                    for(long r = 0; r < rows; r++) {
+                        const long result_slot = (rows - r) * (long) stride - 1;
+                        for(long i = 0; i < n; i++)
+                            coeffs[result_slot - (n - 1 - i)] = W[row_begin + r][col_begin[j] + i];
+                    }
+
+                    Integer mul = 0;
+                    for(size_t k = coeffs.size(); k-- != 0;) {
+                        mul <<= shift;
+                        mul += coeffs[k];
+                    }
+
+                    if(j == 0)
+                        sum = x[j].data * mul;
+                    else
+                        sum += x[j].data * mul;
+                }
+
+                ret[o] = PackedCiphertext(std::move(sum), (size_t) rows, out_bits, shift, stride);
+            }
+
+            return ret;
+        }
+
+        namespace {
+            /**
+             * Fields of every pack of the layout, throws if a pack does not
+             * fit the plaintext size
+             */
+            std::vector< std::vector<size_t> > checked_pack_fields(const PackLayout &layout, const PaillierBase &pai) {
+                const auto ret = layout.pack_fields();
+                for(const auto &fields: ret) {
+                    if(fields.empty())
+                        continue;
+                    const size_t top = fields.back();
+                    if(field_end(layout, top) > pai.plaintext_size_bits())
+                        error_exit("pack layout does not fit the key!");
+                }
+                return ret;
+            }
+        }
+
+        Vec<Ciphertext> encrypt_pack(const Vec<Integer> &fields, const PackLayout &layout, const PaillierBase &pai) {
+            if((size_t) fields.length() != layout.n_fields())
+                dimension_mismatch();
+            const auto packs = checked_pack_fields(layout, pai);
+            for(size_t f = 0; f < layout.n_fields(); f++) {
+                if(fields[f].size_bits() > layout.field_bits[f])
+                    error_exit("plaintext size too large!");
+            }
+
+            Vec<Ciphertext> ret;
+            ret.SetLength(layout.n_packs);
+
+            #pragma omp parallel for schedule(dynamic)
+            for(long p = 0; p < (long) layout.n_packs; p++) {
+                /* Horner from the highest field down */
+                Integer sum = 0;
+                size_t offset = packs[p].empty() ? 0 : layout.field_offset[packs[p].back()];
+                for(auto iter = packs[p].rbegin(); iter != packs[p].rend(); iter++) {
+                    sum <<= offset - layout.field_offset[*iter];
+                    sum += fields[*iter];
+                    offset = layout.field_offset[*iter];
+                }
+                sum <<= offset;
+                ret[p] = pai.encrypt(sum);
+            }
+
+            return ret;
+        }
+
+        Vec<Ciphertext> pack_ciphertexts(const Vec<Ciphertext> &fields, const PackLayout &layout, const PaillierBase &pai) {
+            if((size_t) fields.length() != layout.n_fields())
+                dimension_mismatch();
+            const auto packs = checked_pack_fields(layout, pai);
+
+            const KeyContext *key = layout.n_fields() > 0 ? fields[0].key : nullptr;
+            for(long f = 0; f < fields.length(); f++) {
+                if(!fields[f].key)
+                    error_exit("no modulus set!");
+                if(!KeyContext::same_key(key, fields[f].key))
+                    error_exit("cannot operate on ciphertexts from different keys!");
+            }
+
+            Vec<Ciphertext> ret;
+            ret.SetLength(layout.n_packs);
+
+            #pragma omp parallel for schedule(dynamic)
+            for(long p = 0; p < (long) layout.n_packs; p++) {
+                /* sum = sum^(2^gap) * c, from the highest field down */
+                Ciphertext sum(Integer(1), key);
+                size_t offset = packs[p].empty() ? 0 : layout.field_offset[packs[p].back()];
+                for(auto iter = packs[p].rbegin(); iter != packs[p].rend(); iter++) {
+                    const size_t gap = offset - layout.field_offset[*iter];
+                    if(gap > 0)
+                        pow_mod(sum.data, sum.data, Integer(1) << gap, *key);
+                    mul_mod(sum.data, sum.data, fields[*iter].data, *key);
+                    offset = layout.field_offset[*iter];
+                }
+                if(offset > 0)
+                    pow_mod(sum.data, sum.data, Integer(1) << offset, *key);
+                ret[p] = std::move(sum);
+            }
+
+            return ret;
+        }
+
+        Vec<Integer> decrypt_pack(const Vec<Ciphertext> &packs, const PackLayout &layout, const PaillierBase &pai) {
+            if((size_t) packs.length() != layout.n_packs)
+                dimension_mismatch();
+            const auto pack_fields = checked_pack_fields(layout, pai);
+
+            Vec<Integer> ret;
+            ret.SetLength(layout.n_fields());
+
+            #pragma omp parallel for schedule(dynamic)
+            for(long p = 0; p < (long) layout.n_packs; p++) {
+                const auto &fields = pack_fields[p];
+                if(fields.empty())
+                    continue;
+
+                /* same as for uniform slots, see decrypt_pack(PackedCiphertext) */
+                const size_t top = fields.back();
+                Integer sum = pai.decrypt(packs[p]);
+                mpz_fdiv_r_2exp(sum.get_mpz_t(), sum.get_mpz_t(), layout.field_offset[top] + layout.field_bits[top] + pack_buffer);
+                const mp_limb_t *limbs = mpz_limbs_read(sum.get_mpz_t());
+                const mp_size_t n_limbs = (mp_size_t) mpz_size(sum.get_mpz_t());
+
+                Integer slot_range;
+                bool carry = false;
+                for(const size_t f: fields) {
+                    const size_t width = layout.field_bits[f] + pack_buffer;
+                    const mpz_ptr x = ret[f].get_mpz_t();
+                    extract_bits(x, limbs, n_limbs, layout.field_offset[f], width);
+                    mpz_set_ui(slot_range.get_mpz_t(), 0);
+                    mpz_setbit(slot_range.get_mpz_t(), width);
+                    carry = signed_slot(x, width, slot_range.get_mpz_t(), carry);
+                }
+            }
+
+            return ret;
+        }
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "ophelib/paillier.h"
 #include "ophelib/random.h"
 #include "ophelib/error.h"
+#include "ophelib/memory.h"
 
 #include <gmpxx.h>
 #include <memory>
@@ -14,14 +15,14 @@ namespace ophelib {
 
     Paillier::Paillier(const PublicKey &pub_, const PrivateKey &priv_)
             : PaillierBase(pub_, priv_) {
-        if(priv_.a != 0 || priv_.a_bits == 0)
+        if(priv_.a != 0 || priv_.a_bits != 0)
             error_exit("invalid private key, not from a Paillier instance!");
         precompute();
     }
 
     Paillier::Paillier(const KeyPair &pair)
             : PaillierBase(pair) {
-        if(pair.priv.a != 0 || pair.priv.a_bits == 0)
+        if(pair.priv.a != 0 || pair.priv.a_bits != 0)
             error_exit("invalid private key, not from a Paillier instance!");
         precompute();
     }
@@ -70,6 +71,7 @@ namespace ophelib {
         }
 
         n2_shared = std::make_shared<Integer>(n2);
+        update_key_context();
         pos_neg_boundary = pub.n / 2;
         plaintxt_upper_boundary = pos_neg_boundary;
         plaintxt_lower_boundary = -pos_neg_boundary;
@@ -82,17 +84,14 @@ namespace ophelib {
         #ifdef DEBUG
         /* If they have the same pointer, they are the same. If not, it might
          * still be the same number, but initialized seperately. */
-        if(this->n2_shared.get() != ciphertext.n2_shared.get() &&
-           *(this->n2_shared.get()) != *(ciphertext.n2_shared.get()))
+        if(!KeyContext::same_key(key_context.get(), ciphertext.key))
             error_exit("cannot decrypt a ciphertext from another n!");
         #endif
 
-        Integer ret = (
-            Integer::L(
-                ciphertext.data.pow_mod_n(lambda, n2),
-                pub.n
-            ) * mu
-        ) % pub.n;
+        Integer ret;
+        pow_mod(ret, ciphertext.data, lambda, n2);
+        ret = Integer::L(ret, pub.n);
+        mul_mod(ret, ret, mu, pub.n);
 
         if(ret > pos_neg_boundary) {
             ret = ret - pub.n;
@@ -118,13 +117,13 @@ namespace ophelib {
             ret = pub.g.pow_mod_n(plaintext, n2);
         }
 
-        return Ciphertext(ret, n2_shared);
+        return Ciphertext(ret, key_context.get());
     }
 
     Ciphertext Paillier::randomize(Ciphertext ciphertext) const {
-        Integer ret = (ciphertext.data * randomizer_val()) % *n2_shared.get();
-
-        return Ciphertext(ret, n2_shared);
+        mul_mod(ciphertext.data, ciphertext.data, randomizer_val(), n2);
+        ciphertext.key = key_context.get();
+        return ciphertext;
     }
 
     Integer Paillier::randomizer_val() const {
@@ -132,6 +131,12 @@ namespace ophelib {
         return val.pow_mod_n(pub.n, n2);
     }
 
+    size_t Paillier::memory_usage() const {
+        return PaillierBase::memory_usage() - sizeof(PaillierBase) + sizeof(Paillier)
+               + heap_usage(n_minus_one) + heap_usage(n2)
+               + heap_usage(lambda) + heap_usage(mu);
+    }
+
     const std::string Paillier::to_string(bool brief) const {
         std::ostringstream o("");
         o << "<Paillier[" << key_size_bits << "]";
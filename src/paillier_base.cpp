@@ -1,23 +1,127 @@
 #include "ophelib/paillier_base.h"
 #include "ophelib/error.h"
+#include "ophelib/memory.h"
 
+#include <map>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <vector>
 
 namespace ophelib {
-    Ciphertext::Ciphertext(const Integer &data_, const std::shared_ptr <Integer> &n2_shared_, const std::shared_ptr<FastMod> &fast_mod_)
-            : data(data_),
-              n2_shared(n2_shared_),
-              fast_mod(fast_mod_) { }
 
-    Ciphertext::Ciphertext(const Integer &data_, const std::shared_ptr <Integer> &n2_shared_)
+    namespace {
+        /**
+         * Heap memory of an object held by a shared pointer created
+         * with make_shared: control block (vtable pointer and two
+         * counters) and object in one allocation.
+         */
+        template<typename T>
+        size_t shared_usage(const std::shared_ptr<T> &p) {
+            if(!p)
+                return 0;
+            return heap_block_size(2 * sizeof(void*) + sizeof(T)) + heap_usage(*p);
+        }
+    }
+
+    KeyContext::KeyContext(const std::shared_ptr<Integer> &n2_shared_, const std::shared_ptr<FastMod> &fast_mod_)
+            : n2_shared(n2_shared_),
+              fast_mod(fast_mod_),
+              fingerprint(n2_shared_ ? compute_fingerprint(*n2_shared_) : 0) {
+        if(!n2_shared)
+            error_exit("no modulus set!");
+    }
+
+    const Integer &KeyContext::n2() const {
+        return *n2_shared;
+    }
+
+    size_t KeyContext::memory_usage() const {
+        return sizeof(KeyContext) + shared_usage(n2_shared) + shared_usage(fast_mod);
+    }
+
+    bool KeyContext::same_key(const KeyContext *a, const KeyContext *b) {
+        if(a == b)
+            return true;
+        if(!a || !b)
+            return false;
+        return a->fingerprint == b->fingerprint;
+    }
+
+    uint64_t KeyContext::compute_fingerprint(const Integer &n2) {
+        /* FNV-1a over the limbs, followed by a splitmix64 finalizer.
+         * n^2 is public, this does not need to be a cryptographic hash. */
+        const mpz_srcptr z = n2.get_mpz_t();
+        const mp_limb_t *limbs = mpz_limbs_read(z);
+        uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t) mpz_size(z);
+        for(size_t i = 0; i < mpz_size(z); i++) {
+            h ^= (uint64_t) limbs[i];
+            h *= 0x100000001b3ULL;
+        }
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+    void mul_mod(Integer &dst, const Integer &a, const Integer &b, const KeyContext &ctx) {
+        mul_mod(dst, a, b, ctx.n2());
+    }
+
+    void sqr_mod(Integer &dst, const Integer &a, const KeyContext &ctx) {
+        sqr_mod(dst, a, ctx.n2());
+    }
+
+    void div_mod(Integer &dst, const Integer &a, const Integer &b, const KeyContext &ctx) {
+        div_mod(dst, a, b, ctx.n2());
+    }
+
+    void inv_mod(Integer &dst, const Integer &a, const KeyContext &ctx) {
+        inv_mod(dst, a, ctx.n2());
+    }
+
+    void pow_mod(Integer &dst, const Integer &base, const Integer &exp, const KeyContext &ctx) {
+        if(ctx.fast_mod)
+            ctx.fast_mod->pow_mod_n2(dst, base, exp);
+        else
+            pow_mod(dst, base, exp, ctx.n2());
+    }
+
+    const KeyContext *KeyContext::intern(const std::shared_ptr<Integer> &n2_shared, const std::shared_ptr<FastMod> &fast_mod) {
+        if(!n2_shared)
+            error_exit("got a null pointer");
+
+        static std::mutex mutex;
+        static std::multimap<uint64_t, std::unique_ptr<KeyContext>> registry;
+
+        const uint64_t fingerprint = compute_fingerprint(*n2_shared);
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto range = registry.equal_range(fingerprint);
+        for(auto iter = range.first; iter != range.second; iter++) {
+            const KeyContext *ctx = iter->second.get();
+            if(bool(ctx->fast_mod) == bool(fast_mod) && ctx->n2() == *n2_shared)
+                return ctx;
+        }
+        const auto iter = registry.emplace(fingerprint, std::unique_ptr<KeyContext>(new KeyContext(n2_shared, fast_mod)));
+        return iter->second.get();
+    }
+
+    Ciphertext::Ciphertext(const Integer &data_, const KeyContext *key_)
             : data(data_),
-              n2_shared(n2_shared_) { }
+              key(key_) { }
+
+    Ciphertext::Ciphertext(Integer &&data_, const KeyContext *key_)
+            : data(std::move(data_)),
+              key(key_) { }
 
     Ciphertext::Ciphertext(const Integer &data_)
-            : data(data_) { }
+            : data(data_),
+              key(nullptr) { }
 
-    Ciphertext::Ciphertext() { }
+    Ciphertext::Ciphertext()
+            : key(nullptr) { }
 
     bool Ciphertext::operator==(const Ciphertext &input) const {
         return this->data == input.data;
@@ -27,64 +131,85 @@ namespace ophelib {
         return this->data != input.data;
     }
 
-    Ciphertext Ciphertext::operator-() const {
-        if(!this->n2_shared)
+    Ciphertext Ciphertext::operator-() const & {
+        if(!this->key)
             error_exit("no modulus set!");
 
-        Ciphertext ret = *this;
-        ret.data = this->data.inv_mod_n(*n2_shared.get());
+        Ciphertext ret(Integer(), key);
+        inv_mod(ret.data, this->data, *key);
         return ret;
     }
 
-    Ciphertext Ciphertext::operator+(const Ciphertext &other) const {
+    Ciphertext Ciphertext::operator-() && {
+        if(!this->key)
+            error_exit("no modulus set!");
+
+        inv_mod(this->data, this->data, *key);
+        return std::move(*this);
+    }
+
+    Ciphertext Ciphertext::operator+(const Ciphertext &other) const & {
         Ciphertext ret = *this;
         ret += other;
         return ret;
     }
 
+    Ciphertext Ciphertext::operator+(const Ciphertext &other) && {
+        *this += other;
+        return std::move(*this);
+    }
+
     void Ciphertext::operator+=(const Ciphertext &other) {
-        if(!this->n2_shared)
+        if(!this->key)
             error_exit("no modulus set!");
 
-        if(this->n2_shared.get() != other.n2_shared.get() &&
-           *(this->n2_shared.get()) != *(other.n2_shared.get()))
+        if(!KeyContext::same_key(this->key, other.key))
             error_exit("cannot operate on ciphertexts from different keys!");
 
-        this->data = (this->data * other.data) % *n2_shared.get();
+        mul_mod(this->data, this->data, other.data, *key);
     }
 
-    Ciphertext Ciphertext::operator-(const Ciphertext &other) const {
+    Ciphertext Ciphertext::operator-(const Ciphertext &other) const & {
         Ciphertext ret = *this;
         ret -= other;
         return ret;
     }
 
+    Ciphertext Ciphertext::operator-(const Ciphertext &other) && {
+        *this -= other;
+        return std::move(*this);
+    }
+
     void Ciphertext::operator-=(const Ciphertext &other) {
-        if(!this->n2_shared)
+        if(!this->key)
             error_exit("no modulus set!");
 
-        if(this->n2_shared.get() != other.n2_shared.get() &&
-           *(this->n2_shared.get()) != *(other.n2_shared.get()))
+        if(!KeyContext::same_key(this->key, other.key))
             error_exit("cannot operate on ciphertexts from different keys!");
 
-        this->data = (this->data * other.data.inv_mod_n(*n2_shared.get()))  % *n2_shared.get();
+        div_mod(this->data, this->data, other.data, *key);
     }
 
-    Ciphertext Ciphertext::operator*(const Integer &other) const {
+    Ciphertext Ciphertext::operator*(const Integer &other) const & {
         Ciphertext ret = *this;
         ret *= other;
         return ret;
     }
 
+    Ciphertext Ciphertext::operator*(const Integer &other) && {
+        *this *= other;
+        return std::move(*this);
+    }
+
     void Ciphertext::operator*=(const Integer &other) {
-        if(!this->n2_shared)
+        if(!this->key)
             error_exit("no modulus set!");
 
-        if(fast_mod) {
-            this->data = fast_mod.get()->pow_mod_n2(this->data, other);
-        } else {
-            this->data = this->data.pow_mod_n(other, *n2_shared.get());
-        }
+        pow_mod(this->data, this->data, other, *key);
+    }
+
+    size_t Ciphertext::memory_usage() const {
+        return sizeof(Ciphertext) + heap_usage(data);
     }
 
     const std::string Ciphertext::to_string(const bool brief) const {
@@ -92,8 +217,8 @@ namespace ophelib {
 
         o << "<Ciphertext";
         o << " data=" << data.to_string(brief);
-        if(n2_shared)
-            o << " n2_shared=" << n2_shared.get()->to_string(brief);
+        if(key)
+            o << " n2=" << key->n2().to_string(brief);
         o << ">";
 
         return o.str();
@@ -106,6 +231,7 @@ namespace ophelib {
 
     PrivateKey::PrivateKey(const size_t key_size_bits_, const Integer &p_, const Integer &q_)
             : key_size_bits(key_size_bits_),
+              a_bits(0),
               p(p_),
               q(q_) { }
 
@@ -213,7 +339,7 @@ namespace ophelib {
         return priv;
     }
 
-    const KeyPair PaillierBase::get_keypair() const {
+    KeyPair PaillierBase::get_keypair() const {
         return KeyPair(get_pub(), get_priv());
     }
 
@@ -230,6 +356,37 @@ namespace ophelib {
         return o.str();
     }
 
+    size_t PaillierBase::memory_usage() const {
+        size_t ret = sizeof(PaillierBase)
+                     + heap_usage(priv.p) + heap_usage(priv.q) + heap_usage(priv.a)
+                     + heap_usage(pub.n) + heap_usage(pub.g)
+                     + heap_usage(pos_neg_boundary)
+                     + heap_usage(plaintxt_lower_boundary)
+                     + heap_usage(plaintxt_upper_boundary)
+                     + heap_block_size(retired_key_contexts.capacity() * sizeof(std::shared_ptr<KeyContext>));
+
+        /* contexts share n^2 and FastMod with this instance
+         * and with each other, count every object once */
+        std::set<const void*> seen;
+        auto add = [&ret, &seen](const void *p, const size_t bytes) {
+            if(p && seen.insert(p).second)
+                ret += bytes;
+        };
+        add(n2_shared.get(), shared_usage(n2_shared));
+        add(fast_mod.get(), shared_usage(fast_mod));
+
+        std::vector<std::shared_ptr<KeyContext>> contexts(retired_key_contexts);
+        contexts.push_back(key_context);
+        for(const auto &ctx: contexts) {
+            if(!ctx)
+                continue;
+            add(ctx.get(), heap_block_size(2 * sizeof(void*) + sizeof(KeyContext)));
+            add(ctx->n2_shared.get(), shared_usage(ctx->n2_shared));
+            add(ctx->fast_mod.get(), shared_usage(ctx->fast_mod));
+        }
+        return ret;
+    }
+
     size_t PaillierBase::ciphertext_size_bits() const {
         return key_size_bits * 2;
     }
@@ -246,11 +403,25 @@ namespace ophelib {
         return n2_shared;
     }
 
-    const Integer PaillierBase::plaintext_lower_boundary() const {
+    const KeyContext *PaillierBase::get_key_context() const {
+        return key_context.get();
+    }
+
+    void PaillierBase::update_key_context() {
+        if(key_context)
+            retired_key_contexts.push_back(key_context);
+        key_context = std::make_shared<KeyContext>(n2_shared, fast_mod);
+    }
+
+    void PaillierBase::release_retired_key_contexts() {
+        std::vector<std::shared_ptr<KeyContext>>().swap(retired_key_contexts);
+    }
+
+    Integer PaillierBase::plaintext_lower_boundary() const {
         return plaintxt_lower_boundary;
     }
 
-    const Integer PaillierBase::plaintext_upper_boundary() const {
+    Integer PaillierBase::plaintext_upper_boundary() const {
         return plaintxt_upper_boundary;
     }
 }
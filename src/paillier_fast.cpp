@@ -1,8 +1,109 @@
 #include "ophelib/paillier_fast.h"
 #include "ophelib/random.h"
 #include "ophelib/omp_wrap.h"
+#include "ophelib/memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 namespace ophelib {
+
+    namespace {
+        /**
+         * Primes below 2^16, used for sieving prime candidates.
+         */
+        const std::vector<unsigned long> &sieve_primes() {
+            static const std::vector<unsigned long> primes = [](){
+                const unsigned long limit = 1UL << 16;
+                std::vector<bool> composite(limit, false);
+                std::vector<unsigned long> ret(1, 2);
+                for(unsigned long i = 3; i < limit; i += 2) {
+                    if(composite[i])
+                        continue;
+                    ret.push_back(i);
+                    for(unsigned long j = i * i; j < limit; j += 2 * i)
+                        composite[j] = true;
+                }
+                return ret;
+            }();
+            return primes;
+        }
+
+        /**
+         * Inverse of x mod m, for 0 < x < m and gcd(x, m) = 1.
+         */
+        unsigned long inv_mod_ulong(const unsigned long x, const unsigned long m) {
+            long t = 0, new_t = 1;
+            long r = m, new_r = x;
+            while(new_r != 0) {
+                const long quot = r / new_r, tmp_t = t - quot * new_t, tmp_r = r - quot * new_r;
+                t = new_t; new_t = tmp_t;
+                r = new_r; new_r = tmp_r;
+            }
+            return t < 0 ? t + m : t;
+        }
+
+        /**
+         * Find the first prime in the progression start + k * step, k >= 0.
+         *
+         * Candidates are sieved by all small primes in windows, so only
+         * the survivors go through the (expensive) probabilistic prime
+         * test. start has to be larger than the sieving primes.
+         *
+         * Gives up and returns false as soon as cancel is set.
+         */
+        bool next_prime_progression(const Integer &start, const Integer &step,
+                                    const std::atomic<bool> &cancel, Integer &ret) {
+            const size_t window = 4096;
+            const auto &primes = sieve_primes();
+            const size_t n_primes = primes.size();
+
+            /* for every small prime s, the next k in the window for which
+               start + k * step is divisible by s. Primes which divide step
+               never divide a candidate (or always, then there is no prime). */
+            std::vector<unsigned long> step_mod(n_primes), offsets(n_primes);
+            for(size_t i = 0; i < n_primes; i++) {
+                const unsigned long s = primes[i];
+                const unsigned long start_s = mpz_fdiv_ui(start.get_mpz_t(), s);
+                step_mod[i] = mpz_fdiv_ui(step.get_mpz_t(), s);
+                if(step_mod[i] == 0) {
+                    if(start_s == 0)
+                        error_exit("progression does not contain any primes");
+                    continue;
+                }
+                offsets[i] = ((s - start_s) % s) * inv_mod_ulong(step_mod[i], s) % s;
+            }
+
+            std::vector<bool> composite(window);
+            Integer base = start;
+            while(true) {
+                std::fill(composite.begin(), composite.end(), false);
+                for(size_t i = 0; i < n_primes; i++) {
+                    if(step_mod[i] == 0)
+                        continue;
+                    const unsigned long s = primes[i];
+                    unsigned long k = offsets[i];
+                    for(; k < window; k += s)
+                        composite[k] = true;
+                    offsets[i] = k - window;
+                }
+
+                for(size_t k = 0; k < window; k++) {
+                    if(composite[k])
+                        continue;
+                    if(cancel)
+                        return false;
+                    ret = base + step * Integer(k);
+                    if(ret.is_prime())
+                        return true;
+                }
+
+                base = base + step * Integer(window);
+            }
+        }
+    }
+
     PaillierFast::PaillierFast(const size_t key_size_bits_, const size_t a_bits_, const size_t r_bits_)
             : PaillierBase(key_size_bits_),
               a_bits(a_bits_),
@@ -123,28 +224,41 @@ namespace ophelib {
     void PaillierFast::generate_keys() {
         Integer p, q, n, g, a;
         const size_t prime_size_bits = key_size_bits / 2 - a_bits;
-        Random& rand = Random::instance();
 
         do {
-            Integer cp, cq;
-
-            cp = rand.rand_int_bits(prime_size_bits);
-            if(cp.size_bits() != prime_size_bits)
-                continue;
-            cq = rand.rand_int_bits(prime_size_bits);
-            if(cq.size_bits() != prime_size_bits)
-                continue;
-
-            a = rand.rand_prime(a_bits);
-
-            p = a * cp + 1;
-            while(!p.is_prime())
-                p = p + a;
-
-            q = a * cq + 1;
-            while(!q.is_prime())
-                q = q + a;
+            a = Random::instance().rand_prime(a_bits);
+
+            /* Every thread searches its own progressions a * c + 1, starting
+               from its own random c. The first two primes found become p and
+               q, the remaining searches are cancelled. */
+            std::vector<Integer> found;
+            std::atomic<bool> done(false);
+            omp_declare_lock(found_lock);
+            omp_init_lock(&found_lock);
+
+            #pragma omp parallel
+            {
+                Random &rand = Random::instance();
+                Integer c, prime;
+                while(!done) {
+                    c = rand.rand_int_bits(prime_size_bits);
+                    if(c.size_bits() != prime_size_bits)
+                        continue;
+                    if(!next_prime_progression(a * c + 1, a, done, prime))
+                        break;
+
+                    omp_set_lock(&found_lock);
+                    if(found.size() < 2)
+                        found.push_back(prime);
+                    if(found.size() == 2)
+                        done = true;
+                    omp_unset_lock(&found_lock);
+                }
+            }
+            omp_destroy_lock(&found_lock);
 
+            p = found[0];
+            q = found[1];
             n = p * q;
         }
         while(n.size_bits() != key_size_bits || p == q);
@@ -174,6 +288,7 @@ namespace ophelib {
             fast_mod = std::make_shared<FastMod>(priv.p, priv.q, priv.p * priv.p, priv.q * priv.q, pub.n, n2);
             mu = Integer::L(fast_mod.get()->pow_mod_n2(pub.g, priv.a), pub.n).inv_mod_n(pub.n);
         }
+        update_key_context();
 
         pos_neg_boundary = pub.n / 2;
         plaintxt_upper_boundary = pos_neg_boundary;
@@ -190,17 +305,14 @@ namespace ophelib {
         #ifdef DEBUG
         /* If they have the same pointer, they are the same. If not, it might
          * still be the same number, but initialized seperately. */
-        if(ciphertext.n2_shared && this->n2_shared.get() != ciphertext.n2_shared.get() &&
-                *(this->n2_shared.get()) != *(ciphertext.n2_shared.get()))
+        if(ciphertext.key && !KeyContext::same_key(key_context.get(), ciphertext.key))
             error_exit("cannot decrypt a ciphertext from another n!");
         #endif
 
-        Integer ret = (
-            Integer::L(
-                fast_mod.get()->pow_mod_n2(ciphertext.data, priv.a),
-                pub.n
-            ) * mu
-        ) % pub.n;
+        Integer ret;
+        fast_mod.get()->pow_mod_n2(ret, ciphertext.data, priv.a);
+        ret = Integer::L(ret, pub.n);
+        mul_mod(ret, ret, mu, pub.n);
 
         if(ret > pos_neg_boundary) {
             ret -= pub.n;
@@ -224,15 +336,16 @@ namespace ophelib {
         if(!have_pub)
             error_exit("don't have a public key!");
 
-        Integer m = check_plaintext(plaintext),
-                tmp;
+        const Integer m = check_plaintext(plaintext);
 
+        Ciphertext ret(Integer(), key_context.get());
         if(have_priv) {
-            tmp = fast_mod.get()->pow_mod_n2(pub.g, m) * randomizer.get_noise();
+            fast_mod.get()->pow_mod_n2(ret.data, pub.g, m);
         } else {
-            tmp = pub.g.pow_mod_n(m, n2) * randomizer.get_noise();
+            pow_mod(ret.data, pub.g, m, n2);
         }
-        return Ciphertext(tmp % n2, n2_shared, fast_mod);
+        mul_mod(ret.data, ret.data, randomizer.get_noise(), n2);
+        return ret;
     }
 
     Ciphertext PaillierFast::zero_ciphertext() const {
@@ -241,6 +354,13 @@ namespace ophelib {
         return precomputed_zero;
     }
 
+    size_t PaillierFast::memory_usage() const {
+        return PaillierBase::memory_usage() - sizeof(PaillierBase) + sizeof(PaillierFast)
+               + heap_usage(randomizer)
+               + heap_usage(n2) + heap_usage(mu)
+               + heap_usage(precomputed_zero);
+    }
+
     const std::string PaillierFast::to_string(bool brief) const {
         std::ostringstream o("");
 
@@ -265,7 +385,7 @@ namespace ophelib {
         return o.str();
     }
 
-    const Integer PaillierFast::Randomizer::get_noise() const {
+    Integer PaillierFast::Randomizer::get_noise() const {
         if(!precomputed)
             error_exit("lookup table not precomputed!");
 
@@ -288,10 +408,14 @@ namespace ophelib {
         precomputed = true;
     }
 
-    const Integer PaillierFast::Randomizer::r() const {
+    Integer PaillierFast::Randomizer::r() const {
         return Random::instance().rand_int_bits(paillier->r_bits);
     }
 
+    size_t PaillierFast::Randomizer::memory_usage() const {
+        return sizeof(Randomizer) + heap_usage(g_pow_n);
+    }
+
     const std::string PaillierFast::Randomizer::to_string(const bool brief) const {
         std::ostringstream o("");
         o << "<Randomizer";
@@ -314,32 +438,20 @@ namespace ophelib {
         std::cerr << "PaillierFast::FastRandomizer::precompute: precomputing " << r_lut_size<< std::endl;
         #endif
 
-        gn_pow_r.reserve(r_lut_size);
-
-        omp_declare_lock(writelock);
-        omp_init_lock(&writelock);
+        /* every thread draws r() from its own Random instance,
+           so the table can be filled without any locking */
+        gn_pow_r.resize(r_lut_size);
         if(paillier->fast_mod) {
-            paillier->fast_mod.get()->pow_mod_n2(g_pow_n, r());
-
             #pragma omp parallel for
             for(auto i = 0u; i < r_lut_size; i++) {
-                const auto rand = paillier->fast_mod.get()->pow_mod_n2(g_pow_n, r());
-
-                omp_set_lock(&writelock);
-                gn_pow_r.push_back(rand);
-                omp_unset_lock(&writelock);
+                paillier->fast_mod.get()->pow_mod_n2(gn_pow_r[i], g_pow_n, r());
             }
         } else {
             #pragma omp parallel for
             for(auto i = 0u; i < r_lut_size; i++) {
-                const auto rand = g_pow_n.pow_mod_n(r(), paillier->n2);
-
-                omp_set_lock(&writelock);
-                gn_pow_r.push_back(rand);
-                omp_unset_lock(&writelock);
+                pow_mod(gn_pow_r[i], g_pow_n, r(), paillier->n2);
             }
         }
-        omp_destroy_lock(&writelock);
 
         #ifdef DEBUG
         size_t size = 0;
@@ -350,19 +462,27 @@ namespace ophelib {
         #endif
     }
 
-    const Integer PaillierFast::FastRandomizer::get_noise() const {
+    Integer PaillierFast::FastRandomizer::get_noise() const {
         if(!precomputed)
             error_exit("lookup table not precomputed!");
         Integer ret = 1;
         Random &rand = Random::instance();
         for(auto i = 0u; i < r_use_count; i++) {
-            unsigned int ix = rand.rand_int(r_lut_size).to_uint();
-            ret = (ret * gn_pow_r[ix]) % paillier->n2;
+            const auto ix = rand.rand_ulong(r_lut_size);
+            mul_mod(ret, ret, gn_pow_r[ix], paillier->n2);
         }
 
         return ret;
     }
 
+    size_t PaillierFast::FastRandomizer::memory_usage() const {
+        size_t ret = sizeof(FastRandomizer) + heap_usage(g_pow_n)
+                     + heap_block_size(gn_pow_r.capacity() * sizeof(Integer));
+        for(const auto &x: gn_pow_r)
+            ret += heap_usage(x);
+        return ret;
+    }
+
     const std::string PaillierFast::FastRandomizer::to_string(const bool brief) const {
         std::ostringstream o("");
         o << "<FastRandomizer";
@@ -1,33 +1,138 @@
 #include "ophelib/random.h"
 #include "ophelib/error.h"
 
+#include <algorithm>
 #include <fstream>
+#include <cstring>
 
 namespace ophelib {
-    Random::Random() {
+
+    namespace {
+        inline uint32_t rotl32(const uint32_t x, const int n) {
+            return (x << n) | (x >> (32 - n));
+        }
+
+        inline void quarter_round(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d) {
+            a += b; d ^= a; d = rotl32(d, 16);
+            c += d; b ^= c; b = rotl32(b, 12);
+            a += b; d ^= a; d = rotl32(d, 8);
+            c += d; b ^= c; b = rotl32(b, 7);
+        }
+
+        /**
+         * ChaCha20 block function (original variant with 64 bit counter
+         * and 64 bit nonce). Output is serialized little endian, so
+         * the keystream does not depend on the host byte order.
+         */
+        void chacha20_block(const uint32_t key[8], const uint64_t counter, const uint64_t nonce, unsigned char out[64]) {
+            uint32_t in[16] = {
+                    0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+                    key[0], key[1], key[2], key[3],
+                    key[4], key[5], key[6], key[7],
+                    (uint32_t) counter, (uint32_t) (counter >> 32),
+                    (uint32_t) nonce, (uint32_t) (nonce >> 32)
+            };
+            uint32_t x[16];
+            memcpy(x, in, sizeof(x));
+
+            for(int i = 0; i < 10; i++) {
+                quarter_round(x[0], x[4], x[8],  x[12]);
+                quarter_round(x[1], x[5], x[9],  x[13]);
+                quarter_round(x[2], x[6], x[10], x[14]);
+                quarter_round(x[3], x[7], x[11], x[15]);
+                quarter_round(x[0], x[5], x[10], x[15]);
+                quarter_round(x[1], x[6], x[11], x[12]);
+                quarter_round(x[2], x[7], x[8],  x[13]);
+                quarter_round(x[3], x[4], x[9],  x[14]);
+            }
+
+            for(int i = 0; i < 16; i++) {
+                const uint32_t v = x[i] + in[i];
+                out[4 * i + 0] = (unsigned char) (v);
+                out[4 * i + 1] = (unsigned char) (v >> 8);
+                out[4 * i + 2] = (unsigned char) (v >> 16);
+                out[4 * i + 3] = (unsigned char) (v >> 24);
+            }
+        }
+    }
+
+    Random::Random()
+            : nonce(0),
+              counter(0),
+              block_pos(sizeof(block)) {
         std::ifstream urandom("/dev/urandom", std::ios::binary);
-        unsigned long seed = 0;
         if (urandom.is_open()) {
-            urandom.read((char *)&seed, sizeof(seed));
+            urandom.read((char *)key, sizeof(key));
+            if(!urandom)
+                error_exit("could not read from /dev/urandom");
             urandom.close();
         } else {
             error_exit("could not open /dev/urandom");
         }
+    }
 
-        gmp_randinit_default(state);
-        gmp_randseed_ui(state, seed);
+    Random::Random(const Seed &seed, const uint64_t stream)
+            : nonce(stream),
+              counter(0),
+              block_pos(sizeof(block)) {
+        key[0] = (uint32_t) seed.value;
+        key[1] = (uint32_t) (seed.value >> 32);
+        for(size_t i = 2; i < sizeof(key) / sizeof(key[0]); i++)
+            key[i] = 0;
     }
 
     Random::~Random() {
-        gmp_randclear(state);
+        /* don't leave the key lying around in memory */
+        volatile uint32_t *k = key;
+        for(size_t i = 0; i < sizeof(key) / sizeof(key[0]); i++)
+            k[i] = 0;
+    }
+
+    void Random::refill() {
+        chacha20_block(key, counter++, nonce, block);
+        block_pos = 0;
+    }
+
+    void Random::fill(void *buf, const size_t n_bytes) {
+        unsigned char *out = (unsigned char *) buf;
+        size_t remaining = n_bytes;
+
+        while(remaining > 0) {
+            if(block_pos == sizeof(block))
+                refill();
+            const size_t n = std::min(remaining, sizeof(block) - block_pos);
+            memcpy(out, block + block_pos, n);
+            block_pos += n;
+            out += n;
+            remaining -= n;
+        }
+    }
+
+    unsigned long Random::rand_ulong(const unsigned long max) {
+        if(max < 2)
+            error_exit("max must be > 1");
+
+        /* reject the top partial interval so all results are equally likely */
+        const unsigned long limit = ~0UL - (~0UL % max);
+        unsigned long ret;
+        do {
+            fill(&ret, sizeof(ret));
+        } while(ret >= limit);
+
+        return ret % max;
     }
 
     Integer Random::rand_int(const Integer &max) {
         if(max < 2)
             error_exit("max must be > 1");
 
+        /* rejection sampling, expected number of tries is < 2 */
+        const size_t n_bits = mpz_sizeinbase(Integer(max - 1).get_mpz_t(), 2);
         Integer ret;
-        mpz_urandomm(ret.get_mpz_t(), state, max.get_mpz_t());
+        do {
+            ret = rand_int_bits(n_bits);
+        } while(ret >= max);
+
         return ret;
     }
 
@@ -36,7 +141,16 @@ namespace ophelib {
             error_exit("n_bits must be > 0");
 
         Integer ret;
-        mpz_urandomb(ret.get_mpz_t(), state, n_bits);
+        const size_t n_limbs = (n_bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+        mp_limb_t *limbs = mpz_limbs_write(ret.get_mpz_t(), (mp_size_t) n_limbs);
+        fill(limbs, n_limbs * sizeof(mp_limb_t));
+
+        const size_t top_bits = n_bits % GMP_NUMB_BITS;
+        if(top_bits != 0)
+            limbs[n_limbs - 1] &= (((mp_limb_t) 1) << top_bits) - 1;
+
+        /* normalizes away leading zero limbs */
+        mpz_limbs_finish(ret.get_mpz_t(), (mp_size_t) n_limbs);
         return ret;
     }
 
@@ -50,6 +164,9 @@ namespace ophelib {
 
             //shift number to the interval [2^(n_bits - 1), 2^n_bits)
             mpz_setbit(ret.get_mpz_t(), n_bits - 1);
+            //only odd candidates, except for 2
+            if(n_bits > 2)
+                mpz_setbit(ret.get_mpz_t(), 0);
 
             if(ret.is_prime()) {
                 return ret;
@@ -12,7 +12,7 @@
 #endif
 
 namespace ophelib {
-    const Integer nCr(const Integer n_, const Integer r_) {
+    Integer nCr(const Integer n_, const Integer r_) {
         Integer n = n_, r;
         if(r_ > n_ / 2)
             r = n_ - r_; // because C(n, r) == C(n, n - r)
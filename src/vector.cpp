@@ -3,9 +3,12 @@
 #include "ophelib/paillier_base.h"
 #include "ophelib/packing.h"
 #include "ophelib/omp_wrap.h"
+#include "ophelib/memory.h"
 
+#include <cmath>
 #include <fstream>
-#include <ophelib/random.h>
+#include <limits>
+#include <set>
 
 namespace ophelib {
     namespace Vector {
@@ -80,14 +83,31 @@ namespace ophelib {
         template Mat<Ciphertext> transpose(const Mat<Ciphertext>&);
 
         template<typename number>
-        Vec<number> sum(const Mat<number> &m_, const int axis) {
+        Vec<number> sum(const Mat<number> &m, const int axis) {
             if(axis > 1)
                 error_exit("invalid axis");
-            const Mat<number> &m = (axis == 0) ? transpose(m_) : m_;
             const long n = m.NumRows();
+            Vec<number> ret;
+
+            if(axis == 0) {
+                // column sums, without a transposed copy
+                const long cols = m.NumCols();
+                if(n == 0 || cols == 0)
+                    error_exit("empty matrix!");
+                ret.SetLength(cols);
+
+                #pragma omp parallel for
+                for(long j = 0; j < cols; j++) {
+                    ret[j] = m[0][j];
+                    for(long i = 1; i < n; i++) {
+                        ret[j] += m[i][j];
+                    }
+                }
+                return ret;
+            }
+
             if(n == 0)
                 error_exit("empty matrix!");
-            Vec<number> ret;
             ret.SetLength(n);
 
             omp_set_nested(0);
@@ -232,14 +252,26 @@ namespace ophelib {
         template Mat<Integer> operator*(const Mat<Integer>& a, const Integer& b);
         template Mat<Ciphertext> operator*(const Mat<Ciphertext>& a, const Integer& b);
 
+        namespace {
+            /* Integer divisors are preprocessed once per vector */
+            inline float prepare_divisor(const float b) {
+                return b;
+            }
+
+            inline Divider prepare_divisor(const Integer &b) {
+                return Divider(b);
+            }
+        }
+
         template<typename number>
         Vec<number> operator/(const Vec<number>& a, const number& b) {
             Vec<number> ret;
             const long n = a.length();
             ret.SetLength(n);
+            const auto d = prepare_divisor(b);
             #pragma omp parallel for
             for(long i = 0; i < n; i++) {
-                ret[i] = a[i] / b;
+                ret[i] = a[i] / d;
             }
             return ret;
         }
@@ -249,13 +281,15 @@ namespace ophelib {
 
         template<typename number>
         Mat<number> operator/(const Mat<number>& a, const number& b) {
-            const long n = a.NumRows();
+            const long n = a.NumRows(), m = a.NumCols();
             Mat<number> ret;
-            ret.SetDims(a.NumRows(), a.NumCols());
-            omp_set_nested(0);
+            ret.SetDims(n, m);
+            const auto d = prepare_divisor(b);
             #pragma omp parallel for
             for(long i = 0; i < n; i++) {
-                ret[i] = a[i] / b;
+                for(long j = 0; j < m; j++) {
+                    ret[i][j] = a[i][j] / d;
+                }
             }
             return ret;
         }
@@ -263,6 +297,50 @@ namespace ophelib {
         template Mat<float> operator/(const Mat<float>& a, const float& b);
         template Mat<Integer> operator/(const Mat<Integer>& a, const Integer& b);
 
+        Vec<Integer> operator/(const Vec<Integer>& a, const Divider& b) {
+            Vec<Integer> ret;
+            const long n = a.length();
+            ret.SetLength(n);
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                b.divide(ret[i], a[i]);
+            }
+            return ret;
+        }
+
+        Mat<Integer> operator/(const Mat<Integer>& a, const Divider& b) {
+            const long n = a.NumRows(), m = a.NumCols();
+            Mat<Integer> ret;
+            ret.SetDims(n, m);
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    b.divide(ret[i][j], a[i][j]);
+                }
+            }
+            return ret;
+        }
+
+        Vec<Integer> operator/(Vec<Integer>&& a, const Divider& b) {
+            const long n = a.length();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                b.divide(a[i], a[i]);
+            }
+            return std::move(a);
+        }
+
+        Mat<Integer> operator/(Mat<Integer>&& a, const Divider& b) {
+            const long n = a.NumRows(), m = a.NumCols();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    b.divide(a[i][j], a[i][j]);
+                }
+            }
+            return std::move(a);
+        }
+
         template<typename number>
         Vec<number> operator+(const Vec<number>& a, const number& b) {
             Vec<number> ret;
@@ -428,6 +506,126 @@ namespace ophelib {
         template Mat<Integer> operator-(const Mat<Integer>& a, const Mat<Integer>& b);
         template Mat<Ciphertext> operator-(const Mat<Ciphertext>& a, const Mat<Ciphertext>& b);
 
+        template<typename number, typename scalar>
+        Vec<number> operator*(Vec<number>&& a, const scalar& b) {
+            const long n = a.length();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                a[i] *= b;
+            }
+            return std::move(a);
+        }
+
+        template Vec<float> operator*(Vec<float>&& a, const float& b);
+        template Vec<Integer> operator*(Vec<Integer>&& a, const Integer& b);
+        template Vec<Ciphertext> operator*(Vec<Ciphertext>&& a, const Integer& b);
+
+        template<typename number, typename scalar>
+        Mat<number> operator*(Mat<number>&& a, const scalar& b) {
+            const long n = a.NumRows(), m = a.NumCols();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    a[i][j] *= b;
+                }
+            }
+            return std::move(a);
+        }
+
+        template Mat<float> operator*(Mat<float>&& a, const float& b);
+        template Mat<Integer> operator*(Mat<Integer>&& a, const Integer& b);
+        template Mat<Ciphertext> operator*(Mat<Ciphertext>&& a, const Integer& b);
+
+        template<typename number>
+        Vec<number> operator-(Vec<number>&& a) {
+            const long n = a.length();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                a[i] = -std::move(a[i]);
+            }
+            return std::move(a);
+        }
+
+        template Vec<float> operator-(Vec<float>&& a);
+        template Vec<Integer> operator-(Vec<Integer>&& a);
+        template Vec<Ciphertext> operator-(Vec<Ciphertext>&& a);
+
+        template<typename number>
+        Mat<number> operator-(Mat<number>&& a) {
+            const long n = a.NumRows(), m = a.NumCols();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    a[i][j] = -std::move(a[i][j]);
+                }
+            }
+            return std::move(a);
+        }
+
+        template Mat<float> operator-(Mat<float>&& a);
+        template Mat<Integer> operator-(Mat<Integer>&& a);
+        template Mat<Ciphertext> operator-(Mat<Ciphertext>&& a);
+
+        template<typename number>
+        Vec<number> operator+(Vec<number>&& a, const Vec<number>& b) {
+            const long n = a.length();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                a[i] += b[i];
+            }
+            return std::move(a);
+        }
+
+        template Vec<float> operator+(Vec<float>&& a, const Vec<float>& b);
+        template Vec<Integer> operator+(Vec<Integer>&& a, const Vec<Integer>& b);
+        template Vec<Ciphertext> operator+(Vec<Ciphertext>&& a, const Vec<Ciphertext>& b);
+
+        template<typename number>
+        Mat<number> operator+(Mat<number>&& a, const Mat<number>& b) {
+            const long n = a.NumRows(), m = a.NumCols();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    a[i][j] += b[i][j];
+                }
+            }
+            return std::move(a);
+        }
+
+        template Mat<float> operator+(Mat<float>&& a, const Mat<float>& b);
+        template Mat<Integer> operator+(Mat<Integer>&& a, const Mat<Integer>& b);
+        template Mat<Ciphertext> operator+(Mat<Ciphertext>&& a, const Mat<Ciphertext>& b);
+
+        template<typename number>
+        Vec<number> operator-(Vec<number>&& a, const Vec<number>& b) {
+            const long n = a.length();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                a[i] -= b[i];
+            }
+            return std::move(a);
+        }
+
+        template Vec<float> operator-(Vec<float>&& a, const Vec<float>& b);
+        template Vec<Integer> operator-(Vec<Integer>&& a, const Vec<Integer>& b);
+        template Vec<Ciphertext> operator-(Vec<Ciphertext>&& a, const Vec<Ciphertext>& b);
+
+        template<typename number>
+        Mat<number> operator-(Mat<number>&& a, const Mat<number>& b) {
+            const long n = a.NumRows(), m = a.NumCols();
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    a[i][j] -= b[i][j];
+                }
+            }
+            return std::move(a);
+        }
+
+        template Mat<float> operator-(Mat<float>&& a, const Mat<float>& b);
+        template Mat<Integer> operator-(Mat<Integer>&& a, const Mat<Integer>& b);
+        template Mat<Ciphertext> operator-(Mat<Ciphertext>&& a, const Mat<Ciphertext>& b);
+
         template<typename number>
         bool operator==(const Mat<number>& a, const Mat<number>& b) {
             const long n = a.NumRows(), m = a.NumCols();
@@ -586,8 +784,24 @@ namespace ophelib {
             scale.SetLength(0);
         }
 
+        namespace {
+            double exact_double_factor(const Integer &factor) {
+                if(factor <= 0 || factor.size_bits() > (size_t) std::numeric_limits<long>::digits)
+                    return 0;
+
+                /* a float has 24 significant bits, the product is exact
+                 * if the odd part of the factor has at most 53 - 24 bits */
+                const size_t odd_bits = factor.size_bits() - mpz_scan1(factor.get_mpz_t(), 0);
+                if(odd_bits > (size_t) (std::numeric_limits<double>::digits - std::numeric_limits<float>::digits))
+                    return 0;
+
+                return mpz_get_d(factor.get_mpz_t());
+            }
+        }
+
         Integerizer::Integerizer(const size_t n_bits_, const Integer &multiplier_)
-                : factor((multiplier_ < 0) ? Integer(Integer(1) << (n_bits_ - 1)) : multiplier_) { }
+                : factor((multiplier_ < 0) ? Integer(Integer(1) << (n_bits_ - 1)) : multiplier_),
+                  fast_factor(exact_double_factor(factor)) { }
 
         Integerizer Integerizer::double_precision() const {
             return Integerizer(0, factor * factor);
@@ -604,12 +818,18 @@ namespace ophelib {
             ret.SetDims(n, m);
             const RR factor_ = NTL::conv<RR>(factor);
 
+            #pragma omp parallel for
             for (long i = 0; i < n; i++) {
                 for (long j = 0; j < m; j++) {
                     float x = M[i][j];
                     if(x > 1) x = 1;
                     if(x < -1) x = -1;
-                    ophelib::conv(ret[i][j], NTL::conv<RR>(x) * factor_);
+                    if(fast_factor != 0 && x == x) {
+                        /* exact, so the same as the RR product rounded down */
+                        mpz_set_si(ret[i][j].get_mpz_t(), (long) std::floor(x * fast_factor));
+                    } else {
+                        ophelib::conv(ret[i][j], NTL::conv<RR>(x) * factor_);
+                    }
                 }
             }
 
@@ -622,10 +842,19 @@ namespace ophelib {
             const long m = M.NumCols();
             ret.SetDims(n, m);
             const RR factor_ = NTL::conv<RR>(factor);
+            /* integers below 2^53 are exact in double precision */
+            const size_t max_exact_bits = std::numeric_limits<double>::digits;
 
+            #pragma omp parallel for
             for (long i = 0; i < n; i++) {
                 for (long j = 0; j < m; j++) {
-                    ret[i][j] = NTL::conv<float>(NTL::conv<RR>(M[i][j]) / factor_);
+                    const mpz_srcptr x = M[i][j].get_mpz_t();
+                    if(fast_factor != 0 && mpz_sizeinbase(x, 2) <= max_exact_bits) {
+                        /* rounded to double, then to float, like NTL */
+                        ret[i][j] = (float) (mpz_get_d(x) / fast_factor);
+                    } else {
+                        ret[i][j] = NTL::conv<float>(NTL::conv<RR>(M[i][j]) / factor_);
+                    }
                 }
             }
 
@@ -644,6 +873,17 @@ namespace ophelib {
             return factor;
         }
 
+        namespace {
+            /* ret += a * b, without temporaries for Integer */
+            inline void add_product(float &ret, const float a, const float b) {
+                ret += a * b;
+            }
+
+            inline void add_product(Integer &ret, const Integer &a, const Integer &b) {
+                add_mul(ret, a, b);
+            }
+        }
+
         template<typename number>
         Mat<number> dot(const Mat<number> &A, const Mat<number> &B) {
             const long n = A.NumRows(),
@@ -661,9 +901,9 @@ namespace ophelib {
             #pragma omp parallel for
             for (long i = 0; i < n; i++) {
                 for (long j = 0; j < m; j++) {
-                    ret[i][j] = A[i][0] * B[0][j];
-                    for(long k = 1; k < d; k++) {
-                        ret[i][j] += A[i][k] * B[k][j];
+                    ret[i][j] = 0;
+                    for(long k = 0; k < d; k++) {
+                        add_product(ret[i][j], A[i][k], B[k][j]);
                     }
                 }
             }
@@ -676,7 +916,26 @@ namespace ophelib {
 
         template<typename number>
         Vec<number> dot(const Mat<number> &A, const Vec<number> &B) {
-            return vector(dot(A, col_matrix(B)));
+            const long n = A.NumRows(),
+                       d = A.NumCols();
+
+            if(d != B.length())
+                dimension_mismatch();
+            if(n == 0 || d == 0)
+                error_exit("empty matrix");
+
+            Vec<number> ret;
+            ret.SetLength(n);
+
+            #pragma omp parallel for
+            for(long i = 0; i < n; i++) {
+                ret[i] = 0;
+                for(long k = 0; k < d; k++) {
+                    add_product(ret[i], A[i][k], B[k]);
+                }
+            }
+
+            return ret;
         }
 
         template Vec<float> dot(const Mat<float> &A, const Vec<float> &B);
@@ -684,7 +943,26 @@ namespace ophelib {
 
         template<typename number>
         Vec<number> dot(const Vec<number> &A, const Mat<number> &B) {
-            return vector(dot(row_matrix(A), B));
+            const long m = B.NumCols(),
+                       d = B.NumRows();
+
+            if(d != A.length())
+                dimension_mismatch();
+            if(m == 0 || d == 0)
+                error_exit("empty matrix");
+
+            Vec<number> ret;
+            ret.SetLength(m);
+
+            #pragma omp parallel for
+            for(long j = 0; j < m; j++) {
+                ret[j] = 0;
+                for(long k = 0; k < d; k++) {
+                    add_product(ret[j], A[k], B[k][j]);
+                }
+            }
+
+            return ret;
         }
 
         template Vec<float> dot(const Vec<float> &A, const Mat<float> &B);
@@ -698,9 +976,9 @@ namespace ophelib {
             if (n == 0)
                 error_exit("empty vector");
 
-            number ret = A[0] * B[0];
-            for(long i = 1; i < n; i++) {
-                ret += A[i] * B[i];
+            number ret = 0;
+            for(long i = 0; i < n; i++) {
+                add_product(ret, A[i], B[i]);
             }
 
             return ret;
@@ -826,9 +1104,11 @@ namespace ophelib {
 
         Mat<Integer> rand(const size_t n, const size_t m, const Integer &max) {
             Mat<Integer> ret;
-            Random &rand = Random::instance();
             ret.SetDims(n, m);
-            for(size_t i = 0; i < n; i++) {
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long i = 0; i < n_; i++) {
+                Random &rand = Random::instance();
                 for(size_t j = 0; j < m; j++) {
                     ret[i][j] = rand.rand_int(max);
                 }
@@ -838,19 +1118,22 @@ namespace ophelib {
 
         Vec<Integer> rand(const size_t n, const Integer &max) {
             Vec<Integer> ret;
-            Random &rand = Random::instance();
             ret.SetLength(n);
-            for(size_t i = 0; i < n; i++) {
-                ret[i] = rand.rand_int(max);
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long i = 0; i < n_; i++) {
+                ret[i] = Random::instance().rand_int(max);
             }
             return ret;
         }
 
         Mat<Integer> rand_bits(const size_t n, const size_t m, const size_t n_bits) {
             Mat<Integer> ret;
-            Random &rand = Random::instance();
             ret.SetDims(n, m);
-            for(size_t i = 0; i < n; i++) {
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long i = 0; i < n_; i++) {
+                Random &rand = Random::instance();
                 for(size_t j = 0; j < m; j++) {
                     ret[i][j] = rand.rand_int_bits(n_bits);
                 }
@@ -860,10 +1143,11 @@ namespace ophelib {
 
         Vec<Integer> rand_bits(const size_t n, const size_t n_bits) {
             Vec<Integer> ret;
-            Random &rand = Random::instance();
             ret.SetLength(n);
-            for(size_t i = 0; i < n; i++) {
-                ret[i] = rand.rand_int_bits(n_bits);
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long i = 0; i < n_; i++) {
+                ret[i] = Random::instance().rand_int_bits(n_bits);
             }
             return ret;
         }
@@ -886,9 +1170,11 @@ namespace ophelib {
 
         Mat<Integer> rand_primes(const size_t n, const size_t m, const size_t n_bits) {
             Mat<Integer> ret;
-            Random &rand = Random::instance();
             ret.SetDims(n, m);
-            for(size_t i = 0; i < n; i++) {
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long i = 0; i < n_; i++) {
+                Random &rand = Random::instance();
                 for(size_t j = 0; j < m; j++) {
                     ret[i][j] = rand.rand_prime(n_bits);
                 }
@@ -898,10 +1184,91 @@ namespace ophelib {
 
         Vec<Integer> rand_primes(const size_t n, const size_t n_bits) {
             Vec<Integer> ret;
-            Random &rand = Random::instance();
             ret.SetLength(n);
-            for(size_t i = 0; i < n; i++) {
-                ret[i] = rand.rand_prime(n_bits);
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long i = 0; i < n_; i++) {
+                ret[i] = Random::instance().rand_prime(n_bits);
+            }
+            return ret;
+        }
+
+        Mat<Integer> rand(const size_t n, const size_t m, const Integer &max, const Seed &seed) {
+            Mat<Integer> ret;
+            ret.SetDims(n, m);
+            const long n_ = n * m;
+            #pragma omp parallel for
+            for(long k = 0; k < n_; k++) {
+                Random rand(seed, k);
+                ret[k / m][k % m] = rand.rand_int(max);
+            }
+            return ret;
+        }
+
+        Vec<Integer> rand(const size_t n, const Integer &max, const Seed &seed) {
+            Vec<Integer> ret;
+            ret.SetLength(n);
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long k = 0; k < n_; k++) {
+                Random rand(seed, k);
+                ret[k] = rand.rand_int(max);
+            }
+            return ret;
+        }
+
+        Mat<Integer> rand_bits(const size_t n, const size_t m, const size_t n_bits, const Seed &seed) {
+            Mat<Integer> ret;
+            ret.SetDims(n, m);
+            const long n_ = n * m;
+            #pragma omp parallel for
+            for(long k = 0; k < n_; k++) {
+                Random rand(seed, k);
+                ret[k / m][k % m] = rand.rand_int_bits(n_bits);
+            }
+            return ret;
+        }
+
+        Vec<Integer> rand_bits(const size_t n, const size_t n_bits, const Seed &seed) {
+            Vec<Integer> ret;
+            ret.SetLength(n);
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long k = 0; k < n_; k++) {
+                Random rand(seed, k);
+                ret[k] = rand.rand_int_bits(n_bits);
+            }
+            return ret;
+        }
+
+        Mat<Integer> rand_bits_neg(const size_t n, const size_t m, const size_t n_bits, const Seed &seed) {
+            return rand_bits(n, m, n_bits + 1, seed) - (Integer(1) << n_bits);
+        }
+
+        Vec<Integer> rand_bits_neg(const size_t n, const size_t n_bits, const Seed &seed) {
+            return rand_bits(n, n_bits + 1, seed) - (Integer(1) << n_bits);
+        }
+
+        Mat<Integer> rand_primes(const size_t n, const size_t m, const size_t n_bits, const Seed &seed) {
+            Mat<Integer> ret;
+            ret.SetDims(n, m);
+            const long n_ = n * m;
+            #pragma omp parallel for
+            for(long k = 0; k < n_; k++) {
+                Random rand(seed, k);
+                ret[k / m][k % m] = rand.rand_prime(n_bits);
+            }
+            return ret;
+        }
+
+        Vec<Integer> rand_primes(const size_t n, const size_t n_bits, const Seed &seed) {
+            Vec<Integer> ret;
+            ret.SetLength(n);
+            const long n_ = n;
+            #pragma omp parallel for
+            for(long k = 0; k < n_; k++) {
+                Random rand(seed, k);
+                ret[k] = rand.rand_prime(n_bits);
             }
             return ret;
         }
@@ -1104,5 +1471,76 @@ namespace ophelib {
                 error_exit("invalid string length!");
             return load_data_str(data_str, X, y);
         }
+
+        namespace {
+            /**
+             * NTL puts a header of four longs in front
+             * of the buffer of every vector
+             */
+            const size_t ntl_vec_header = 4 * sizeof(long);
+
+            const KeyContext *key_of(const Integer &) {
+                return nullptr;
+            }
+
+            const KeyContext *key_of(const Ciphertext &c) {
+                return c.key;
+            }
+
+            const KeyContext *key_of(const PackedCiphertext &c) {
+                return c.data.key;
+            }
+
+            /**
+             * Heap memory of v, collects the key contexts of the elements
+             */
+            template<typename number>
+            size_t vec_heap_usage(const Vec<number> &v, std::set<const KeyContext*> &keys) {
+                size_t ret = 0;
+                if(v.allocated() > 0)
+                    ret += heap_block_size(ntl_vec_header + v.allocated() * sizeof(number));
+                for(long i = 0; i < v.length(); i++) {
+                    ret += heap_usage(v[i]);
+                    const KeyContext *key = key_of(v[i]);
+                    if(key)
+                        keys.insert(key);
+                }
+                return ret;
+            }
+
+            size_t keys_usage(const std::set<const KeyContext*> &keys) {
+                size_t ret = 0;
+                for(const auto key: keys)
+                    ret += key->memory_usage();
+                return ret;
+            }
+        }
+
+        template<typename number>
+        size_t memory_usage(const Vec<number> &v) {
+            std::set<const KeyContext*> keys;
+            const size_t ret = sizeof(Vec<number>) + vec_heap_usage(v, keys);
+            return ret + keys_usage(keys);
+        }
+
+        template size_t memory_usage(const Vec<Integer> &v);
+        template size_t memory_usage(const Vec<Ciphertext> &v);
+        template size_t memory_usage(const Vec<PackedCiphertext> &v);
+
+        template<typename number>
+        size_t memory_usage(const Mat<number> &m) {
+            std::set<const KeyContext*> keys;
+            const long n = m.NumRows();
+            size_t ret = sizeof(Mat<number>);
+            if(n > 0)
+                ret += heap_block_size(ntl_vec_header + n * sizeof(Vec<number>));
+            for(long i = 0; i < n; i++)
+                ret += vec_heap_usage(m[i], keys);
+            return ret + keys_usage(keys);
+        }
+
+        template size_t memory_usage(const Mat<Integer> &m);
+        template size_t memory_usage(const Mat<Ciphertext> &m);
+        template size_t memory_usage(const Mat<PackedCiphertext> &m);
     }
-}
\ No newline at end of file
+}
@@ -4,8 +4,73 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <limits>
 
 namespace ophelib {
+    namespace {
+        /**
+         * Write all elements of a flat container as fixed size,
+         * little endian byte strings, independent of the limb size.
+         */
+        flatbuffers::Offset<flatbuffers::Vector<uint8_t>> serialize_elements(flatbuffers::FlatBufferBuilder &builder, const CiphertextArray &a, size_t &element_bytes) {
+            element_bytes = a.limbs_per_element() * sizeof(mp_limb_t);
+
+            std::vector<uint8_t> data;
+            data.resize(a.size() * element_bytes, 0);
+            mpz_t tmp;
+            for(size_t i = 0; i < a.size(); i++) {
+                size_t count;
+                mpz_export(data.data() + i * element_bytes, &count, -1, 1, 0, 0, a.view(i, tmp));
+            }
+            return builder.CreateVector(data.data(), data.size());
+        }
+
+        size_t limbs_for_bytes(const size_t n_bytes) {
+            return (n_bytes + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t);
+        }
+
+        /**
+         * Check the header of a flat container against its payload,
+         * before anything is allocated. The buffer might come from an
+         * untrusted party, so a small payload must not be able to
+         * request a huge allocation.
+         * @return limbs per element
+         */
+        size_t checked_element_limbs(const flatbuffers::Vector<uint8_t> *data, const uint64_t n_elements, const uint64_t element_bytes) {
+            const uint64_t data_bytes = data ? data->size() : 0;
+            if(n_elements == 0) {
+                if(data_bytes != 0)
+                    error_exit("invalid import dimensions!");
+                return 0;
+            }
+            if(element_bytes == 0 || data_bytes % element_bytes != 0 || data_bytes / element_bytes != n_elements)
+                error_exit("invalid import dimensions!");
+            return limbs_for_bytes(element_bytes);
+        }
+
+        /**
+         * a * b, or an error if it does not fit
+         */
+        uint64_t checked_mul(const uint64_t a, const uint64_t b) {
+            if(a != 0 && b > std::numeric_limits<uint64_t>::max() / a)
+                error_exit("invalid import dimensions!");
+            return a * b;
+        }
+
+        void deserialize_elements(const flatbuffers::Vector<uint8_t> *data, const size_t element_bytes, CiphertextArray &out) {
+            if(out.size() == 0)
+                return;
+            if(data->size() != out.size() * element_bytes)
+                error_exit("invalid import dimensions!");
+
+            Integer x;
+            for(size_t i = 0; i < out.size(); i++) {
+                mpz_import(x.get_mpz_t(), element_bytes, -1, 1, 0, 0, data->data() + i * element_bytes);
+                out.set_data(i, x);
+            }
+        }
+    }
+
     size_t get_filesize(const std::string &fname) {
         struct stat st;
         if(stat(fname.c_str(), &st) != 0)
@@ -39,6 +104,7 @@ namespace ophelib {
     template void serialize_to_file(const Integer &t, const std::string &fname);
     template void serialize_to_file(const Ciphertext &t, const std::string &fname);
     template void serialize_to_file(const PackedCiphertext &t, const std::string &fname);
+    template void serialize_to_file(const PackLayout &t, const std::string &fname);
     template void serialize_to_file(const Vec<float> &t, const std::string &fname);
     template void serialize_to_file(const Vec<Integer> &t, const std::string &fname);
     template void serialize_to_file(const Vec<Ciphertext> &t, const std::string &fname);
@@ -46,6 +112,9 @@ namespace ophelib {
     template void serialize_to_file(const Mat<float> &t, const std::string &fname);
     template void serialize_to_file(const Mat<Integer> &t, const std::string &fname);
     template void serialize_to_file(const Mat<Ciphertext> &t, const std::string &fname);
+    template void serialize_to_file(const CiphertextVector &t, const std::string &fname);
+    template void serialize_to_file(const CiphertextMatrix &t, const std::string &fname);
+    template void serialize_to_file(const SymmetricCiphertextMatrix &t, const std::string &fname);
     template void serialize_to_file(const PublicKey &t, const std::string &fname);
     template void serialize_to_file(const PrivateKey &t, const std::string &fname);
     template void serialize_to_file(const KeyPair &t, const std::string &fname);
@@ -83,6 +152,7 @@ namespace ophelib {
     template void deserialize_from_file(const std::string &fname, Integer &out);
     template void deserialize_from_file(const std::string &fname, Ciphertext &out);
     template void deserialize_from_file(const std::string &fname, PackedCiphertext &out);
+    template void deserialize_from_file(const std::string &fname, PackLayout &out);
     template void deserialize_from_file(const std::string &fname, Vec<float> &out);
     template void deserialize_from_file(const std::string &fname, Vec<Integer> &out);
     template void deserialize_from_file(const std::string &fname, Vec<Ciphertext> &out);
@@ -90,6 +160,9 @@ namespace ophelib {
     template void deserialize_from_file(const std::string &fname, Mat<float> &out);
     template void deserialize_from_file(const std::string &fname, Mat<Integer> &out);
     template void deserialize_from_file(const std::string &fname, Mat<Ciphertext> &out);
+    template void deserialize_from_file(const std::string &fname, CiphertextVector &out);
+    template void deserialize_from_file(const std::string &fname, CiphertextMatrix &out);
+    template void deserialize_from_file(const std::string &fname, SymmetricCiphertextMatrix &out);
     template void deserialize_from_file(const std::string &fname, PublicKey &out);
     template void deserialize_from_file(const std::string &fname, PrivateKey &out);
     template void deserialize_from_file(const std::string &fname, KeyPair &out);
@@ -105,6 +178,7 @@ namespace ophelib {
     template const Integer deserialize_from_file(const std::string &fname);
     template const Ciphertext deserialize_from_file(const std::string &fname);
     template const PackedCiphertext deserialize_from_file(const std::string &fname);
+    template const PackLayout deserialize_from_file(const std::string &fname);
     template const Vec<float> deserialize_from_file(const std::string &fname);
     template const Vec<Integer> deserialize_from_file(const std::string &fname);
     template const Vec<Ciphertext> deserialize_from_file(const std::string &fname);
@@ -112,6 +186,9 @@ namespace ophelib {
     template const Mat<float> deserialize_from_file(const std::string &fname);
     template const Mat<Integer> deserialize_from_file(const std::string &fname);
     template const Mat<Ciphertext> deserialize_from_file(const std::string &fname);
+    template const CiphertextVector deserialize_from_file(const std::string &fname);
+    template const CiphertextMatrix deserialize_from_file(const std::string &fname);
+    template const SymmetricCiphertextMatrix deserialize_from_file(const std::string &fname);
     template const PublicKey deserialize_from_file(const std::string &fname);
     template const PrivateKey deserialize_from_file(const std::string &fname);
     template const KeyPair deserialize_from_file(const std::string &fname);
@@ -183,28 +260,28 @@ namespace ophelib {
         deserialize(c->data(), out.data);
     }
 
-    void deserialize(const Wire::Ciphertext *c, Ciphertext &out, std::shared_ptr<Integer> n2_shared) {
-        if(!n2_shared)
+    void deserialize(const Wire::Ciphertext *c, Ciphertext &out, const KeyContext *key) {
+        if(!key)
             error_exit("got a null pointer");
         deserialize(c->data(), out.data);
-        out.n2_shared = n2_shared;
+        out.key = key;
+    }
+
+    void deserialize(const Wire::Ciphertext *c, Ciphertext &out, std::shared_ptr<Integer> n2_shared) {
+        deserialize(c, out, KeyContext::intern(n2_shared));
     }
 
     void deserialize(const Wire::Ciphertext *c, Ciphertext &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod) {
-        if(!n2_shared)
-            error_exit("got a null pointer");
-        if(!fast_mod)
-            error_exit("got a null pointer");
-        deserialize(c->data(), out.data);
-        out.n2_shared = n2_shared;
-        out.fast_mod = fast_mod;
+        deserialize(c, out, KeyContext::intern(n2_shared, fast_mod));
     }
 
     flatbuffers::Offset<Wire::PackedCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const PackedCiphertext &p) {
         return Wire::CreatePackedCiphertext(builder,
                                             p.n_plaintexts,
                                             p.plaintext_bits,
-                                            serialize(builder, p.data));
+                                            serialize(builder, p.data),
+                                            p.slot_bits,
+                                            p.slot_stride);
     }
 
     void deserialize(const void* buf, PackedCiphertext &out) {
@@ -215,6 +292,37 @@ namespace ophelib {
         deserialize(p->data(), out.data);
         out.n_plaintexts = p->n_plaintexts();
         out.plaintext_bits = p->plaintext_bits();
+        out.slot_bits = p->slot_bits() > 0 ? p->slot_bits() : out.plaintext_bits + Vector::pack_buffer;
+        out.slot_stride = p->slot_stride() > 0 ? p->slot_stride() : 1;
+    }
+
+    flatbuffers::Offset<Wire::PackLayout> serialize(flatbuffers::FlatBufferBuilder &builder, const PackLayout &l) {
+        std::vector<uint64_t> bits(l.field_bits.begin(), l.field_bits.end());
+        std::vector<uint64_t> pack(l.field_pack.begin(), l.field_pack.end());
+        std::vector<uint64_t> offset(l.field_offset.begin(), l.field_offset.end());
+        return Wire::CreatePackLayout(builder,
+                                      l.n_packs,
+                                      builder.CreateVector(bits),
+                                      builder.CreateVector(pack),
+                                      builder.CreateVector(offset));
+    }
+
+    void deserialize(const void* buf, PackLayout &out) {
+        deserialize(Wire::GetPackLayout(buf), out);
+    }
+
+    void deserialize(const Wire::PackLayout *l, PackLayout &out) {
+        if(!l->field_bits() || !l->field_pack() || !l->field_offset())
+            error_exit("invalid import dimensions!");
+        const auto n = l->field_bits()->size();
+        if(l->field_pack()->size() != n || l->field_offset()->size() != n)
+            error_exit("invalid import dimensions!");
+
+        /* the restoring constructor validates the placement */
+        out = PackLayout(std::vector<size_t>(l->field_bits()->begin(), l->field_bits()->end()),
+                         std::vector<size_t>(l->field_pack()->begin(), l->field_pack()->end()),
+                         std::vector<size_t>(l->field_offset()->begin(), l->field_offset()->end()),
+                         l->n_packs());
     }
 
     flatbuffers::Offset<Wire::VecFloat> serialize(flatbuffers::FlatBufferBuilder &builder, const Vec<float> &v) {
@@ -290,35 +398,34 @@ namespace ophelib {
         }
     }
 
-    void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared) {
-        if(!n2_shared)
+    void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, const KeyContext *key) {
+        if(!key)
             error_exit("got a null pointer");
         deserialize(v, out);
         const auto n = v->length();
         for(unsigned long i = 0; i < n; i++) {
-            out[i].n2_shared = n2_shared;
+            out[i].key = key;
         }
     }
 
+    void deserialize(const void* buf, Vec<Ciphertext> &out, const KeyContext *key) {
+        return deserialize(Wire::GetVecCiphertext(buf), out, key);
+    }
+
+    void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared) {
+        deserialize(v, out, KeyContext::intern(n2_shared));
+    }
+
     void deserialize(const Wire::VecCiphertext *v, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod) {
-        if(!n2_shared)
-            error_exit("got a null pointer");
-        if(!fast_mod)
-            error_exit("got a null pointer");
-        deserialize(v, out);
-        const auto n = v->length();
-        for(unsigned long i = 0; i < n; i++) {
-            out[i].n2_shared = n2_shared;
-            out[i].fast_mod = fast_mod;
-        }
+        deserialize(v, out, KeyContext::intern(n2_shared, fast_mod));
     }
 
     void deserialize(const void* buf, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared) {
-        return deserialize(Wire::GetVecCiphertext(buf), out, n2_shared);
+        deserialize(Wire::GetVecCiphertext(buf), out, KeyContext::intern(n2_shared));
     }
 
     void deserialize(const void* buf, Vec<Ciphertext> &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod) {
-        return deserialize(Wire::GetVecCiphertext(buf), out, n2_shared, fast_mod);
+        deserialize(Wire::GetVecCiphertext(buf), out, KeyContext::intern(n2_shared, fast_mod));
     }
 
     flatbuffers::Offset<Wire::VecPackedCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const Vec<PackedCiphertext> &v) {
@@ -447,6 +554,116 @@ namespace ophelib {
         }
     }
 
+    void deserialize(const Wire::MatCiphertext *mat, Mat<Ciphertext> &out, const KeyContext *key) {
+        if(!key)
+            error_exit("got a null pointer");
+        deserialize(mat, out);
+        for(long i = 0; i < out.NumRows(); i++) {
+            for(long j = 0; j < out.NumCols(); j++) {
+                out[i][j].key = key;
+            }
+        }
+    }
+
+    void deserialize(const void* buf, Mat<Ciphertext> &out, const KeyContext *key) {
+        deserialize(Wire::GetMatCiphertext(buf), out, key);
+    }
+
+    void deserialize(const Wire::MatCiphertext *mat, Mat<Ciphertext> &out, std::shared_ptr<Integer> n2_shared) {
+        deserialize(mat, out, KeyContext::intern(n2_shared));
+    }
+
+    void deserialize(const Wire::MatCiphertext *mat, Mat<Ciphertext> &out, std::shared_ptr<Integer> n2_shared, std::shared_ptr<FastMod> fast_mod) {
+        deserialize(mat, out, KeyContext::intern(n2_shared, fast_mod));
+    }
+
+    flatbuffers::Offset<Wire::FlatVecCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const CiphertextVector &v) {
+        size_t element_bytes;
+        const auto data = serialize_elements(builder, v, element_bytes);
+        return Wire::CreateFlatVecCiphertext(builder, v.length(), element_bytes, data);
+    }
+
+    void deserialize(const void* buf, CiphertextVector &out) {
+        deserialize(Wire::GetFlatVecCiphertext(buf), out);
+    }
+
+    void deserialize(const Wire::FlatVecCiphertext *v, CiphertextVector &out) {
+        const auto element_bytes = v->element_bytes();
+        const auto width = checked_element_limbs(v->data(), v->length(), element_bytes);
+        out = CiphertextVector(v->length(), width, nullptr);
+        deserialize_elements(v->data(), element_bytes, out);
+    }
+
+    void deserialize(const Wire::FlatVecCiphertext *v, CiphertextVector &out, const KeyContext *key) {
+        if(!key)
+            error_exit("got a null pointer");
+        deserialize(v, out);
+        out.key = key;
+    }
+
+    void deserialize(const void* buf, CiphertextVector &out, const KeyContext *key) {
+        deserialize(Wire::GetFlatVecCiphertext(buf), out, key);
+    }
+
+    flatbuffers::Offset<Wire::FlatMatCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const CiphertextMatrix &mat) {
+        size_t element_bytes;
+        const auto data = serialize_elements(builder, mat, element_bytes);
+        return Wire::CreateFlatMatCiphertext(builder, mat.NumRows(), mat.NumCols(), element_bytes, data);
+    }
+
+    void deserialize(const void* buf, CiphertextMatrix &out) {
+        deserialize(Wire::GetFlatMatCiphertext(buf), out);
+    }
+
+    void deserialize(const Wire::FlatMatCiphertext *mat, CiphertextMatrix &out) {
+        const auto element_bytes = mat->element_bytes();
+        const auto width = checked_element_limbs(mat->data(), checked_mul(mat->n_rows(), mat->n_cols()), element_bytes);
+        out = CiphertextMatrix(mat->n_rows(), mat->n_cols(), width, nullptr);
+        deserialize_elements(mat->data(), element_bytes, out);
+    }
+
+    void deserialize(const Wire::FlatMatCiphertext *mat, CiphertextMatrix &out, const KeyContext *key) {
+        if(!key)
+            error_exit("got a null pointer");
+        deserialize(mat, out);
+        out.key = key;
+    }
+
+    void deserialize(const void* buf, CiphertextMatrix &out, const KeyContext *key) {
+        deserialize(Wire::GetFlatMatCiphertext(buf), out, key);
+    }
+
+    flatbuffers::Offset<Wire::FlatSymMatCiphertext> serialize(flatbuffers::FlatBufferBuilder &builder, const SymmetricCiphertextMatrix &mat) {
+        size_t element_bytes;
+        const auto data = serialize_elements(builder, mat, element_bytes);
+        return Wire::CreateFlatSymMatCiphertext(builder, mat.NumRows(), element_bytes, data);
+    }
+
+    void deserialize(const void* buf, SymmetricCiphertextMatrix &out) {
+        deserialize(Wire::GetFlatSymMatCiphertext(buf), out);
+    }
+
+    void deserialize(const Wire::FlatSymMatCiphertext *mat, SymmetricCiphertextMatrix &out) {
+        const auto element_bytes = mat->element_bytes();
+        const uint64_t n = mat->n();
+        if(n == std::numeric_limits<uint64_t>::max())
+            error_exit("invalid import dimensions!");
+        const auto width = checked_element_limbs(mat->data(), checked_mul(n, n + 1) / 2, element_bytes);
+        out = SymmetricCiphertextMatrix(n, width, nullptr);
+        deserialize_elements(mat->data(), element_bytes, out);
+    }
+
+    void deserialize(const Wire::FlatSymMatCiphertext *mat, SymmetricCiphertextMatrix &out, const KeyContext *key) {
+        if(!key)
+            error_exit("got a null pointer");
+        deserialize(mat, out);
+        out.key = key;
+    }
+
+    void deserialize(const void* buf, SymmetricCiphertextMatrix &out, const KeyContext *key) {
+        deserialize(Wire::GetFlatSymMatCiphertext(buf), out, key);
+    }
+
     flatbuffers::Offset<Wire::PublicKey> serialize(flatbuffers::FlatBufferBuilder &builder, const PublicKey &p) {
         return Wire::CreatePublicKey(builder,
                                      p.key_size_bits,
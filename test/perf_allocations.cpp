@@ -0,0 +1,210 @@
+#include "ophelib/paillier_fast.h"
+#include "ophelib/vector.h"
+#include "ophelib/packing.h"
+#include "ophelib/random.h"
+#include "ophelib/memory.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace ophelib;
+
+#ifndef PERF_N_ITER
+#define PERF_N_ITER 200
+#endif
+
+const int n_iter_ = PERF_N_ITER;
+const size_t keysize = 2048;
+
+/**
+ * Counts calls to the GMP memory functions, to see how many
+ * heap allocations the arithmetic and vector operations do.
+ * All measurements are per iteration.
+ */
+namespace {
+    atomic<unsigned long long> n_alloc(0), n_realloc(0), n_bytes(0);
+
+    /* appended to all names, to tell the runs apart */
+    string suffix;
+
+    void *count_alloc(size_t n) {
+        n_alloc++;
+        n_bytes += n;
+        return malloc(n);
+    }
+
+    void *count_realloc(void *p, size_t, size_t n) {
+        n_realloc++;
+        n_bytes += n;
+        return realloc(p, n);
+    }
+
+    void count_free(void *p, size_t) {
+        free(p);
+    }
+
+    class AllocCounter {
+        const string name;
+        const int n_iter;
+        unsigned long long alloc0, realloc0, bytes0;
+
+    public:
+        AllocCounter(const string &name, const int n_iter)
+                : name(name + suffix),
+                  n_iter(n_iter) { }
+
+        static void header() {
+            cout << "name;n_iter;allocs;reallocs;bytes" << endl;
+        }
+
+        void start() {
+            alloc0 = n_alloc;
+            realloc0 = n_realloc;
+            bytes0 = n_bytes;
+        }
+
+        void stop() {
+            cout << name << ";"
+                 << n_iter << ";"
+                 << (double) (n_alloc - alloc0) / n_iter << ";"
+                 << (double) (n_realloc - realloc0) / n_iter << ";"
+                 << (double) (n_bytes - bytes0) / n_iter << endl;
+        }
+    };
+}
+
+void run_integer(const Integer &n2, const vector<Integer> &a) {
+    Integer x = a[0];
+
+    AllocCounter c0("Integer x = (x * a) % n2", n_iter_);
+    c0.start();
+    for(int i = 0; i < n_iter_; i++) {
+        x = (x * a[i]) % n2;
+    }
+    c0.stop();
+
+    AllocCounter c1("Integer x = (x * a + a) % n2", n_iter_);
+    c1.start();
+    for(int i = 0; i < n_iter_; i++) {
+        x = (x * a[i] + a[i]) % n2;
+    }
+    c1.stop();
+
+    AllocCounter c2("Integer return by value", n_iter_);
+    c2.start();
+    for(int i = 0; i < n_iter_; i++) {
+        x = -(a[i] << 1);
+    }
+    c2.stop();
+}
+
+void run_ciphertext(const PaillierFast &pai, vector<Ciphertext> &c) {
+    Ciphertext x = c[0];
+
+    AllocCounter c0("Ciphertext x += c", n_iter_);
+    c0.start();
+    for(int i = 0; i < n_iter_; i++) {
+        x += c[i];
+    }
+    c0.stop();
+
+    AllocCounter c1("Ciphertext x = x + c + c", n_iter_);
+    c1.start();
+    for(int i = 0; i < n_iter_; i++) {
+        x = x + c[i] + c[i];
+    }
+    c1.stop();
+
+    AllocCounter c2("Ciphertext x = c * 3 + c", n_iter_);
+    c2.start();
+    for(int i = 0; i < n_iter_; i++) {
+        x = c[i] * Integer(3) + c[i];
+    }
+    c2.stop();
+
+    AllocCounter c3("Encrypt", n_iter_);
+    c3.start();
+    for(int i = 0; i < n_iter_; i++) {
+        c[i] = pai.encrypt(i);
+    }
+    c3.stop();
+}
+
+void run_vector(const PaillierFast &pai) {
+    using namespace Vector;
+
+    const long n = n_iter_;
+    const auto a = Vector::rand_bits_neg(n, 32);
+    const auto b = Vector::rand_bits_neg(n, 32);
+    const auto a_enc = Vector::encrypt(a, pai);
+    const auto b_enc = Vector::encrypt(b, pai);
+
+    AllocCounter c0("Vec<Integer> a + b + a", n);
+    c0.start();
+    const auto x = a + b + a;
+    c0.stop();
+
+    AllocCounter c1("Vec<Integer> (a - b) * 3", n);
+    c1.start();
+    const auto y = (a - b) * Integer(3);
+    c1.stop();
+
+    AllocCounter c2("Vec<Ciphertext> a + b + a", n);
+    c2.start();
+    const auto z = a_enc + b_enc + a_enc;
+    c2.stop();
+
+    AllocCounter c3("Vec<Ciphertext> -(a * 3) + b", n);
+    c3.start();
+    const auto w = -(a_enc * Integer(3)) + b_enc;
+    c3.stop();
+
+    AllocCounter c4("Vec<Ciphertext> pack", n);
+    c4.start();
+    const auto p = Vector::pack_ciphertexts_vec(a_enc, 32, pai);
+    c4.stop();
+
+    if(Vector::decrypt(z, pai) != x)
+        cerr << "wrong result!" << endl;
+}
+
+int main() {
+    PaillierFast pai(keysize);
+    pai.generate_keys();
+
+    vector<Integer> rand_ints(n_iter_);
+    vector<Ciphertext> rand_ciphertexts(n_iter_);
+    for(int i = 0; i < n_iter_; i++) {
+        rand_ints[i] = Random::instance().rand_int_bits(keysize * 2);
+        rand_ciphertexts[i] = pai.encrypt(i);
+    }
+
+    /* only count what happens from here on */
+    mp_set_memory_functions(count_alloc, count_realloc, count_free);
+
+    cerr << "# " << pai.to_string() << endl;
+    AllocCounter::header();
+
+    run_integer(*pai.get_n2(), rand_ints);
+    run_ciphertext(pai, rand_ciphertexts);
+    run_vector(pai);
+
+    /* with the arena, only pool misses reach the counting functions */
+    LimbArena::enable(keysize);
+    suffix = " (LimbArena)";
+    run_integer(*pai.get_n2(), rand_ints);
+    run_ciphertext(pai, rand_ciphertexts);
+    run_vector(pai);
+
+    const auto stats = LimbArena::stats();
+    cerr << "# LimbArena: hits " << stats.hits
+         << ", misses " << stats.misses
+         << ", fallbacks " << stats.fallbacks
+         << ", cached " << stats.cached_blocks << " blocks / " << stats.cached_bytes << " bytes"
+         << ", threads " << stats.n_threads << endl;
+    LimbArena::disable();
+
+    return 0;
+}
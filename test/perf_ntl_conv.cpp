@@ -0,0 +1,158 @@
+#include "ophelib/ntl_conv.h"
+#include "ophelib/random.h"
+#include "ophelib/util.h"
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+#include <cassert>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace ophelib;
+
+const int n_iter = 2000;
+
+/**
+ * Previous conversions over the decimal representation,
+ * for comparison.
+ */
+void conv_string(Integer &z, const NTL::ZZ &a) {
+    ostringstream o;
+    o << a;
+    mpz_set_str(z.get_mpz_t(), o.str().c_str(), 10);
+}
+
+void conv_string(Integer &z, const NTL::RR &a) {
+    NTL::ZZ tmp;
+    NTL::conv(tmp, a);
+    conv_string(z, tmp);
+}
+
+void conv_string(NTL::RR &z, const Integer &a) {
+    NTL::conv(z, a.to_string_().c_str());
+}
+
+void conv_string(NTL::ZZ &z, const Integer &a) {
+    NTL::conv(z, a.to_string_().c_str());
+}
+
+/**
+ * Measurements for conversions of numbers of the given size.
+ * All measurements are per conversion.
+ */
+void run(const size_t bits) {
+    const string suffix = " " + to_string(bits) + " bits";
+    vector<Integer> ints;
+    ints.resize(n_iter);
+    for(int i = 0; i < n_iter; i++)
+        ints[i] = Random::instance().rand_int_bits(bits) * Integer(i % 2 ? 1 : -1);
+
+    vector<NTL::ZZ> zzs, zzs2;
+    zzs.resize(n_iter);
+    zzs2.resize(n_iter);
+    vector<Integer> res, res2;
+    res.resize(n_iter);
+    res2.resize(n_iter);
+
+    StopWatch t0("Integer -> ZZ string" + suffix, n_iter);
+    t0.start();
+    for(int i = 0; i < n_iter; i++)
+        conv_string(zzs[i], ints[i]);
+    t0.stop();
+
+    StopWatch t1("Integer -> ZZ bytes" + suffix, n_iter);
+    t1.start();
+    for(int i = 0; i < n_iter; i++)
+        conv(zzs2[i], ints[i]);
+    t1.stop();
+    for(int i = 0; i < n_iter; i++)
+        assert( zzs[i] == zzs2[i] );
+
+    StopWatch t2("ZZ -> Integer string" + suffix, n_iter);
+    t2.start();
+    for(int i = 0; i < n_iter; i++)
+        conv_string(res[i], zzs[i]);
+    t2.stop();
+
+    StopWatch t3("ZZ -> Integer bytes" + suffix, n_iter);
+    t3.start();
+    for(int i = 0; i < n_iter; i++)
+        conv(res2[i], zzs[i]);
+    t3.stop();
+    for(int i = 0; i < n_iter; i++)
+        assert( res[i] == ints[i] && res2[i] == ints[i] );
+
+    const long prec = NTL::RR::precision();
+    NTL::RR::SetPrecision((long) bits + 64);
+    vector<NTL::RR> rrs, rrs2;
+    rrs.resize(n_iter);
+    rrs2.resize(n_iter);
+
+    StopWatch t4("Integer -> RR string" + suffix, n_iter);
+    t4.start();
+    for(int i = 0; i < n_iter; i++)
+        conv_string(rrs[i], ints[i]);
+    t4.stop();
+
+    StopWatch t5("Integer -> RR bytes" + suffix, n_iter);
+    t5.start();
+    for(int i = 0; i < n_iter; i++)
+        conv(rrs2[i], ints[i]);
+    t5.stop();
+
+    StopWatch t6("RR -> Integer string" + suffix, n_iter);
+    t6.start();
+    for(int i = 0; i < n_iter; i++)
+        conv_string(res[i], rrs[i]);
+    t6.stop();
+
+    StopWatch t7("RR -> Integer mantissa" + suffix, n_iter);
+    t7.start();
+    for(int i = 0; i < n_iter; i++)
+        conv(res2[i], rrs[i]);
+    t7.stop();
+    for(int i = 0; i < n_iter; i++)
+        assert( res[i] == res2[i] );
+
+    NTL::RR::SetPrecision(prec);
+}
+
+/**
+ * Measurements for floats as they come out of Integerizer,
+ * i.e. a double times a power of two factor.
+ */
+void run_float() {
+    vector<NTL::RR> rrs;
+    rrs.resize(n_iter);
+    const NTL::RR factor = NTL::power2_RR(32);
+    for(int i = 0; i < n_iter; i++)
+        rrs[i] = NTL::conv<NTL::RR>((double) (i - n_iter / 2) / 7.) * factor;
+
+    vector<Integer> res, res2;
+    res.resize(n_iter);
+    res2.resize(n_iter);
+
+    StopWatch t0("RR -> Integer string float", n_iter);
+    t0.start();
+    for(int i = 0; i < n_iter; i++)
+        conv_string(res[i], rrs[i]);
+    t0.stop();
+
+    StopWatch t1("RR -> Integer mantissa float", n_iter);
+    t1.start();
+    for(int i = 0; i < n_iter; i++)
+        conv(res2[i], rrs[i]);
+    t1.stop();
+    for(int i = 0; i < n_iter; i++)
+        assert( res[i] == res2[i] );
+}
+
+int main() {
+    StopWatch::header();
+    run(64);
+    run(2048);
+    run(4096);
+    run_float();
+}
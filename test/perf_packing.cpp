@@ -1,6 +1,9 @@
 #include "ophelib/paillier_fast.h"
 #include "ophelib/packing.h"
 #include "ophelib/util.h"
+#include "ophelib/omp_wrap.h"
+
+#include <algorithm>
 
 #ifdef NDEBUG
 #undef NDEBUG
@@ -119,6 +122,40 @@ void run_fast_decrypt(const Vec<Ciphertext> &v, const size_t plaintext_bits, con
     assert( v_dec == v_dec3 );
 }
 
+/**
+ * Thread scaling of pack_ciphertexts_vec and encrypt_pack_vec, with
+ * 1, 2, 4, ... threads up to OMP_NUM_THREADS. All measurements are
+ * per sample.
+ */
+void run_thread_scaling(const Vec<Ciphertext> &v_enc, const Vec<Integer> &v, const size_t plaintext_bits, const PaillierBase &paillier) {
+    const int max_threads = omp_get_max_threads();
+    Vec<PackedCiphertext> reference;
+
+    for(int n_threads = 1; ; n_threads = min(2 * n_threads, max_threads)) {
+        omp_set_num_threads(n_threads);
+        const string suffix = " threads=" + to_string(n_threads);
+
+        StopWatch t0("run_thread_scaling pack_ciphertexts_vec" + suffix, v_enc.length());
+        t0.start();
+        const auto packed = Vector::pack_ciphertexts_vec(v_enc, plaintext_bits, paillier);
+        t0.stop();
+
+        StopWatch t1("run_thread_scaling encrypt_pack_vec" + suffix, v.length());
+        t1.start();
+        const auto packed2 = Vector::encrypt_pack_vec(v, plaintext_bits, paillier);
+        t1.stop();
+
+        if(n_threads == 1)
+            reference = packed;
+        assert( packed == reference );
+        assert( Vector::decrypt_pack(packed2, paillier) == v );
+
+        if(n_threads == max_threads)
+            break;
+    }
+    omp_set_num_threads(max_threads);
+}
+
 int main () {
     PaillierFast paillier(keysize);
     paillier.generate_keys();
@@ -136,5 +173,8 @@ int main () {
     run_enc_dec_pack(x, plaintext_bits, paillier);
     run_fast_decrypt(x_enc, plaintext_bits, paillier);
 
+    /* wider slots, so there are enough packs to spread over threads */
+    run_thread_scaling(x_enc, x, 64, paillier);
+
     return 0;
 }
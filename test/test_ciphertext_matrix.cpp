@@ -0,0 +1,183 @@
+#include "ophelib/ciphertext_matrix.h"
+#include "ophelib/paillier_fast.h"
+#include "ophelib/paillier.h"
+#include "catch.hpp"
+#include "ophelib/disable_exception_tests.h"
+
+using namespace std;
+using namespace ophelib;
+
+const int keysize = 1024;
+
+TEST_CASE("CiphertextMatrix") {
+    PaillierFast pai(keysize);
+    pai.generate_keys();
+
+    const long n = 7, d = 5;
+    const size_t plaintext_bits = 32;
+    const auto X = Vector::rand_bits_neg(n, d, plaintext_bits);
+    const auto y = Vector::rand_bits_neg(d, plaintext_bits);
+
+    const auto X_enc = Vector::encrypt(X, pai);
+    const auto y_enc = Vector::encrypt(y, pai);
+
+    SECTION("layout") {
+        const CiphertextMatrix M(X_enc);
+        REQUIRE( M.NumRows() == n );
+        REQUIRE( M.NumCols() == d );
+        REQUIRE( M.size() == (size_t) (n * d) );
+        REQUIRE( M.limbs_per_element() == mpz_size(pai.get_n2()->get_mpz_t()) );
+        REQUIRE( M.element_stride() >= M.limbs_per_element() );
+        REQUIRE( M.element_stride() * sizeof(mp_limb_t) % 64 == 0 );
+        REQUIRE( ((uintptr_t) M.data()) % 64 == 0 );
+        REQUIRE( M.memory_usage() == n * d * M.element_stride() * sizeof(mp_limb_t) );
+    }
+
+    SECTION("conversions") {
+        const CiphertextVector v(y_enc);
+        REQUIRE( v.length() == d );
+        REQUIRE( v.to_vec() == y_enc );
+        REQUIRE( v.get(2) == y_enc[2] );
+        REQUIRE( v.get(2).key == pai.get_key_context() );
+
+        const CiphertextMatrix M(X_enc);
+        REQUIRE( M.to_mat() == X_enc );
+        REQUIRE( M.get(3, 4) == X_enc[3][4] );
+        REQUIRE( M.row(3).to_vec() == X_enc[3] );
+
+        CiphertextMatrix M2(M);
+        REQUIRE( M2 == M );
+        M2.set(0, 0, X_enc[1][1]);
+        REQUIRE( M2 != M );
+        REQUIRE( M2.get(0, 0) == X_enc[1][1] );
+
+        const CiphertextMatrix M3(std::move(M2));
+        REQUIRE( M3.get(0, 0) == X_enc[1][1] );
+
+        REQUIRE( CiphertextVector(Vec<Ciphertext>()).length() == 0 );
+        REQUIRE( CiphertextMatrix(Mat<Ciphertext>()).NumRows() == 0 );
+    }
+
+    SECTION("encrypt and decrypt") {
+        const auto v = Vector::encrypt_flat(y, pai);
+        REQUIRE( v.length() == d );
+        REQUIRE( Vector::decrypt(v, pai) == y );
+        REQUIRE( Vector::decrypt(v.to_vec(), pai) == y );
+
+        const auto M = Vector::encrypt_flat(X, pai);
+        REQUIRE( Vector::decrypt(M, pai) == X );
+        REQUIRE( Vector::decrypt(M.to_mat(), pai) == X );
+    }
+
+    SECTION("decrypt_fast") {
+        const auto v = Vector::encrypt_flat(y, pai);
+        REQUIRE( Vector::decrypt_fast(v, pai, plaintext_bits) == y );
+
+        const auto M = Vector::encrypt_flat(X, pai);
+        REQUIRE( Vector::decrypt_fast(M, pai, plaintext_bits) == X );
+
+        /* more elements than fit in a single pack */
+        const auto z = Vector::rand_bits_neg(Vector::pack_count(plaintext_bits, pai) * 2 + 3, plaintext_bits);
+        REQUIRE( Vector::decrypt_fast(Vector::encrypt_flat(z, pai), pai, plaintext_bits) == z );
+    }
+
+    SECTION("pack_ciphertexts_vec") {
+        const CiphertextVector v(y_enc);
+        const auto packed = Vector::pack_ciphertexts_vec(v, plaintext_bits, pai);
+        REQUIRE( packed == Vector::pack_ciphertexts_vec(y_enc, plaintext_bits, pai) );
+        REQUIRE( Vector::decrypt_pack(packed, pai) == y );
+    }
+
+    SECTION("sum") {
+        using Vector::operator*;
+
+        const CiphertextVector v(y_enc);
+        REQUIRE( pai.decrypt(Vector::sum(v)) == Vector::sum(y) );
+
+        CiphertextVector acc(v);
+        acc += v;
+        acc += v;
+        REQUIRE( Vector::decrypt(acc, pai) == y * Integer(3) );
+        REQUIRE_THROWS_AS( acc += Vector::encrypt_flat(Vector::rand_bits(d + 1, 8), pai), BaseException );
+
+        const CiphertextMatrix M(X_enc);
+        REQUIRE( Vector::decrypt(Vector::sum(M, 0), pai) == Vector::sum(X, 0) );
+        REQUIRE( Vector::decrypt(Vector::sum(M, 1), pai) == Vector::sum(X, 1) );
+        REQUIRE_THROWS_AS( Vector::sum(M, 2), BaseException );
+    }
+
+    SECTION("dot") {
+        const CiphertextVector v(y_enc);
+        const auto z = Vector::rand_bits_neg(d, plaintext_bits);
+        REQUIRE( pai.decrypt(Vector::dot(v, z)) == Vector::dot(y, z) );
+        REQUIRE( Vector::dot(v, z) == Vector::dot(y_enc, z) );
+
+        const CiphertextMatrix M(X_enc);
+        const auto res = Vector::dot(M, z);
+        REQUIRE( res.to_vec() == Vector::dot(X_enc, z) );
+        REQUIRE( Vector::decrypt(res, pai) == Vector::dot(X, z) );
+
+        REQUIRE_THROWS_AS( Vector::dot(M, Vector::rand_bits(d + 1, 8)), BaseException );
+    }
+
+    SECTION("symmetric") {
+        using Vector::operator+;
+        using Vector::operator-;
+
+        /* S = X^T * X is symmetric */
+        const auto S = Vector::dot(Vector::transpose(X), X);
+        const auto S_enc = Vector::encrypt_symmetric(S, pai);
+        REQUIRE( S_enc.NumRows() == d );
+        REQUIRE( S_enc.NumCols() == d );
+        REQUIRE( S_enc.size() == (size_t) (d * (d + 1) / 2) );
+        REQUIRE( S_enc.index(4, 1) == S_enc.index(1, 4) );
+        REQUIRE( S_enc.index(d - 1, d - 1) == S_enc.size() - 1 );
+        REQUIRE( Vector::decrypt(S_enc, pai) == S );
+        REQUIRE( S_enc.get(1, 3) == S_enc.get(3, 1) );
+
+        const auto z = Vector::rand_bits_neg(d, plaintext_bits);
+        REQUIRE( Vector::decrypt(Vector::dot(S_enc, z), pai) == Vector::dot(S, z) );
+        REQUIRE( Vector::dot(S_enc, z).to_vec() == Vector::dot(S_enc.to_mat(), z) );
+        REQUIRE( SymmetricCiphertextMatrix(S_enc.to_mat()) == S_enc );
+
+        /* sum of outer products, as in LinregEncEncUsers */
+        Vec<SymmetricCiphertextMatrix> outer;
+        for(long i = 0; i < n; i++)
+            outer.append(Vector::encrypt_outer(X[i], pai));
+        REQUIRE( Vector::decrypt(Vector::sum(outer), pai) == S );
+        REQUIRE( Vector::decrypt(outer[0] + outer[1], pai) ==
+                 Vector::dot(Vector::col_matrix(X[0]), Vector::row_matrix(X[0])) +
+                 Vector::dot(Vector::col_matrix(X[1]), Vector::row_matrix(X[1])) );
+        REQUIRE( Vector::decrypt(-S_enc, pai) == -S );
+
+        SymmetricCiphertextMatrix S2(S_enc);
+        S2.set(2, 0, y_enc[0]);
+        REQUIRE( S2 != S_enc );
+        REQUIRE( S2.get(0, 2) == y_enc[0] );
+
+        REQUIRE_THROWS_AS( S_enc.get(d, 0), BaseException );
+        REQUIRE_THROWS_AS( Vector::encrypt_symmetric(X, pai), BaseException );
+        REQUIRE_THROWS_AS( Vector::dot(S_enc, Vector::rand_bits(d + 1, 8)), BaseException );
+        REQUIRE_THROWS_AS( S_enc + Vector::encrypt_outer(Vector::rand_bits(d + 1, 8), pai), BaseException );
+    }
+
+    SECTION("without FastMod") {
+        Paillier pai_(keysize);
+        pai_.generate_keys();
+        const auto M = Vector::encrypt_flat(X, pai_);
+        REQUIRE( !M.key->fast_mod );
+        REQUIRE( Vector::decrypt(Vector::dot(M, y), pai_) == Vector::dot(X, y) );
+    }
+
+    SECTION("invalid input") {
+        CiphertextVector v(y_enc);
+        REQUIRE_THROWS_AS( v.get(d), BaseException );
+        REQUIRE_THROWS_AS( v.set_data(0, -1), BaseException );
+        REQUIRE_THROWS_AS( v.set_data(0, *pai.get_n2() * *pai.get_n2()), BaseException );
+        REQUIRE_THROWS_AS( CiphertextVector(d, nullptr), BaseException );
+
+        PaillierFast other(keysize);
+        other.generate_keys();
+        REQUIRE_THROWS_AS( v.set(0, other.encrypt(1)), BaseException );
+    }
+}
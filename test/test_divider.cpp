@@ -0,0 +1,75 @@
+#include "ophelib/divider.h"
+#include "ophelib/vector.h"
+#include "ophelib/random.h"
+#include "catch.hpp"
+#include "ophelib/disable_exception_tests.h"
+
+#include <vector>
+
+using namespace std;
+using namespace ophelib;
+
+TEST_CASE("Divider") {
+    const int n_rep = 50;
+    Random &rand = Random::instance();
+
+    /* power of two, small odd part, large odd part, mixed */
+    vector<Integer> divisors = { 1, 2, 3, 7, Integer(1) << 29, Integer(1) << 100,
+                                 Integer(12345) << 58, Integer(rand.rand_int_bits(300) | 1),
+                                 Integer(rand.rand_int_bits(200) | 1) << 40 };
+    const size_t n_divisors = divisors.size();
+    for(size_t i = 0; i < n_divisors; i++)
+        divisors.push_back(-divisors[i]);
+
+    SECTION( "same as operator/ of Integer" ) {
+        for(const auto &d: divisors) {
+            const Divider div(d);
+            REQUIRE( div.get_divisor() == d );
+
+            for(int u = 0; u < n_rep; u++) {
+                const Integer a = rand.rand_int_bits(600) * Integer(u % 2 ? 1 : -1);
+                REQUIRE( div.divide(a) == a / d );
+                REQUIRE( a / div == a / d );
+
+                Integer x = a;
+                div.divide(x, x);
+                REQUIRE( x == a / d );
+                REQUIRE( Integer(a) / div == a / d );
+            }
+
+            for(const Integer &a: { Integer(0), Integer(1), Integer(-1), d, d - 1, -d, -d + 1 })
+                REQUIRE( div.divide(a) == a / d );
+        }
+    }
+
+    SECTION( "vectors and matrices" ) {
+        using Vector::operator/;
+        const Integer d = Integer(12345) << 58;
+        const Divider div(d);
+
+        Mat<Integer> M;
+        M.SetDims(20, 3);
+        for(long i = 0; i < M.NumRows(); i++)
+            for(long j = 0; j < M.NumCols(); j++)
+                M[i][j] = rand.rand_int_bits(400) * Integer(j % 2 ? 1 : -1);
+        const Vec<Integer> v = M[0];
+
+        Mat<Integer> expected_M;
+        expected_M.SetDims(M.NumRows(), M.NumCols());
+        for(long i = 0; i < M.NumRows(); i++)
+            for(long j = 0; j < M.NumCols(); j++)
+                expected_M[i][j] = M[i][j] / d;
+        const Vec<Integer> expected_v = expected_M[0];
+
+        REQUIRE( M / div == expected_M );
+        REQUIRE( M / d == expected_M );
+        REQUIRE( Mat<Integer>(M) / div == expected_M );
+        REQUIRE( v / div == expected_v );
+        REQUIRE( v / d == expected_v );
+        REQUIRE( Vec<Integer>(v) / div == expected_v );
+    }
+
+    SECTION( "division by zero" ) {
+        REQUIRE_THROWS_AS( Divider(0), MathException );
+    }
+}
@@ -3,6 +3,8 @@
 #include "ophelib/random.h"
 #include "catch.hpp"
 
+#include <vector>
+
 using namespace std;
 using namespace ophelib;
 
@@ -35,6 +37,41 @@ TEST_CASE("FastMod") {
             REQUIRE( mod.pow_mod_n2(a, b) );
     }
 
+    SECTION( "fast pow in place" ) {
+        Integer x;
+        mod.pow_mod_n2(x, a, b);
+        REQUIRE( x == a.pow_mod_n(b, n2) );
+
+        x = a;
+        mod.pow_mod_n2(x, x, b);
+        REQUIRE( x == a.pow_mod_n(b, n2) );
+
+        x = b;
+        mod.pow_mod_n2(x, a, x);
+        REQUIRE( x == a.pow_mod_n(b, n2) );
+    }
+
+    SECTION( "horner pow2" ) {
+        const size_t shift = 37;
+        vector<Integer> values;
+        vector<mpz_srcptr> xs;
+        for(int i = 0; i < 7; i++)
+            values.push_back(Random::instance().rand_int(n2));
+        for(const auto &v: values)
+            xs.push_back(v.get_mpz_t());
+
+        Integer expected = values[0];
+        for(size_t i = 1; i < values.size(); i++)
+            expected = (expected.pow_mod_n(Integer(1) << shift, n2) * values[i]) % n2;
+
+        Integer x;
+        mod.horner_pow2_n2(x, xs, shift);
+        REQUIRE( x == expected );
+
+        mod.horner_pow2_n2(x, vector<mpz_srcptr>(1, xs[0]), shift);
+        REQUIRE( x == values[0] );
+    }
+
     SECTION( "pow" ) {
         for(int i = 0; i < n_rep; i++)
             REQUIRE( a.pow_mod_n(b, n2) );
@@ -40,6 +40,27 @@ TEST_CASE("Integer") {
         REQUIRE( "123456" == i.to_string_() );
     }
 
+    SECTION( "move semantics" ) {
+        Integer i(48976587145LL), j(123);
+
+        Integer k(std::move(i));
+        REQUIRE( k == Integer(48976587145LL) );
+        REQUIRE( i == 0 );
+
+        i = std::move(k);
+        REQUIRE( i == Integer(48976587145LL) );
+
+        Integer a = i, b = j;
+        REQUIRE( (std::move(a) * j + j) % i == (i * j + j) % i );
+        a = i;
+        REQUIRE( -std::move(a) == -i );
+        a = i;
+        REQUIRE( (std::move(a) - 5) / std::move(b) == (i - 5) / j );
+        a = i;
+        REQUIRE( (std::move(a) << 3) >> 2 == i * Integer(2) );
+        REQUIRE( j + Integer(7) == 130 );
+    }
+
     SECTION( "operator/, operator*" )  {
         Integer i(48976587145LL), j(123);
         REQUIRE( (i * j ) / j == i );
@@ -102,6 +123,32 @@ TEST_CASE("Integer") {
         REQUIRE_FALSE( Integer(100).is_prime() );
         REQUIRE_FALSE( Integer(2147483646).is_prime() );
         REQUIRE_FALSE( Integer("170141183460469231731687303715884105728").is_prime() );
+
+        // pseudoprimes with a factor below the trial division bound (4096),
+        // rejected before Miller-Rabin: strong pseudoprimes to base 2
+        // (23 * 89, 127 * 337), strong Lucas pseudoprimes (53 * 103,
+        // 53 * 109) and a Carmichael number (7 * 11 * 13 * 41)
+        REQUIRE_FALSE( Integer(2047).is_prime() );
+        REQUIRE_FALSE( Integer(42799).is_prime() );
+        REQUIRE_FALSE( Integer(5459).is_prime() );
+        REQUIRE_FALSE( Integer(5777).is_prime() );
+        REQUIRE_FALSE( Integer(41041).is_prime() );
+        // strong pseudoprimes to base 2 with all factors above the trial
+        // division bound, so only the strong Lucas test rejects them
+        for(const long n: {30881551L /* 4201 * 7351 */, 36307981L /* 4261 * 8521 */,
+                           68512867L /* 4139 * 16553 */, 72543547L /* 4259 * 17033 */}) {
+            REQUIRE( Integer(2).pow_mod_n(Integer(n - 1), Integer(n)) == 1 );
+            REQUIRE_FALSE( Integer(n).is_prime() );
+        }
+        // strong pseudoprime to bases 2..23 (149491 * 747451 * 34233211),
+        // also only rejected by the strong Lucas test
+        REQUIRE_FALSE( Integer("3825123056546413051").is_prime() );
+        // square of a prime, product of large primes
+        REQUIRE_FALSE( (Integer(1000003) * Integer(1000003)).is_prime() );
+        REQUIRE_FALSE( (Integer(2147483647) * Integer("170141183460469231731687303715884105727")).is_prime() );
+
+        REQUIRE( Integer("170141183460469231731687303715884105727").is_prime(true) );
+        REQUIRE_FALSE( Integer("3825123056546413051").is_prime(true) );
     }
 
     SECTION( "pow" ) {
@@ -137,6 +184,64 @@ TEST_CASE("Integer") {
         REQUIRE( base.pow_mod_n(exp_, mod).size_bits() <= mod.size_bits() );
     }
 
+    SECTION( "mod kernels" )  {
+        Random &rand = Random::instance();
+        const Integer mod = rand.rand_prime(256);
+        const Integer a = rand.rand_int(mod),
+                      b = rand.rand_int(mod),
+                      e = rand.rand_int_bits(64);
+        Integer x;
+
+        mul_mod(x, a, b, mod);
+        REQUIRE( x == (a * b) % mod );
+        x = a;
+        mul_mod(x, x, x, mod);
+        REQUIRE( x == (a * a) % mod );
+        sqr_mod(x, b, mod);
+        REQUIRE( x == (b * b) % mod );
+
+        div_mod(x, a, b, mod);
+        REQUIRE( (x * b) % mod == a );
+        x = b;
+        div_mod(x, a, x, mod);
+        REQUIRE( (x * b) % mod == a );
+
+        inv_mod(x, a, mod);
+        REQUIRE( x == a.inv_mod_n(mod) );
+        pow_mod(x, a, e, mod);
+        REQUIRE( x == a.pow_mod_n(e, mod) );
+        x = e;
+        pow_mod(x, a, x, mod);
+        REQUIRE( x == a.pow_mod_n(e, mod) );
+
+        /* results are always positive */
+        mul_mod(x, -a, b, mod);
+        REQUIRE( x == (-a * b) % mod );
+        REQUIRE( x >= 0 );
+
+        REQUIRE_THROWS_AS( mul_mod(x, a, b, 0), MathException );
+        REQUIRE_THROWS_AS( pow_mod(x, a, b, 0), MathException );
+        REQUIRE_THROWS_AS( inv_mod(x, 0, mod), MathException );
+        REQUIRE_THROWS_AS( div_mod(x, a, Integer(6), 12), MathException );
+    }
+
+    SECTION( "fused accumulate" )  {
+        Random &rand = Random::instance();
+        const Integer a = rand.rand_int_bits(2048),
+                      b = -rand.rand_int_bits(1024),
+                      c = rand.rand_int_bits(100);
+        Integer x = c;
+
+        add_mul(x, a, b);
+        REQUIRE( x == c + a * b );
+        sub_mul(x, a, b);
+        REQUIRE( x == c );
+        add_mul(x, x, x);
+        REQUIRE( x == c + c * c );
+        sub_mul(x, a, a);
+        REQUIRE( x == c + c * c - a * a );
+    }
+
     SECTION( "inv_mod_n" )  {
         REQUIRE( Integer(2).inv_mod_n(11) == 6 );
         REQUIRE_THROWS_AS( Integer(5).inv_mod_n(10), MathException );
@@ -0,0 +1,54 @@
+#include "ophelib/key_pool.h"
+#include "catch.hpp"
+#include "ophelib/disable_exception_tests.h"
+
+using namespace std;
+using namespace ophelib;
+
+TEST_CASE("KeyPool") {
+    const size_t keysize = 1024;
+
+    SECTION( "hits" ) {
+        KeyPool pool({ keysize }, 2);
+        pool.wait_full();
+        REQUIRE( pool.available(keysize) == 2 );
+
+        const auto a = pool.acquire(keysize);
+        const auto b = pool.acquire(keysize);
+        REQUIRE( a != b );
+        REQUIRE( a->get_pub().n != b->get_pub().n );
+        REQUIRE( a->get_pub().key_size_bits == keysize );
+        REQUIRE( a->decrypt(a->encrypt(42)) == 42 );
+        REQUIRE( b->decrypt(b->encrypt(-42)) == -42 );
+
+        const auto stats = pool.stats();
+        REQUIRE( stats.hits == 2 );
+        REQUIRE( stats.misses == 0 );
+        REQUIRE( stats.generated >= 2 );
+
+        /* gets refilled in the background */
+        pool.wait_full();
+        REQUIRE( pool.available(keysize) == 2 );
+    }
+
+    SECTION( "misses" ) {
+        KeyPool pool({ keysize }, 0);
+        const auto a = pool.acquire(keysize);
+        REQUIRE( a->decrypt(a->encrypt(42)) == 42 );
+
+        const auto stats = pool.stats();
+        REQUIRE( stats.hits == 0 );
+        REQUIRE( stats.misses == 1 );
+        REQUIRE( stats.generated == 0 );
+        REQUIRE( pool.available(keysize) == 0 );
+    }
+
+    SECTION( "invalid arguments" ) {
+        REQUIRE_THROWS_AS( KeyPool({}, 1), BaseException );
+        REQUIRE_THROWS_AS( KeyPool({ 1000 }, 1), BaseException );
+        REQUIRE_THROWS_AS( KeyPool({ keysize }, 1, 0), BaseException );
+
+        KeyPool pool({ keysize }, 0);
+        REQUIRE_THROWS_AS( pool.acquire(2048), BaseException );
+    }
+}
@@ -0,0 +1,153 @@
+#include "ophelib/memory.h"
+#include "ophelib/paillier_fast.h"
+#include "ophelib/vector.h"
+#include "ophelib/packing.h"
+#include "ophelib/ciphertext_matrix.h"
+#include "catch.hpp"
+#include "ophelib/disable_exception_tests.h"
+
+using namespace std;
+using namespace ophelib;
+
+TEST_CASE("LimbArena") {
+    const size_t keysize = 1024;
+
+    /* allocated before the arena is enabled, freed afterwards */
+    PaillierFast pai(keysize);
+    pai.generate_keys();
+    const auto a = Vector::rand_bits_neg(20, 32);
+    const auto b = Vector::rand_bits_neg(20, 32);
+    Vec<Ciphertext> a_enc = Vector::encrypt(a, pai);
+
+    SECTION( "enable and disable" ) {
+        REQUIRE( !LimbArena::enabled() );
+        REQUIRE( LimbArena::max_limbs() == 0 );
+
+        LimbArena::enable(keysize);
+        REQUIRE( LimbArena::enabled() );
+        REQUIRE( LimbArena::max_limbs() == 2 * (2 * keysize / GMP_LIMB_BITS) + 2 );
+
+        const auto before = LimbArena::stats();
+        const auto b_enc = Vector::encrypt(b, pai);
+        a_enc = Vector::encrypt(a, pai);
+        using Vector::operator+;
+        REQUIRE( Vector::decrypt(a_enc + b_enc, pai) == Vector::decrypt(a_enc, pai) + b );
+        REQUIRE( Vector::decrypt(b_enc, pai) == b );
+
+        const auto after = LimbArena::stats();
+        REQUIRE( after.hits > before.hits );
+        REQUIRE( after.n_threads >= 1 );
+        REQUIRE( after.cached_blocks > 0 );
+        REQUIRE( after.cached_bytes >= after.cached_blocks * sizeof(mp_limb_t) );
+
+        /* larger than the largest size class */
+        const Integer big = Integer(1) << (keysize * 8);
+        REQUIRE( LimbArena::stats().fallbacks > after.fallbacks );
+        REQUIRE( (big >> (keysize * 8)) == 1 );
+
+        /* calling it again only changes the tuning */
+        LimbArena::enable(keysize * 2, 0);
+        REQUIRE( LimbArena::max_limbs() == 2 * (4 * keysize / GMP_LIMB_BITS) + 2 );
+        REQUIRE( pai.decrypt(pai.encrypt(42)) == 42 );
+
+        LimbArena::disable();
+        REQUIRE( !LimbArena::enabled() );
+        REQUIRE( LimbArena::max_limbs() == 0 );
+
+        /* allocated by the arena, used and freed without it */
+        REQUIRE( Vector::decrypt(b_enc, pai) == b );
+        LimbArena::disable();
+    }
+
+    SECTION( "growing numbers" ) {
+        LimbArena::enable(keysize);
+        Integer x(1);
+        for(size_t i = 0; i < 4 * keysize; i += 64) {
+            x <<= 64;
+            x += 1;
+        }
+        REQUIRE( x.size_bits() == 4 * keysize + 1 );
+        REQUIRE( x % Integer(2) == 1 );
+        LimbArena::disable();
+    }
+
+    SECTION( "memory_usage" ) {
+        const size_t n2_bytes = keysize * 2 / 8;
+
+        #if __GNU_MP_RELEASE >= 60200
+        /* mpz_init does not allocate since GMP 6.2 */
+        REQUIRE( Integer().memory_usage() == sizeof(Integer) );
+        #else
+        REQUIRE( Integer().memory_usage() >= sizeof(Integer) );
+        #endif
+        REQUIRE( Integer(5).memory_usage() >= sizeof(Integer) + sizeof(mp_limb_t) );
+        REQUIRE( heap_block_size(0) == 0 );
+        REQUIRE( heap_block_size(1) >= 1 + sizeof(size_t) );
+        REQUIRE( heap_block_size(n2_bytes) > n2_bytes );
+
+        const Ciphertext &c = a_enc[0];
+        REQUIRE( c.memory_usage() >= sizeof(Ciphertext) + n2_bytes - sizeof(mp_limb_t) );
+        REQUIRE( heap_usage(c) == heap_usage(c.data) );
+
+        const auto ctx = pai.get_key_context();
+        REQUIRE( ctx->memory_usage() > 2 * n2_bytes );
+
+        /* key context counted once */
+        const auto v_usage = Vector::memory_usage(a_enc);
+        size_t elements = 0;
+        for(long i = 0; i < a_enc.length(); i++)
+            elements += heap_usage(a_enc[i]);
+        REQUIRE( v_usage > elements + ctx->memory_usage() );
+        REQUIRE( v_usage < elements + 2 * ctx->memory_usage() + a_enc.length() * 2 * sizeof(Ciphertext) + 1024 );
+
+        Mat<Ciphertext> M;
+        M.SetDims(2, a_enc.length());
+        M[0] = a_enc;
+        M[1] = a_enc;
+        const size_t rows_usage = Vector::memory_usage(M[0]) + Vector::memory_usage(M[1]);
+        REQUIRE( Vector::memory_usage(M) > rows_usage - ctx->memory_usage() - 2 * sizeof(Vec<Ciphertext>) );
+        REQUIRE( Vector::memory_usage(M) < rows_usage );
+
+        const auto packed = Vector::pack_ciphertexts_vec(a_enc, 32, pai);
+        REQUIRE( Vector::memory_usage(packed) > packed.length() * n2_bytes );
+        REQUIRE( packed[0].memory_usage() == sizeof(PackedCiphertext) + heap_usage(packed[0].data) );
+
+        REQUIRE( Vector::memory_usage(a) > (size_t) a.length() * sizeof(Integer) );
+
+        /* randomizer lookup table dominates */
+        REQUIRE( pai.memory_usage() > 256 * n2_bytes );
+        REQUIRE( pai.memory_usage() > ctx->memory_usage() );
+
+        /* contexts of previous keys are kept */
+        PaillierFast pai2(keysize);
+        pai2.generate_keys();
+        const size_t usage = pai2.memory_usage();
+        pai2.generate_keys();
+        REQUIRE( pai2.memory_usage() > usage );
+    }
+
+    SECTION( "live_bytes" ) {
+        const int64_t before = live_bytes();
+        {
+            CiphertextVector v(a_enc);
+            REQUIRE( live_bytes() == before + (int64_t) v.memory_usage() );
+            CiphertextVector w(std::move(v));
+            REQUIRE( live_bytes() == before + (int64_t) w.memory_usage() );
+        }
+        REQUIRE( live_bytes() == before );
+
+        LimbArena::enable(keysize, 0);
+        const int64_t start = live_bytes();
+        {
+            const Integer x = Integer(1) << 100000;
+            REQUIRE( live_bytes() >= start + 100000 / 8 );
+        }
+        REQUIRE( live_bytes() == start );
+        LimbArena::disable();
+    }
+
+    SECTION( "invalid input" ) {
+        REQUIRE_THROWS_AS( LimbArena::enable(0), BaseException );
+        REQUIRE( !LimbArena::enabled() );
+    }
+}
@@ -159,6 +159,33 @@ TEST_CASE("ML") {
         #endif
     }
 
+    SECTION("LinregPlainEncUsers, packed") {
+        const auto X_flt = normX.transform(X_);
+        const auto y_flt = normY.fit_transform(y_);
+        const size_t n_bits = 40, headroom_bits = 48;
+
+        PaillierFast paillier(keysize);
+        paillier.generate_keys();
+        const auto callback = ML::LinregPlainEncUsers::construct_packed_client_callback(paillier);
+        ML::LinregPlainEncUsers reg(callback, inter, paillier.get_pub());
+        const auto B = ML::LinregPlainEncUsers::client_preprocess_packed(X_flt, y_flt, inter, n_bits, headroom_bits, paillier);
+        REQUIRE( B.NumRows() == X.NumRows() );
+        REQUIRE( B.NumCols() == 1 );
+
+        REQUIRE_THROWS_AS( reg.predict(X), BaseException );
+        REQUIRE_THROWS_AS( reg.fit(X_flt, Vector::encrypt(X, paillier)), BaseException );
+        reg.fit(X_flt, B);
+        const auto y_pred = normY.inverse_transform(inter.double_precision().inverse_transform(
+                Vector::decrypt(reg.predict(X), paillier)));
+
+        REQUIRE( y_pred.length() == X.NumRows() );
+        REQUIRE( ML::cost(y_, y_pred) < 26 );
+
+        /* too little headroom for the product with (X^T * X)^-1 */
+        const auto B_tight = ML::LinregPlainEncUsers::client_preprocess_packed(X_flt, y_flt, inter, n_bits, 8, paillier);
+        REQUIRE_THROWS_AS( reg.fit(X_flt, B_tight), BaseException );
+    }
+
     SECTION("LinregEncEncUsers") {
         const auto interY = inter.triple_precision();
         const NTL::Vec<Integer> y = interY.transform(normY.fit_transform(y_));
@@ -185,6 +212,15 @@ TEST_CASE("ML") {
         REQUIRE( ML::cost(y_, y_pred) < 26 );
         REQUIRE( ML::cost(y_, y_pred2) < 26 );
 
+        /* full matrices are summed, the lower triangle counts too */
+        auto A_skewed = A;
+        A_skewed[0][1][0] *= Integer(1000);
+        ML::LinregEncEncUsers reg_full(callback, inter.get_factor(), paillier.get_pub(), 1, 3);
+        ML::LinregEncEncUsers reg_skewed(callback, inter.get_factor(), paillier.get_pub(), 1, 3);
+        reg_full.fit(A, b);
+        reg_skewed.fit(A_skewed, b);
+        REQUIRE( reg_full.get_weights() != reg_skewed.get_weights() );
+
         #ifdef DEBUG
         const auto weights = inter.inverse_transform(reg.get_weights());
         cout << "> LinregEncEncUsers weights: ";
@@ -196,6 +232,148 @@ TEST_CASE("ML") {
         #endif
     }
 
+    SECTION("LinregEncEncUsers, symmetric A") {
+        const auto interY = inter.triple_precision();
+        const NTL::Vec<Integer> y = interY.transform(normY.fit_transform(y_));
+
+        PaillierFast paillier(keysize);
+        paillier.generate_keys();
+        const auto callback = ML::LinregEncEncUsers::construct_client_callback(paillier);
+        ML::LinregEncEncUsers reg(callback, inter.get_factor(), paillier.get_pub(), 1, 100);
+
+        const auto A = ML::LinregEncEncUsers::client_preprocess_A_symmetric(X, paillier);
+        const auto b = ML::LinregEncEncUsers::client_preprocess_b(X, y, paillier);
+        REQUIRE( A.length() == X.NumRows() );
+        REQUIRE( A[0].size() == (size_t) (X.NumCols() * (X.NumCols() + 1) / 2) );
+
+        REQUIRE( reg.fit(A, b) == 100 );
+        const auto y_pred = normY.inverse_transform(inter.inverse_transform(reg.predict(X)));
+        REQUIRE( ML::cost(y_, y_pred) < 26 );
+
+        /* same model as with full matrices */
+        ML::LinregEncEncUsers reg2(callback, inter.get_factor(), paillier.get_pub(), 1, 100);
+        reg2.fit(ML::LinregEncEncUsers::client_preprocess_A(X, paillier), b);
+        REQUIRE( reg.get_weights() == reg2.get_weights() );
+    }
+
+    SECTION("UsersAggregator") {
+        const auto interY = inter.triple_precision();
+        const NTL::Vec<Integer> y = interY.transform(normY.fit_transform(y_));
+
+        PaillierFast paillier(keysize);
+        paillier.generate_keys();
+        const auto callback = ML::LinregEncEncUsers::construct_client_callback(paillier);
+
+        /* users arrive one at a time, half of them in flat containers */
+        ML::UsersAggregator users;
+        REQUIRE_THROWS_AS( users.get_b(), BaseException );
+        for(long i = 0; i < X.NumRows(); i++) {
+            using Vector::operator*;
+            if(i % 2 == 0) {
+                users.add(Vector::encrypt(Vector::dot(Vector::col_matrix(X[i]), Vector::row_matrix(X[i])), paillier),
+                          Vector::encrypt(X[i] * y[i], paillier));
+            } else {
+                users.add(Vector::encrypt_outer(X[i], paillier),
+                          Vector::encrypt_flat(X[i] * y[i], paillier));
+            }
+        }
+        REQUIRE( users.size() == (size_t) X.NumRows() );
+        REQUIRE( users.n_features() == X.NumCols() );
+
+        /* a user under another key is rejected without touching the sums */
+        PaillierFast other(keysize);
+        other.generate_keys();
+        const auto A_before = users.get_A();
+        const auto b_before = users.get_b();
+        REQUIRE_THROWS_AS( users.add(Vector::encrypt_outer(X[0], paillier),
+                                     Vector::encrypt_flat(X[0], other)), BaseException );
+        REQUIRE_THROWS_AS( users.add(Vector::encrypt_outer(X[0], other),
+                                     Vector::encrypt_flat(X[0], other)), BaseException );
+        REQUIRE( users.size() == (size_t) X.NumRows() );
+        REQUIRE( users.get_A() == A_before );
+        REQUIRE( users.get_b() == b_before );
+        ML::UsersAggregator fresh;
+        REQUIRE_THROWS_AS( fresh.add(Vector::encrypt_outer(X[0], paillier),
+                                     Vector::encrypt_flat(X[0], other)), BaseException );
+        REQUIRE( fresh.size() == 0 );
+        REQUIRE( users.get_A().memory_usage() < Vector::encrypt_flat(X, paillier).memory_usage() );
+        REQUIRE_THROWS_AS( users.add(Vector::encrypt(X[0], paillier)), BaseException );
+        REQUIRE_THROWS_AS( users.add(Vector::encrypt_outer(X[0], paillier),
+                                     Vector::encrypt_flat(Vector::rand_bits(X.NumCols() + 1, 8), paillier)), BaseException );
+
+        ML::LinregEncEncUsers reg(callback, inter.get_factor(), paillier.get_pub(), 1, 100);
+        REQUIRE( reg.fit(users) == 100 );
+        ML::LinregEncEncUsers reg2(callback, inter.get_factor(), paillier.get_pub(), 1, 100);
+        reg2.fit(ML::LinregEncEncUsers::client_preprocess_A(X, paillier),
+                 ML::LinregEncEncUsers::client_preprocess_b(X, y, paillier));
+        REQUIRE( reg.get_weights() == reg2.get_weights() );
+
+        /* LinregPlainEncUsers, rows of B */
+        const auto X_flt = normX.transform(X_);
+        const auto y_flt = normY.fit_transform(y_);
+        const auto B = ML::LinregPlainEncUsers::client_preprocess(X_flt, y_flt, inter, paillier);
+        ML::UsersAggregator rows;
+        for(long i = 0; i < B.NumRows(); i++)
+            rows.add(B[i]);
+        REQUIRE_THROWS_AS( rows.get_A(), BaseException );
+        REQUIRE_THROWS_AS( rows.add(Vector::encrypt_outer(X[0], paillier), CiphertextVector(B[0])), BaseException );
+
+        ML::LinregPlainEncUsers reg3(ML::LinregPlainEncUsers::construct_client_callback(paillier), inter);
+        reg3.fit(X_flt, rows);
+        ML::LinregPlainEncUsers reg4(ML::LinregPlainEncUsers::construct_client_callback(paillier), inter);
+        reg4.fit(X_flt, B);
+        REQUIRE( Vector::decrypt(reg3.get_weights(), paillier) == Vector::decrypt(reg4.get_weights(), paillier) );
+
+        Mat<float> X_short = X_flt;
+        X_short.SetDims(X_flt.NumRows() - 1, X_flt.NumCols());
+        REQUIRE_THROWS_AS( reg3.fit(X_short, rows), BaseException );
+    }
+
+    SECTION("LinregEncEncUsers, packed") {
+        const auto interY = inter.triple_precision();
+        const NTL::Vec<Integer> y = interY.transform(normY.fit_transform(y_));
+
+        /* Ai and bi share the slot width, so pack both with the larger bits */
+        size_t x_bits = 0, y_bits = 0;
+        for(long i = 0; i < X.NumRows(); i++) {
+            y_bits = std::max(y_bits, y[i].size_bits());
+            for(long j = 0; j < X.NumCols(); j++)
+                x_bits = std::max(x_bits, X[i][j].size_bits());
+        }
+        const size_t n_bits = x_bits + y_bits, headroom_bits = 80;
+
+        PaillierFast paillier(keysize);
+        paillier.generate_keys();
+        const auto callback = ML::LinregEncEncUsers::construct_client_callback(paillier);
+        ML::LinregEncEncUsers reg(callback, inter.get_factor(), paillier.get_pub(), 1, 100);
+
+        const auto A = ML::LinregEncEncUsers::client_preprocess_A_packed(X, n_bits, headroom_bits, paillier);
+        const auto b = ML::LinregEncEncUsers::client_preprocess_b_packed(X, y, n_bits, headroom_bits, paillier);
+        REQUIRE( A.length() == X.NumRows() );
+        REQUIRE( A[0].NumRows() == X.NumCols() );
+        REQUIRE( A[0].NumCols() == 1 );
+        REQUIRE( b.NumCols() == 1 );
+
+        REQUIRE_THROWS_AS( reg.predict(X), BaseException );
+        REQUIRE( reg.fit(A, b) == 100 );
+        const auto y_pred = normY.inverse_transform(inter.inverse_transform(reg.predict(X)));
+
+        REQUIRE( y_pred.length() == X.NumRows() );
+        REQUIRE( ML::cost(y_, y_pred) < 26 );
+
+        /* same model as without packing */
+        ML::LinregEncEncUsers reg2(callback, inter.get_factor(), paillier.get_pub(), 1, 100);
+        reg2.fit(ML::LinregEncEncUsers::client_preprocess_A(X, paillier),
+                 ML::LinregEncEncUsers::client_preprocess_b(X, y, paillier));
+        REQUIRE( reg.get_weights() == reg2.get_weights() );
+
+        /* too little headroom for the gradient descent */
+        const auto A_tight = ML::LinregEncEncUsers::client_preprocess_A_packed(X, n_bits, 8, paillier);
+        const auto b_tight = ML::LinregEncEncUsers::client_preprocess_b_packed(X, y, n_bits, 8, paillier);
+        REQUIRE_THROWS_AS( reg.fit(A_tight, b_tight), BaseException );
+        REQUIRE_THROWS_AS( reg.fit(A, b_tight), BaseException );
+    }
+
     SECTION("cost") {
         using Vector::operator*;
         REQUIRE(ML::cost(y_, y_) == 0 );
@@ -55,4 +55,61 @@ TEST_CASE("NTL Conversions") {
             REQUIRE( conv<RR>(s) == b );
         }
     }
+    SECTION( "void conv(NTL::ZZ& z, const ophelib::Integer& a)" ) {
+        for(int u = 0; u < n_rep; u++) {
+            long a =  Random::instance().rand_int_bits(50).to_long(),
+                    b = -Random::instance().rand_int_bits(50).to_long();
+            ZZ a_, b_;
+            Integer r(a), s(b);
+            conv(a_, r);
+            conv(b_, s);
+            REQUIRE( a_ == a );
+            REQUIRE( b_ == b );
+            REQUIRE( conv<ZZ>(r) == a );
+            REQUIRE( conv<ZZ>(s) == b );
+        }
+        REQUIRE( conv<ZZ>(Integer(0)) == 0 );
+        REQUIRE( conv<Integer>(ZZ(0)) == 0 );
+    }
+
+    SECTION( "large numbers" ) {
+        for(int u = 0; u < n_rep; u++) {
+            const Integer a = Random::instance().rand_int_bits(4096),
+                          b = -Random::instance().rand_int_bits(2048);
+            REQUIRE( conv<Integer>(conv<ZZ>(a)) == a );
+            REQUIRE( conv<Integer>(conv<ZZ>(b)) == b );
+            REQUIRE( conv<ZZ>(a) == conv<ZZ>(a.to_string_().c_str()) );
+            REQUIRE( conv<ZZ>(b) == conv<ZZ>(b.to_string_().c_str()) );
+        }
+
+        const long prec = RR::precision();
+        RR::SetPrecision(4200);
+        for(int u = 0; u < n_rep; u++) {
+            const Integer a = Random::instance().rand_int_bits(4096),
+                          b = -Random::instance().rand_int_bits(2048);
+            REQUIRE( conv<Integer>(conv<RR>(a)) == a );
+            REQUIRE( conv<Integer>(conv<RR>(b)) == b );
+        }
+        RR::SetPrecision(prec);
+    }
+
+    SECTION( "RR rounding" ) {
+        /* same as NTL's conv(ZZ&, const RR&) */
+        REQUIRE( conv<Integer>(conv<RR>(2.5)) == 2 );
+        REQUIRE( conv<Integer>(conv<RR>(-2.5)) == -3 );
+        REQUIRE( conv<Integer>(conv<RR>(0.25)) == 0 );
+        REQUIRE( conv<Integer>(conv<RR>(-0.25)) == -1 );
+        REQUIRE( conv<Integer>(conv<RR>(0.0)) == 0 );
+
+        const RR big = power2_RR(3000) * 3.0;
+        REQUIRE( conv<Integer>(big) == (Integer(3) << 3000) );
+        REQUIRE( conv<Integer>(-big) == -(Integer(3) << 3000) );
+
+        for(int u = 0; u < n_rep; u++) {
+            const RR r = random_RR() * (double) (Random::instance().rand_int_bits(60).to_long() - (1L << 59));
+            ZZ z;
+            conv(z, r);
+            REQUIRE( conv<Integer>(r) == conv<Integer>(z) );
+        }
+    }
 }
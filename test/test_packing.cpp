@@ -2,10 +2,13 @@
 #include "ophelib/packing.h"
 #include "ophelib/random.h"
 #include "ophelib/paillier.h"
+#include "ophelib/paillier_fast.h"
 #include "ophelib/util.h"
 #include "catch.hpp"
 #include "ophelib/disable_exception_tests.h"
 
+#include <limits>
+
 using namespace std;
 using namespace ophelib;
 
@@ -72,6 +75,248 @@ TEST_CASE("PaillierBase::Packing") {
         REQUIRE( dec == plain );
     }
 
+    SECTION("decrypt, extreme values") {
+        const Integer max = (Integer(1) << 10) - 1;
+        const Integer values[] = { max, -max, 0, -1, 1, max, max, -max, -max, -1, -1, 0, max };
+        const size_t n_values = sizeof(values) / sizeof(values[0]);
+
+        for(size_t plaintext_bits: { (size_t)10, (size_t)31, (size_t)63 }) {
+            auto plain = Vector::zeros<Integer>(n_values);
+            for(size_t i = 0; i < n_values; i++)
+                plain[i] = values[i];
+
+            const auto dec = Vector::decrypt_pack(Vector::encrypt_pack(plain, plaintext_bits, paillier), paillier);
+            REQUIRE( dec == plain );
+        }
+    }
+
+    SECTION("aligned layout") {
+        REQUIRE( (Vector::aligned_plaintext_bits(10) + Vector::pack_buffer) % GMP_NUMB_BITS == 0 );
+        REQUIRE( Vector::aligned_plaintext_bits(10) >= 10 );
+        REQUIRE( Vector::aligned_plaintext_bits(GMP_NUMB_BITS - Vector::pack_buffer) == GMP_NUMB_BITS - Vector::pack_buffer );
+        REQUIRE( Vector::aligned_plaintext_bits(GMP_NUMB_BITS) == 2 * GMP_NUMB_BITS - Vector::pack_buffer );
+
+        for(size_t bits: { (size_t)10, (size_t)100 }) {
+            const auto plaintext_bits = Vector::aligned_plaintext_bits(bits);
+            const auto n_plaintexts = Vector::pack_count(plaintext_bits, paillier);
+            const auto plain = Vector::rand_bits_neg(n_plaintexts, bits);
+
+            const auto enc = Vector::encrypt_pack(plain, plaintext_bits, paillier);
+            REQUIRE( Vector::decrypt_pack(enc, paillier) == plain );
+        }
+
+        const size_t headroom_bits = 4;
+        const auto plaintext_bits = Vector::aligned_plaintext_bits(10, headroom_bits);
+        REQUIRE( plaintext_bits >= 10 );
+        const auto plain = Vector::rand_bits_neg(Vector::pack_count(plaintext_bits, paillier, headroom_bits), 10);
+        const auto enc = Vector::encrypt_pack(plain, plaintext_bits, paillier, headroom_bits);
+        REQUIRE( enc.slot_bits % GMP_NUMB_BITS == 0 );
+        REQUIRE( Vector::decrypt_pack(enc, paillier) == plain );
+    }
+
+    SECTION("slot-wise operations") {
+        using Vector::operator+;
+        using Vector::operator-;
+        using Vector::operator*;
+
+        const size_t plaintext_bits = 32, headroom_bits = 4;
+        const auto n_plaintexts = Vector::pack_count(plaintext_bits, paillier, headroom_bits);
+        REQUIRE( n_plaintexts == 27 );
+
+        const auto a = Vector::rand_bits_neg(n_plaintexts, plaintext_bits);
+        const auto b = Vector::rand_bits_neg(n_plaintexts, plaintext_bits);
+        const auto enc_a = Vector::encrypt_pack(a, plaintext_bits, paillier, headroom_bits);
+        const auto enc_b = Vector::encrypt_pack(b, plaintext_bits, paillier, headroom_bits);
+        REQUIRE( enc_a.slot_bits == plaintext_bits + headroom_bits + Vector::pack_buffer );
+
+        const auto sum = enc_a + enc_b;
+        REQUIRE( sum.plaintext_bits == plaintext_bits + 1 );
+        REQUIRE( Vector::decrypt_pack(sum, paillier) == a + b );
+
+        const auto diff = enc_a - enc_b;
+        REQUIRE( diff.plaintext_bits == plaintext_bits + 1 );
+        REQUIRE( Vector::decrypt_pack(diff, paillier) == a - b );
+
+        REQUIRE( (-enc_a).plaintext_bits == plaintext_bits );
+        REQUIRE( Vector::decrypt_pack(-enc_a, paillier) == -a );
+
+        const auto prod = enc_a * Integer(-5);
+        REQUIRE( prod.plaintext_bits == plaintext_bits + 3 );
+        REQUIRE( Vector::decrypt_pack(prod, paillier) == a * Integer(-5) );
+        REQUIRE( (enc_a * Integer(1)).plaintext_bits == plaintext_bits );
+
+        const auto chain = (enc_a + enc_b) - enc_a;
+        REQUIRE( chain.plaintext_bits == plaintext_bits + 2 );
+        REQUIRE( Vector::decrypt_pack(chain, paillier) == b );
+
+        auto in_place = enc_a;
+        in_place += enc_b;
+        in_place *= Integer(4);
+        REQUIRE( in_place.plaintext_bits == plaintext_bits + 3 );
+        REQUIRE( Vector::decrypt_pack(in_place, paillier) == (a + b) * Integer(4) );
+    }
+
+    SECTION("slot-wise sum") {
+        using Vector::operator+;
+
+        const size_t plaintext_bits = 16, headroom_bits = 4, n_packs = 16;
+        const auto n_plaintexts = Vector::pack_count(plaintext_bits, paillier, headroom_bits);
+
+        Vec<PackedCiphertext> packs;
+        packs.SetLength(n_packs);
+        auto expected = Vector::zeros<Integer>(n_plaintexts);
+        for(size_t i = 0; i < n_packs; i++) {
+            const auto plain = Vector::rand_bits_neg(n_plaintexts, plaintext_bits);
+            expected = expected + plain;
+            if(i % 2)
+                packs[i] = Vector::encrypt_pack(plain, plaintext_bits, paillier, headroom_bits);
+            else
+                packs[i] = Vector::pack_ciphertexts(Vector::encrypt(plain, paillier), plaintext_bits, paillier, headroom_bits);
+        }
+
+        const auto sum = Vector::sum(packs);
+        REQUIRE( sum.plaintext_bits == plaintext_bits + 4 );
+        REQUIRE( sum.slot_bits == packs[0].slot_bits );
+        REQUIRE( Vector::decrypt_pack(sum, paillier) == expected );
+    }
+
+    SECTION("slot-wise overflow") {
+        using Vector::operator-;
+        using Vector::operator*;
+
+        const size_t plaintext_bits = 32;
+        const auto a = Vector::rand_bits_neg(10, plaintext_bits);
+        const auto enc = Vector::encrypt_pack(a, plaintext_bits, paillier);
+
+        REQUIRE_THROWS_AS( enc + enc, BaseException );
+        REQUIRE_THROWS_AS( enc - enc, BaseException );
+        REQUIRE_THROWS_AS( enc * Integer(2), BaseException );
+        REQUIRE( Vector::decrypt_pack(enc * Integer(-1), paillier) == -a );
+
+        const auto enc_4 = Vector::encrypt_pack(a, plaintext_bits, paillier, 4);
+        const auto enc_5 = Vector::encrypt_pack(a, plaintext_bits, paillier, 5);
+        REQUIRE_THROWS_AS( enc_4 + enc_5, BaseException );
+        REQUIRE_THROWS_AS( enc_4 + Vector::encrypt_pack(Vector::rand_bits_neg(9, plaintext_bits), plaintext_bits, paillier, 4), BaseException );
+
+        Vec<PackedCiphertext> packs;
+        packs.SetLength(17, enc_4);
+        REQUIRE_THROWS_AS( Vector::sum(packs), BaseException );
+        packs.SetLength(16);
+        REQUIRE( Vector::decrypt_pack(Vector::sum(packs), paillier) == a * Integer(16) );
+        packs.SetLength(0);
+        REQUIRE_THROWS_AS( Vector::sum(packs), BaseException );
+    }
+
+    SECTION("dot with plaintext matrix") {
+        using Vector::operator+;
+
+        const size_t x_bits = 8, w_bits = 8, n_cols = 10, n_rows = 30, per_pack = 4;
+        const size_t headroom_bits = w_bits + 5;
+        const auto x = Vector::rand_bits_neg(n_cols, x_bits);
+        const auto W = Vector::rand_bits_neg(n_rows, n_cols, w_bits);
+        const auto W2 = Vector::rand_bits_neg(n_rows, n_cols, w_bits);
+
+        /* packs of 4, 4 and 2 plaintexts */
+        Vec<PackedCiphertext> x_enc;
+        for(size_t i = 0; i < n_cols; i += per_pack) {
+            const auto end = std::min(i + per_pack, n_cols);
+            x_enc.append(Vector::encrypt_pack(x.begin() + i, x.begin() + end, x_bits, paillier, headroom_bits));
+        }
+        REQUIRE( x_enc.length() == 3 );
+
+        const auto y = Vector::dot(W, x_enc, paillier);
+        REQUIRE( y.length() == 3 );
+        REQUIRE( y[0].slot_stride == per_pack );
+        REQUIRE( y[0].plaintext_bits == x_bits + w_bits + 4 );
+        REQUIRE( y[0].n_plaintexts == 10 );
+        REQUIRE( Vector::decrypt_pack(y, paillier) == Vector::dot(W, x) );
+
+        /* the results support the slot-wise operations */
+        const auto y2 = Vector::dot(W2, x_enc, paillier);
+        Vec<PackedCiphertext> y_sum;
+        for(long i = 0; i < y.length(); i++)
+            y_sum.append(y[i] + y2[i]);
+        REQUIRE( Vector::decrypt_pack(y_sum, paillier) == Vector::dot(W, x) + Vector::dot(W2, x) );
+        REQUIRE_THROWS_AS( y_sum[0] + y_sum[0], BaseException );
+
+        /* with a private key the products run on CRT */
+        PaillierFast fast(keysize);
+        fast.generate_keys();
+        Vec<PackedCiphertext> x_fast;
+        x_fast.append(Vector::encrypt_pack(x.begin(), x.end(), x_bits, fast, headroom_bits));
+        REQUIRE( Vector::decrypt_pack(Vector::dot(W, x_fast, fast), fast) == Vector::dot(W, x) );
+
+        const auto x_tight = Vector::encrypt_pack_vec(x, x_bits, paillier, 4);
+        REQUIRE_THROWS_AS( Vector::dot(W, x_tight, paillier), BaseException );
+        const auto W_wide = Vector::rand_bits_neg(n_rows, n_cols + 1, w_bits);
+        REQUIRE_THROWS_AS( Vector::dot(W_wide, x_enc, paillier), BaseException );
+        /* a single pack of 40 leaves no room for the cross terms */
+        const auto x_long = Vector::rand_bits_neg(40, x_bits);
+        const auto x_long_enc = Vector::encrypt_pack_vec(x_long, x_bits, paillier, headroom_bits);
+        REQUIRE( x_long_enc.length() == 1 );
+        REQUIRE_THROWS_AS( Vector::dot(Vector::rand_bits_neg(n_rows, 40, w_bits - 1), x_long_enc, paillier), BaseException );
+    }
+
+    SECTION("mixed width layout") {
+        /* 8 wide and 10 narrow fields, interleaved */
+        std::vector<size_t> field_bits;
+        for(size_t i = 0; i < 18; i++)
+            field_bits.push_back(i % 2 == 0 && i < 16 ? 200 : 8);
+        const PackLayout layout(field_bits, paillier);
+        REQUIRE( layout.n_fields() == 18 );
+        REQUIRE( layout.n_packs == 2 );
+        /* uniform packing at the widest field needs more */
+        REQUIRE( layout.n_packs < (18 + Vector::pack_count(200, paillier) - 1) / Vector::pack_count(200, paillier) );
+        REQUIRE( PackLayout(layout.field_bits, layout.field_pack, layout.field_offset, layout.n_packs) == layout );
+
+        Vec<Integer> fields;
+        fields.SetLength(field_bits.size());
+        for(size_t i = 0; i < field_bits.size(); i++)
+            fields[i] = Random::instance().rand_int_bits(field_bits[i]) * Integer(i % 3 == 0 ? -1 : 1);
+        fields[0] = 0;
+        fields[1] = -1;
+
+        const auto enc = Vector::encrypt_pack(fields, layout, paillier);
+        REQUIRE( enc.length() == 2 );
+        REQUIRE( Vector::decrypt_pack(enc, layout, paillier) == fields );
+
+        const auto packed = Vector::pack_ciphertexts(Vector::encrypt(fields, paillier), layout, paillier);
+        REQUIRE( packed.length() == 2 );
+        REQUIRE( Vector::decrypt_pack(packed, layout, paillier) == fields );
+
+        fields[3] = Integer(1) << 8;
+        REQUIRE_THROWS_AS( Vector::encrypt_pack(fields, layout, paillier), BaseException );
+        fields.SetLength(17);
+        REQUIRE_THROWS_AS( Vector::encrypt_pack(fields, layout, paillier), BaseException );
+        REQUIRE_THROWS_AS( Vector::decrypt_pack(Vector::encrypt(fields, paillier), layout, paillier), BaseException );
+    }
+
+    SECTION("mixed width layout, invalid") {
+        REQUIRE_THROWS_AS( PackLayout({8, 2048}, paillier), BaseException );
+        REQUIRE( PackLayout(std::vector<size_t>(), paillier).n_packs == 0 );
+
+        /* the second field starts inside the first one */
+        REQUIRE_THROWS_AS( PackLayout({8, 8}, {0, 0}, {0, 8}, 1), BaseException );
+        REQUIRE_THROWS_AS( PackLayout({8, 8}, {0, 1}, {0, 0}, 1), BaseException );
+        REQUIRE_THROWS_AS( PackLayout({8, 8}, {0}, {0, 9}, 1), BaseException );
+        const PackLayout fits({8, 8}, {0, 0}, {0, 9}, 1);
+        REQUIRE( fits.pack_fields()[0] == std::vector<size_t>({0, 1}) );
+
+        /* does not fit the key */
+        const PackLayout too_big({8}, {0}, {paillier.plaintext_size_bits()}, 1);
+        REQUIRE_THROWS_AS( Vector::encrypt_pack(Vector::zeros<Integer>(1), too_big, paillier), BaseException );
+
+        /* more packs than fields */
+        REQUIRE_THROWS_AS( PackLayout({8}, {0}, {0}, (size_t) 1 << 40), BaseException );
+
+        /* field ends which wrap around */
+        const size_t max = std::numeric_limits<size_t>::max();
+        REQUIRE_THROWS_AS( PackLayout({max, 8}, {0, 0}, {0, 5}, 1), BaseException );
+        const PackLayout wraps({8, 8}, {0, 0}, {max - 4, 0}, 1);
+        REQUIRE_THROWS_AS( Vector::encrypt_pack(Vector::zeros<Integer>(2), wraps, paillier), BaseException );
+        REQUIRE_THROWS_AS( Vector::pack_ciphertexts(Vector::encrypt(Vector::zeros<Integer>(2), paillier), wraps, paillier), BaseException );
+    }
+
     SECTION("pack/unpack, length 0") {
         const auto plaintext_bits = 128;
         const auto plain = Vector::zeros<Integer>(0);
@@ -149,6 +394,25 @@ TEST_CASE("PaillierBase::Packing") {
         REQUIRE( plain == decrypted );
     }
 
+    SECTION("pack ciphertexts, with private key and CRT") {
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        PaillierFast pai_pub(pai.get_pub());
+        const auto n_bits = 64;
+        const auto n_ciphertexts = Vector::pack_count(n_bits, pai);
+        const auto plain = Vector::rand_bits(n_ciphertexts, n_bits);
+
+        Vec<Ciphertext> ciphertexts = Vector::encrypt(plain, pai);
+        const auto packed = Vector::pack_ciphertexts(ciphertexts, n_bits, pai);
+        REQUIRE( Vector::decrypt_pack(packed, pai) == plain );
+
+        /* same result as without the private key */
+        Vec<Ciphertext> ciphertexts_pub = ciphertexts;
+        for(long i = 0; i < ciphertexts_pub.length(); i++)
+            ciphertexts_pub[i].key = pai_pub.get_key_context();
+        REQUIRE( Vector::pack_ciphertexts(ciphertexts_pub, n_bits, pai_pub).data.data == packed.data.data );
+    }
+
     SECTION("pack ciphertexts, length 0") {
         const auto n_bits = 64;
         const auto plain = Vector::zeros<Integer>(0);
@@ -199,6 +463,22 @@ TEST_CASE("PaillierBase::Packing") {
         REQUIRE( plain == decrypted );
     }
 
+    SECTION("pack arbitrary size vectors, errors in a pack") {
+        const auto n_bits = 64;
+        const auto n = Vector::pack_count(n_bits, paillier) * 3;
+        auto plain = Vector::rand_bits(n, n_bits);
+        plain[n - 1] = Random::instance().rand_int_bits(n_bits * 2);
+        REQUIRE_THROWS_AS( Vector::encrypt_pack_vec(plain, n_bits, paillier), BaseException );
+
+        Paillier other(keysize);
+        other.generate_keys();
+        auto ciphertexts = Vector::encrypt(Vector::rand_bits(n, n_bits), paillier);
+        ciphertexts[n / 2] = other.encrypt(Integer(1));
+        REQUIRE_THROWS_AS( Vector::pack_ciphertexts_vec(ciphertexts, n_bits, paillier), BaseException );
+        ciphertexts[n / 2] = Ciphertext(Integer(1));
+        REQUIRE_THROWS_AS( Vector::pack_ciphertexts_vec(ciphertexts, n_bits, paillier), BaseException );
+    }
+
     SECTION("pack arbitrary size ciphertext vector, length 0") {
         const auto n_bits = 64;
         const auto plain = Vector::rand_bits(0, n_bits);
@@ -27,7 +27,7 @@ TEST_CASE(STR(PAILLIER_CLASS)) {
         pai2.generate_keys();
 
         Ciphertext i_ = pai1.encrypt(i), j_ = pai2.encrypt(j);
-        REQUIRE(*i_.n2_shared.get() == *pai1.get_n2().get());
+        REQUIRE(i_.key->n2() == *pai1.get_n2().get());
 
         REQUIRE_THROWS_AS( i_ - j_, BaseException );
         REQUIRE( pai1.decrypt(i_) == i );
@@ -103,11 +103,11 @@ TEST_CASE(STR(PAILLIER_CLASS)) {
 
     SECTION( "Ciphertext constructors" ) {
         c = paillier.encrypt(m);
-        REQUIRE( c.n2_shared );
+        REQUIRE( c.key );
+        REQUIRE( c.key == paillier.get_key_context() );
 
         const auto c2 = Ciphertext(c.data);
-        REQUIRE_FALSE( c2.fast_mod );
-        REQUIRE_FALSE( c2.n2_shared );
+        REQUIRE_FALSE( c2.key );
         REQUIRE_THROWS_AS( -c2, BaseException );
         REQUIRE_THROWS_AS( c2 + c2, BaseException );
         REQUIRE_THROWS_AS( c2 * Integer(3), BaseException );
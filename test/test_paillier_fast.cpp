@@ -3,6 +3,9 @@
 #include "ophelib/util.h"
 #include "catch.hpp"
 #include "ophelib/disable_exception_tests.h"
+#include "ophelib/omp_wrap.h"
+
+#include <vector>
 
 #ifdef PAILLIER_CLASS
 #undef PAILLIER_CLASS
@@ -29,7 +32,7 @@ TEST_CASE(STR(PAILLIER_CLASS)) {
         pai2.generate_keys();
 
         Ciphertext i_ = pai1.encrypt(i), j_ = pai2.encrypt(j);
-        REQUIRE(*i_.n2_shared.get() == *pai1.get_n2().get());
+        REQUIRE(i_.key->n2() == *pai1.get_n2().get());
 
         REQUIRE_THROWS_AS( i_ - j_, BaseException );
         REQUIRE( pai1.decrypt(i_) == i );
@@ -106,17 +109,65 @@ TEST_CASE(STR(PAILLIER_CLASS)) {
 
     SECTION( "Ciphertext constructors" ) {
         c = paillier.encrypt(m);
-        REQUIRE( c.fast_mod );
-        REQUIRE( c.n2_shared );
+        REQUIRE( c.key );
+        REQUIRE( c.key->fast_mod );
+        REQUIRE( c.key == paillier.get_key_context() );
 
         const auto c2 = Ciphertext(c.data);
-        REQUIRE_FALSE( c2.fast_mod );
-        REQUIRE_FALSE( c2.n2_shared );
+        REQUIRE_FALSE( c2.key );
         REQUIRE_THROWS_AS( -c2, BaseException );
         REQUIRE_THROWS_AS( c2 + c2, BaseException );
         REQUIRE_THROWS_AS( c2 * Integer(3), BaseException );
     }
 
+    SECTION( "key context" ) {
+        PAILLIER_CLASS other(paillier.get_keypair());
+        REQUIRE( other.get_key_context() != paillier.get_key_context() );
+        REQUIRE( other.get_key_context()->fingerprint == paillier.get_key_context()->fingerprint );
+
+        /* same key, separately initialized */
+        const auto sum = paillier.encrypt(m) + other.encrypt(Integer(1));
+        REQUIRE( paillier.decrypt(sum) == m + 1 );
+
+        PAILLIER_CLASS third(keysize);
+        third.generate_keys();
+        REQUIRE( third.get_key_context()->fingerprint != paillier.get_key_context()->fingerprint );
+        REQUIRE_FALSE( KeyContext::same_key(third.get_key_context(), paillier.get_key_context()) );
+        REQUIRE_FALSE( KeyContext::same_key(nullptr, paillier.get_key_context()) );
+        REQUIRE( KeyContext::same_key(nullptr, nullptr) );
+
+        /* one registry entry per key, not per shared pointer */
+        const auto interned = KeyContext::intern(paillier.get_n2());
+        REQUIRE( interned == KeyContext::intern(std::make_shared<Integer>(*paillier.get_n2())) );
+        REQUIRE( interned != paillier.get_key_context() );
+        REQUIRE_FALSE( interned->fast_mod );
+        REQUIRE( KeyContext::same_key(interned, paillier.get_key_context()) );
+        REQUIRE( interned != KeyContext::intern(third.get_n2()) );
+
+        const auto interned_fast = KeyContext::intern(paillier.get_n2(), paillier.get_key_context()->fast_mod);
+        REQUIRE( interned_fast != interned );
+        REQUIRE( interned_fast->fast_mod );
+        REQUIRE_THROWS_AS( KeyContext::intern(nullptr), BaseException );
+    }
+
+    SECTION( "retired key contexts" ) {
+        PAILLIER_CLASS pai(keysize);
+        pai.generate_keys();
+        const auto first_usage = pai.memory_usage();
+        const auto c = pai.encrypt(m);
+
+        pai.generate_keys();
+        pai.generate_keys();
+        /* ciphertexts of the first key still work */
+        REQUIRE( (c + c).data == (c.data * c.data) % c.key->n2() );
+        const auto rotated_usage = pai.memory_usage();
+        REQUIRE( rotated_usage > first_usage );
+
+        pai.release_retired_key_contexts();
+        REQUIRE( pai.memory_usage() < rotated_usage );
+        REQUIRE( pai.decrypt(pai.encrypt(m)) == m );
+    }
+
     SECTION( "test with random numbers" ) {
         for(int i = 0; i < 20; i++) {
             Integer r = Random::instance().rand_int(paillier.plaintext_upper_boundary());
@@ -152,6 +203,13 @@ TEST_CASE(STR(PAILLIER_CLASS)"::generate_keys") {
         REQUIRE( priv.q.is_prime() );
     }
 
+    SECTION( "p and q are in the progression a * k + 1" ) {
+        REQUIRE( (priv.p - 1) % priv.a == 0 );
+        REQUIRE( (priv.q - 1) % priv.a == 0 );
+        REQUIRE( priv.p < priv.q );
+        REQUIRE( pub.n.size_bits() == keysize );
+    }
+
     SECTION( "(g^n)^a = 1 mod n^2" ) {
         REQUIRE( pub.g.pow_mod_n(pub.n * priv.a, pub.n * pub.n) );
     }
@@ -161,6 +219,38 @@ TEST_CASE(STR(PAILLIER_CLASS)"::generate_keys") {
         REQUIRE( ((lambda / priv.a) * priv.a) == lambda );
         REQUIRE( lambda % priv.a == 0 );
     }
+
+    SECTION( "with 1 and several threads" ) {
+        /* With several threads, the searches still running once p and q
+         * are found get cancelled. Generate repeatedly on one instance, so
+         * a later call would see anything a cancelled search left behind. */
+        const int n_threads = omp_get_max_threads();
+        std::vector<PrivateKey> privs;
+        std::vector<PublicKey> pubs;
+        for(const int threads: { 1, 4 }) {
+            omp_set_num_threads(threads);
+            PAILLIER_CLASS pai(keysize);
+            for(int i = 0; i < 3; i++) {
+                pai.generate_keys();
+                privs.push_back(pai.get_priv());
+                pubs.push_back(pai.get_pub());
+            }
+        }
+        omp_set_num_threads(n_threads);
+
+        for(size_t i = 0; i < privs.size(); i++) {
+            const auto &p = privs[i].p, &q = privs[i].q, &a = privs[i].a;
+            REQUIRE( p != q );
+            REQUIRE( p.is_prime() );
+            REQUIRE( q.is_prime() );
+            REQUIRE( (p - 1) % a == 0 );
+            REQUIRE( (q - 1) % a == 0 );
+            REQUIRE( pubs[i].n == p * q );
+            REQUIRE( pubs[i].n.size_bits() == keysize );
+            for(size_t j = 0; j < i; j++)
+                REQUIRE( pubs[i].n != pubs[j].n );
+        }
+    }
 }
 
 TEST_CASE(STR(PAILLIER_CLASS)"::Ciphertext") {
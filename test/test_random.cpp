@@ -3,6 +3,8 @@
 #include "catch.hpp"
 #include "ophelib/disable_exception_tests.h"
 
+#include <future>
+
 using namespace std;
 using namespace ophelib;
 
@@ -23,6 +25,41 @@ TEST_CASE("Random") {
         REQUIRE( r.rand_prime(n_bits).is_prime() );
     }
 
+    SECTION( "bit sizes" ) {
+        size_t max_bits = 0;
+        for(int i = 0; i < 100; i++) {
+            const auto x = r.rand_int_bits(67);
+            REQUIRE( x >= 0 );
+            REQUIRE( x.size_bits() <= 67 );
+            max_bits = std::max(max_bits, x.size_bits());
+        }
+        REQUIRE( max_bits == 67 );
+        for(int i = 0; i < 100; i++) {
+            REQUIRE( r.rand_int(1000) < 1000 );
+            REQUIRE( r.rand_int(Integer(1) << 64) < (Integer(1) << 64) );
+        }
+    }
+
+    SECTION( "rand_ulong" ) {
+        bool seen[10] = { false };
+        for(int i = 0; i < 1000; i++) {
+            const auto x = r.rand_ulong(10);
+            REQUIRE( x < 10 );
+            seen[x] = true;
+        }
+        for(int i = 0; i < 10; i++)
+            REQUIRE( seen[i] );
+        REQUIRE( r.rand_ulong(2) < 2 );
+    }
+
+    SECTION( "one instance per thread" ) {
+        auto other = std::async(std::launch::async, [](){
+            return std::make_pair(&Random::instance(), Random::instance().rand_int_bits(256));
+        }).get();
+        REQUIRE( other.first != &r );
+        REQUIRE( other.second != r.rand_int_bits(256) );
+    }
+
     SECTION( "invalid arguments" ) {
         REQUIRE_THROWS_AS( r.rand_int(0), BaseException );
         REQUIRE_THROWS_AS( r.rand_int(1), BaseException );
@@ -31,6 +68,8 @@ TEST_CASE("Random") {
         REQUIRE( r.rand_int_bits(1) < 2 );
         REQUIRE_THROWS_AS( r.rand_prime(0), BaseException );
         REQUIRE_THROWS_AS( r.rand_prime(1), BaseException );
+        REQUIRE_THROWS_AS( r.rand_ulong(0), BaseException );
+        REQUIRE_THROWS_AS( r.rand_ulong(1), BaseException );
         REQUIRE( r.rand_prime(2) < 4 );
     }
 }
@@ -1,8 +1,12 @@
 #include "ophelib/vector.h"
 #include "ophelib/paillier_fast.h"
+#include "ophelib/ntl_conv.h"
+#include "ophelib/random.h"
 #include "catch.hpp"
 #include "ophelib/disable_exception_tests.h"
+#include "ophelib/omp_wrap.h"
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <streambuf>
@@ -255,6 +259,26 @@ TEST_CASE("Vector Ops") {
         REQUIRE( (small_x + small_x + small_x) ==  small_x * (float)3 );
     }
 
+    SECTION("operators on temporaries") {
+        using Vector::operator+;
+        using Vector::operator-;
+        using Vector::operator*;
+        const auto a = Vector::rand_bits_neg(10, 32);
+        const auto b = Vector::rand_bits_neg(10, 32);
+        const auto A = Vector::rand_bits_neg(4, 3, 32);
+
+        Vec<Integer> expected;
+        expected.SetLength(a.length());
+        for(long i = 0; i < a.length(); i++)
+            expected[i] = -((a[i] - b[i]) * Integer(3)) + a[i];
+        REQUIRE( -((a - b) * Integer(3)) + a == expected );
+
+        auto tmp = a;
+        REQUIRE( std::move(tmp) + b == a + b );
+        REQUIRE( (A + A) - A == A );
+        REQUIRE( -(A * Integer(2)) + A == -A );
+    }
+
     SECTION("operator==") {
         SECTION("matrix") {
             Mat<float> small_x_2 = small_x;
@@ -425,6 +449,33 @@ TEST_CASE("Vector Ops") {
             REQUIRE(test_orig[0] == -1);
             REQUIRE(test_orig[2] == 1);
         }
+
+        SECTION("same result as with RR") {
+            Mat<float> M = Xn;
+            M.SetDims(Xn.NumRows() + 1, Xn.NumCols());
+            M[Xn.NumRows()][0] = 2;
+            M[Xn.NumRows()][1] = -1e-30f;
+            M[Xn.NumRows()][2] = -0.0f;
+
+            vector<Integer> factors = { Integer(1) << 29, Integer(1) << 62, Integer(15) << 40,
+                                        Integer(1) << 100, (Integer(1) << 40) + 1, Integer(12345) };
+            for(const auto &factor: factors) {
+                const Vector::Integerizer it(0, factor);
+                const auto Mi = it.transform(M);
+                const auto Mf = it.inverse_transform(Mi);
+                const NTL::RR factor_ = NTL::conv<NTL::RR>(factor);
+
+                for(long i = 0; i < M.NumRows(); i++) {
+                    for(long j = 0; j < M.NumCols(); j++) {
+                        const float x = std::max(-1.f, std::min(1.f, M[i][j]));
+                        Integer expected;
+                        conv(expected, NTL::conv<NTL::RR>(x) * factor_);
+                        REQUIRE( Mi[i][j] == expected );
+                        REQUIRE( Mf[i][j] == NTL::conv<float>(NTL::conv<NTL::RR>(expected) / factor_) );
+                    }
+                }
+            }
+        }
     }
 
     SECTION("matrix and vector product") {
@@ -475,6 +526,34 @@ TEST_CASE("Vector Ops") {
             REQUIRE_THROWS_AS( Vector::dot(d, c), DimensionMismatchException );
         }
 
+        SECTION("big integers") {
+            const long n = 7, k = 5, m = 3;
+            Mat<Integer> A, B;
+            A.SetDims(n, k);
+            B.SetDims(k, m);
+            for(long i = 0; i < n; i++)
+                for(long j = 0; j < k; j++)
+                    A[i][j] = Random::instance().rand_int_bits(300) * Integer((i + j) % 2 ? 1 : -1);
+            for(long i = 0; i < k; i++)
+                for(long j = 0; j < m; j++)
+                    B[i][j] = Random::instance().rand_int_bits(200) * Integer((i * j) % 3 ? 1 : -1);
+            const Vec<Integer> u = Vector::transpose(B)[0], v = A[0];
+
+            const auto C = Vector::dot(A, B);
+            for(long i = 0; i < n; i++) {
+                for(long j = 0; j < m; j++) {
+                    Integer expected = 0;
+                    for(long l = 0; l < k; l++)
+                        expected = expected + A[i][l] * B[l][j];
+                    REQUIRE( C[i][j] == expected );
+                }
+            }
+            REQUIRE( Vector::dot(A, u) == Vector::transpose(C)[0] );
+            REQUIRE( Vector::dot(v, B) == C[0] );
+            REQUIRE( Vector::dot(v, u) == C[0][0] );
+            REQUIRE( Vector::sum(A, 0) == Vector::sum(Vector::transpose(A), 1) );
+        }
+
         SECTION("zero and id") {
             REQUIRE( Vector::dot(a, Vector::zeros<float>(3, 3)) ==
                              Vector::zeros<float>(3, 3) );
@@ -563,6 +642,41 @@ TEST_CASE("Vector Ops") {
                 }
             }
         }
+
+        SECTION("rand with seed") {
+            const size_t bits = 100, x = 20, y = 30;
+            const Integer max = Integer(1) << 80;
+            const int n_threads = omp_get_max_threads();
+
+            const auto a = Vector::rand_bits(y, x, bits, Seed(42));
+            REQUIRE( a == Vector::rand_bits(y, x, bits, Seed(42)) );
+            REQUIRE_FALSE( a == Vector::rand_bits(y, x, bits, Seed(43)) );
+            REQUIRE( a[0] == Vector::rand_bits(x, bits, Seed(42)) );
+
+            const auto b = Vector::rand(y, x, max, Seed(7));
+            const auto c = Vector::rand_bits_neg(y, x, bits, Seed(7));
+            const auto d = Vector::rand_primes(3, 4, bits, Seed(7));
+            for(long i = 0; i < b.NumRows(); i++) {
+                for(long j = 0; j < b.NumCols(); j++) {
+                    REQUIRE( b[i][j] < max );
+                    REQUIRE( c[i][j].size_bits() <= bits );
+                }
+            }
+
+            /* same output no matter how many threads. Restore the thread
+             * count before checking, a failed REQUIRE must not leave the
+             * following tests single threaded. */
+            omp_set_num_threads(1);
+            const auto a1 = Vector::rand_bits(y, x, bits, Seed(42));
+            const auto b1 = Vector::rand(y, x, max, Seed(7));
+            const auto c1 = Vector::rand_bits_neg(y, x, bits, Seed(7));
+            const auto d1 = Vector::rand_primes(3, 4, bits, Seed(7));
+            omp_set_num_threads(n_threads);
+            REQUIRE( a == a1 );
+            REQUIRE( b == b1 );
+            REQUIRE( c == c1 );
+            REQUIRE( d == d1 );
+        }
     }
 
     SECTION("matrix_string, vec_string") {
@@ -58,8 +58,7 @@ TEST_CASE("Wire") {
         REQUIRE_THROWS_AS( -c_, BaseException );
         REQUIRE_THROWS_AS( c_ * Integer(2), BaseException );
         REQUIRE_THROWS_AS( c_ + c_, BaseException );
-        REQUIRE_FALSE( c_.n2_shared );
-        REQUIRE_FALSE( c_.fast_mod );
+        REQUIRE_FALSE( c_.key );
 
         serialize_to_file(-c, fname);
         REQUIRE( deserialize_from_file<Ciphertext>(fname) == -c );
@@ -80,6 +79,36 @@ TEST_CASE("Wire") {
         REQUIRE( Vector::decrypt_pack(enc_, pai) == plain );
     }
 
+    SECTION("PackedCiphertext, with headroom") {
+        using Vector::operator*;
+
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        const auto n_bits = 200;
+        const auto plain = Vector::rand_bits(3, n_bits);
+        const auto enc = Vector::encrypt_pack(plain, n_bits, pai, 8) * Integer(3);
+
+        serialize_to_file(enc, fname);
+        const auto enc_ = deserialize_from_file<PackedCiphertext>(fname);
+        unlink(fname.c_str());
+        REQUIRE( enc_ == enc );
+        REQUIRE( enc_.slot_bits == n_bits + 8 + Vector::pack_buffer );
+        REQUIRE( enc_.plaintext_bits == n_bits + 2 );
+        REQUIRE( Vector::decrypt_pack(enc_, pai) == plain * Integer(3) );
+    }
+
+    SECTION("PackLayout") {
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        const PackLayout layout({64, 8, 8, 300, 16}, pai);
+
+        serialize_to_file(layout, fname);
+        const auto layout_ = deserialize_from_file<PackLayout>(fname);
+        unlink(fname.c_str());
+        REQUIRE( layout_ == layout );
+        REQUIRE( layout_.n_packs == layout.n_packs );
+    }
+
     SECTION("VectorFloat") {
         for(long i = 0; i < X_.NumRows(); i++) {
             serialize_to_file(X_[i], fname);
@@ -147,6 +176,113 @@ TEST_CASE("Wire") {
         unlink(fname.c_str());
     }
 
+    SECTION("deprecated shared pointer overloads") {
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        const auto plain = Vector::rand_bits_neg(5, 32);
+        const auto enc = Vector::encrypt(plain, pai);
+
+        flatbuffers::FlatBufferBuilder builder;
+        builder.Finish(serialize(builder, enc));
+        Vec<Ciphertext> x;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+        deserialize(builder.GetBufferPointer(), x, pai.get_n2());
+#pragma GCC diagnostic pop
+        REQUIRE( x == enc );
+        REQUIRE( KeyContext::same_key(x[0].key, pai.get_key_context()) );
+        REQUIRE( pai.decrypt(x[0] + x[1]) == plain[0] + plain[1] );
+    }
+
+    SECTION("CiphertextVector") {
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        const auto plain = Vector::rand_bits_neg(17, 32);
+        const auto enc = Vector::encrypt_flat(plain, pai);
+
+        serialize_to_file(enc, fname);
+        const auto x = deserialize_from_file<CiphertextVector>(fname);
+        REQUIRE( x == enc );
+        unlink(fname.c_str());
+
+        flatbuffers::FlatBufferBuilder builder;
+        builder.Finish(serialize(builder, enc));
+        CiphertextVector y;
+        deserialize(builder.GetBufferPointer(), y, pai.get_key_context());
+        REQUIRE( Vector::decrypt(y, pai) == plain );
+    }
+
+    SECTION("CiphertextMatrix") {
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        const auto X_enc = Vector::encrypt_flat(X, pai);
+
+        serialize_to_file(X_enc, fname);
+        const auto x = deserialize_from_file<CiphertextMatrix>(fname);
+        REQUIRE( x == X_enc );
+        REQUIRE( x.NumRows() == X.NumRows() );
+        REQUIRE( x.NumCols() == X.NumCols() );
+        unlink(fname.c_str());
+
+        flatbuffers::FlatBufferBuilder builder;
+        builder.Finish(serialize(builder, X_enc));
+        CiphertextMatrix y;
+        deserialize(builder.GetBufferPointer(), y, pai.get_key_context());
+        REQUIRE( Vector::decrypt(y, pai) == X );
+    }
+
+    SECTION("SymmetricCiphertextMatrix") {
+        PaillierFast pai(keysize);
+        pai.generate_keys();
+        const auto S_enc = Vector::encrypt_outer(X[0], pai);
+
+        serialize_to_file(S_enc, fname);
+        const auto x = deserialize_from_file<SymmetricCiphertextMatrix>(fname);
+        REQUIRE( x == S_enc );
+        REQUIRE( x.NumRows() == X.NumCols() );
+        unlink(fname.c_str());
+
+        flatbuffers::FlatBufferBuilder builder;
+        builder.Finish(serialize(builder, S_enc));
+        SymmetricCiphertextMatrix y;
+        deserialize(builder.GetBufferPointer(), y, pai.get_key_context());
+        REQUIRE( Vector::decrypt(y, pai) == Vector::dot(Vector::col_matrix(X[0]), Vector::row_matrix(X[0])) );
+    }
+
+    SECTION("flat containers with invalid headers") {
+        const std::vector<uint8_t> payload(256, 1);
+
+        /* huge length, tiny payload */
+        {
+            flatbuffers::FlatBufferBuilder builder;
+            builder.Finish(Wire::CreateFlatVecCiphertext(builder, 1ULL << 40, 256, builder.CreateVector(payload)));
+            CiphertextVector v;
+            REQUIRE_THROWS_AS( deserialize(builder.GetBufferPointer(), v), BaseException );
+        }
+        {
+            flatbuffers::FlatBufferBuilder builder;
+            builder.Finish(Wire::CreateFlatVecCiphertext(builder, 4, 0, builder.CreateVector(payload)));
+            CiphertextVector v;
+            REQUIRE_THROWS_AS( deserialize(builder.GetBufferPointer(), v), BaseException );
+        }
+
+        /* n_rows * n_cols wraps around */
+        {
+            flatbuffers::FlatBufferBuilder builder;
+            builder.Finish(Wire::CreateFlatMatCiphertext(builder, (1ULL << 32) + 1, (1ULL << 32) + 1, 256, builder.CreateVector(payload)));
+            CiphertextMatrix m;
+            REQUIRE_THROWS_AS( deserialize(builder.GetBufferPointer(), m), BaseException );
+        }
+
+        /* n * (n + 1) / 2 overflows */
+        {
+            flatbuffers::FlatBufferBuilder builder;
+            builder.Finish(Wire::CreateFlatSymMatCiphertext(builder, 1ULL << 33, 256, builder.CreateVector(payload)));
+            SymmetricCiphertextMatrix m;
+            REQUIRE_THROWS_AS( deserialize(builder.GetBufferPointer(), m), BaseException );
+        }
+    }
+
     SECTION("PublicKey") {
         PaillierFast pai(keysize);
         pai.generate_keys();